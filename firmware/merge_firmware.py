@@ -7,6 +7,7 @@ Import("env")
 import os
 import shutil
 import json
+import hashlib
 
 def merge_bin(source, target, env):
     """Create merged binary after successful build"""
@@ -97,10 +98,14 @@ def merge_bin(source, target, env):
             with open(version_path, "r") as vf:
                 version = vf.read().strip()
         
+        # sha256 of the OTA image: the device verifies the download against it
+        with open(dest_ota, "rb") as ota:
+            ota_sha = hashlib.sha256(ota.read()).hexdigest()
+
         # Write version.json
         version_json_path = os.path.join(dest_dir, "version.json")
         with open(version_json_path, "w") as vj:
-            json.dump({"version": int(version)}, vj)
+            json.dump({"version": int(version), "sha256": ota_sha}, vj)
         print(f"Version {version} saved to: {version_json_path}")
 
 # Register post-build action
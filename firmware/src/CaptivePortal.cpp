@@ -5,10 +5,11 @@
 #include <Preferences.h>
 #include <Update.h>
 #include <ESPmDNS.h>
-#include <stdarg.h>
 
 #include "CaptivePortal.h"
 #include "utility/FirmwareUpdate.h"
+#include "utility/WifiConnect.h"
+#include "utility/Log.h"
 #include "Display.h"
 
 // Exposed from main.ino
@@ -28,24 +29,35 @@ namespace
 
     bool portalStarted = false;
     bool otaSuccess = false;
+    MetricsWriter metricsWriter = nullptr;
 
-    // Web log buffer (circular, max 30 entries)
-    const int LOG_BUFFER_SIZE = 30;
-    String logBuffer[LOG_BUFFER_SIZE];
-    int logHead = 0;
-    int logCount = 0;
+    // Tail of the log ring shown on /logs
+    const size_t LOGS_PAGE_BYTES = 3072;
 
-    void addWebLog(const String &msg)
+    String htmlEscape(const String &s)
     {
-        logBuffer[logHead] = String(millis() / 1000) + "s: " + msg;
-        logHead = (logHead + 1) % LOG_BUFFER_SIZE;
-        if (logCount < LOG_BUFFER_SIZE) logCount++;
+        String out;
+        out.reserve(s.length() + 16);
+        for (size_t i = 0; i < s.length(); ++i)
+        {
+            char c = s[i];
+            switch (c)
+            {
+            case '&': out += F("&amp;"); break;
+            case '<': out += F("&lt;"); break;
+            case '>': out += F("&gt;"); break;
+            case '"': out += F("&quot;"); break;
+            case '\'': out += F("&#39;"); break;
+            default: out += c; break;
+            }
+        }
+        return out;
     }
 
     void handleLogs()
     {
         String page;
-        page.reserve(4096);
+        page.reserve(LOGS_PAGE_BYTES + 2048);
         page += F("<!DOCTYPE html><html><head><meta charset='utf-8'>");
         page += F("<meta name='viewport' content='width=device-width,initial-scale=1'>");
         page += F("<meta http-equiv='refresh' content='3'>");
@@ -66,13 +78,12 @@ namespace
         page += F("<div class='header'><h1>Device Logs</h1><a href='/'>&larr; Back</a></div>");
         page += F("<div class='log'>");
         
-        // Output logs from oldest to newest
-        int start = (logCount < LOG_BUFFER_SIZE) ? 0 : logHead;
-        for (int i = 0; i < logCount; i++) {
-            int idx = (start + i) % LOG_BUFFER_SIZE;
-            page += logBuffer[idx] + "\n";
-        }
-        if (logCount == 0) {
+        // Oldest to newest, whatever the ring still holds
+        String logs;
+        logRing().tail(logs, LOGS_PAGE_BYTES);
+        if (logs.length() > 0) {
+            page += htmlEscape(logs);
+        } else {
             page += F("<span class='empty'>No logs yet. Waiting for events...</span>");
         }
         
@@ -80,26 +91,6 @@ namespace
         server.send(200, "text/html", page);
     }
 
-    String htmlEscape(const String &s)
-    {
-        String out;
-        out.reserve(s.length() + 16);
-        for (size_t i = 0; i < s.length(); ++i)
-        {
-            char c = s[i];
-            switch (c)
-            {
-            case '&': out += F("&amp;"); break;
-            case '<': out += F("&lt;"); break;
-            case '>': out += F("&gt;"); break;
-            case '"': out += F("&quot;"); break;
-            case '\'': out += F("&#39;"); break;
-            default: out += c; break;
-            }
-        }
-        return out;
-    }
-
     String wifiStatusLine()
     {
         wl_status_t st = WiFi.status();
@@ -237,6 +228,14 @@ namespace
                   "<input name='ssid' type='text' autocomplete='off' required>"
                   "<label>Password</label>"
                   "<input name='password' type='password' autocomplete='off'>"
+                  "<label>Static IP (optional, blank = DHCP)</label>"
+                  "<input name='ip' type='text' autocomplete='off' placeholder='192.168.1.50'>"
+                  "<label>Gateway</label>"
+                  "<input name='gateway' type='text' autocomplete='off' placeholder='192.168.1.1'>"
+                  "<label>Subnet mask</label>"
+                  "<input name='subnet' type='text' autocomplete='off' placeholder='255.255.255.0'>"
+                  "<label>DNS</label>"
+                  "<input name='dns' type='text' autocomplete='off' placeholder='same as gateway'>"
                   "<input type='submit' value='Connect'>"
                   "</form></div>");
 
@@ -257,6 +256,16 @@ namespace
         page += preferences.getBool("demoMode", false) ? "Disable Demo Mode" : "Enable Demo Mode";
         page += F("'></form></div>");
 
+        // Battery mode card
+        page += F("<div class='card'><h2>Battery Mode</h2>"
+                  "<div class='hint' style='margin-top:0;margin-bottom:8px'>"
+                  "Sleeps between frame switches, heartbeat every 15 min or more. "
+                  "No LED effects; this portal is only up for 3 min after power-on.</div>"
+                  "<form method='POST' action='/battery-mode'>"
+                  "<input type='submit' value='");
+        page += preferences.getBool("batteryMode", false) ? "Disable Battery Mode" : "Enable Battery Mode";
+        page += F("'></form></div>");
+
         // Factory reset card
         page += F("<div class='card'><h2>Factory Reset</h2>"
                   "<div class='hint' style='color:#ff6b6b;margin-top:0;margin-bottom:8px'>"
@@ -288,14 +297,33 @@ namespace
         preferences.putString("ssid", ssid);
         preferences.putString("password", password);
 
-        WiFi.begin(ssid.c_str(), password.length() ? password.c_str() : nullptr);
+        // Static IP needs an address and a gateway; anything else means DHCP
+        IPAddress ip, gateway;
+        if (ip.fromString(server.arg("ip")) && gateway.fromString(server.arg("gateway")))
+        {
+            preferences.putString(NVS_WIFI_STATIC_IP, ip.toString());
+            preferences.putString(NVS_WIFI_GATEWAY, gateway.toString());
+            preferences.putString(NVS_WIFI_SUBNET, server.arg("subnet"));
+            preferences.putString(NVS_WIFI_DNS, server.arg("dns"));
+        }
+        else
+        {
+            preferences.remove(NVS_WIFI_STATIC_IP);
+            preferences.remove(NVS_WIFI_GATEWAY);
+            preferences.remove(NVS_WIFI_SUBNET);
+            preferences.remove(NVS_WIFI_DNS);
+        }
+
+        wifiConnect().begin(ssid, password);
 
         unsigned long start = millis();
         const unsigned long timeoutMs = 15000;
         while (WiFi.status() != WL_CONNECTED && millis() - start < timeoutMs)
         {
             delay(250);
+            wifiConnect().loop();
         }
+        wifiConnect().loop();
 
         String msg;
         if (WiFi.status() == WL_CONNECTED)
@@ -349,14 +377,13 @@ namespace
 
         if (upload.status == UPLOAD_FILE_START)
         {
-            Serial.printf("[OTA] START: filename=%s, totalSize=%u\n", upload.filename.c_str(), upload.totalSize);
+            LOG_I(OTA, "START: filename=%s, totalSize=%u", upload.filename.c_str(), upload.totalSize);
             otaSuccess = false;
             // Use UPDATE_SIZE_UNKNOWN when totalSize is 0 (not yet known at start)
             size_t updateSize = (upload.totalSize > 0) ? upload.totalSize : UPDATE_SIZE_UNKNOWN;
             if (!Update.begin(updateSize))
             {
-                Serial.printf("[OTA] Update.begin FAILED (size=%u)\n", updateSize);
-                Update.printError(Serial);
+                LOG_W(OTA, "Update.begin FAILED (size=%u): %s", updateSize, Update.errorString());
             }
         }
         else if (upload.status == UPLOAD_FILE_WRITE)
@@ -366,8 +393,7 @@ namespace
                 size_t written = Update.write(upload.buf, upload.currentSize);
                 if (written != upload.currentSize)
                 {
-                    Serial.printf("[OTA] Write mismatch: expected=%u, written=%u\n", upload.currentSize, written);
-                    Update.printError(Serial);
+                    LOG_W(OTA, "Write mismatch: expected=%u, written=%u: %s", upload.currentSize, written, Update.errorString());
                 }
             }
         }
@@ -375,18 +401,17 @@ namespace
         {
             if (Update.end(true))
             {
-                Serial.println("[OTA] SUCCESS");
+                LOG_I(OTA, "SUCCESS");
                 otaSuccess = true;
             }
             else
             {
-                Serial.println("[OTA] FAILED");
-                Update.printError(Serial);
+                LOG_W(OTA, "FAILED: %s", Update.errorString());
             }
         }
         else if (upload.status == UPLOAD_FILE_ABORTED)
         {
-            Serial.println("[OTA] ABORTED");
+            LOG_W(OTA, "ABORTED");
             Update.end();
         }
     }
@@ -438,6 +463,7 @@ namespace
                       "</div></body></html>");
             server.send(200, "text/html", page);
             delay(1000);
+            logFlush();
             ESP.restart();
         }
     }
@@ -456,6 +482,19 @@ namespace
         return false;
     }
 
+    void handleMetrics()
+    {
+        if (!metricsWriter)
+        {
+            server.send(404, "text/plain", "Not found");
+            return;
+        }
+        String json;
+        metricsWriter(json);
+        server.sendHeader("Cache-Control", "no-store");
+        server.send(200, "application/json", json);
+    }
+
     void handleNotFound()
     {
         if (isCaptivePortalRequest())
@@ -481,7 +520,7 @@ namespace
             return;
         }
 
-        WiFi.begin(ssid.c_str(), password.length() ? password.c_str() : nullptr);
+        wifiConnect().begin(ssid, password);
     }
 
     void handleFactoryReset()
@@ -500,6 +539,7 @@ namespace
                   "</div></body></html>");
         server.send(200, "text/html", page);
         delay(1000);
+        logFlush();
         ESP.restart();
     }
 
@@ -522,6 +562,29 @@ namespace
                   "</div></body></html>");
         server.send(200, "text/html", page);
         delay(1000);
+        logFlush();
+        ESP.restart();
+    }
+
+    void handleBatteryMode()
+    {
+        bool newMode = !preferences.getBool("batteryMode", false);
+        preferences.putBool("batteryMode", newMode);
+
+        String page = F("<!DOCTYPE html><html><head><meta charset='utf-8'>"
+                        "<meta name='viewport' content='width=device-width,initial-scale=1'>"
+                        "<title>Battery Mode</title>");
+        page += RESULT_STYLE;
+        page += F("</head><body><div class='box'>"
+                  "<div class='icon ok'>&#10003;</div>"
+                  "<h1>Battery Mode ");
+        page += newMode ? "Enabled" : "Disabled";
+        page += F("</h1>"
+                  "<p>Device is rebooting...</p>"
+                  "</div></body></html>");
+        server.send(200, "text/html", page);
+        delay(1000);
+        logFlush();
         ESP.restart();
     }
 
@@ -586,15 +649,16 @@ namespace
         display.refresh();
         
         // Perform the update
-        Serial.println("[Portal] Starting force OTA update...");
+        LOG_I(PORTAL, "Starting force OTA update...");
         OtaResult result = OtaUpdate::forceUpdate();
         
         if (result.success) {
-            Serial.println("[Portal] OTA update successful, rebooting...");
+            LOG_I(PORTAL, "OTA update successful, rebooting...");
             delay(1000);
+            logFlush();
             ESP.restart();
         } else {
-            Serial.printf("[Portal] OTA update failed: %s\n", result.errorMessage.c_str());
+            LOG_W(PORTAL, "OTA update failed: %s", result.errorMessage.c_str());
             // Note: Since we already sent the response, we can't send another one
             // The user will need to refresh to see the status
         }
@@ -603,11 +667,11 @@ namespace
 
 void startCaptivePortal()
 {
-    Serial.println("[CaptivePortal] Starting...");
+    LOG_D(PORTAL, "Starting...");
     
     if (portalStarted)
     {
-        Serial.println("[CaptivePortal] Already started, skipping");
+        LOG_D(PORTAL, "Already started, skipping");
         return;
     }
     portalStarted = true;
@@ -617,7 +681,7 @@ void startCaptivePortal()
     // #region agent log - Debug: Use ESP.getEfuseMac() - hardware MAC always available
     // ESP32 has MAC burned into eFuse, WiFi APIs return 00:00:00:00:00:00 before fully initialized
     uint64_t efuseMac = ESP.getEfuseMac();
-    Serial.printf("[DEBUG] eFuse MAC raw: 0x%llX\n", efuseMac);
+    LOG_D(PORTAL, "eFuse MAC raw: 0x%llX", efuseMac);
     
     // Extract bytes and format as MAC string (eFuse MAC is in reverse byte order)
     uint8_t macBytes[6];
@@ -631,12 +695,12 @@ void startCaptivePortal()
     char macStr[18];
     snprintf(macStr, sizeof(macStr), "%02X:%02X:%02X:%02X:%02X:%02X",
              macBytes[0], macBytes[1], macBytes[2], macBytes[3], macBytes[4], macBytes[5]);
-    Serial.printf("[DEBUG] eFuse MAC formatted: '%s'\n", macStr);
+    LOG_D(PORTAL, "eFuse MAC formatted: '%s'", macStr);
     
     // Get last 4 hex chars for suffix (last 2 bytes = 4 hex chars)
     char suffix[5];
     snprintf(suffix, sizeof(suffix), "%02X%02X", macBytes[4], macBytes[5]);
-    Serial.printf("[DEBUG] Generated suffix: '%s'\n", suffix);
+    LOG_D(PORTAL, "Generated suffix: '%s'", suffix);
     // #endregion
     
     // Generate unique SSID and hostname using last 4 chars of hardware MAC (e.g. "tigermeter-54D8")
@@ -644,18 +708,18 @@ void startCaptivePortal()
     
     // IMPORTANT: setHostname() must be called BEFORE WiFi.mode() to take effect
     WiFi.setHostname(apSsid.c_str());
-    Serial.printf("[CaptivePortal] SSID/Hostname: %s\n", apSsid.c_str());
+    LOG_I(PORTAL, "SSID/Hostname: %s", apSsid.c_str());
     
-    Serial.println("[CaptivePortal] Setting WiFi mode to AP_STA");
+    LOG_D(PORTAL, "Setting WiFi mode to AP_STA");
     WiFi.mode(WIFI_AP_STA);
     
     WiFi.softAPConfig(AP_IP, AP_IP, AP_NETMASK);
     
     bool apStarted = WiFi.softAP(apSsid.c_str());
-    Serial.printf("[CaptivePortal] softAP('%s') = %s\n", apSsid.c_str(), apStarted ? "OK" : "FAILED");
+    LOG_I(PORTAL, "softAP('%s') = %s", apSsid.c_str(), apStarted ? "OK" : "FAILED");
     
     if (apStarted) {
-        Serial.printf("[CaptivePortal] AP IP: %s\n", WiFi.softAPIP().toString().c_str());
+        LOG_I(PORTAL, "AP IP: %s", WiFi.softAPIP().toString().c_str());
     }
 
     autoConnectFromStoredCredentials();
@@ -663,23 +727,25 @@ void startCaptivePortal()
     // Register mDNS so the device is discoverable as <apSsid>.local on the LAN
     if (MDNS.begin(apSsid.c_str())) {
         MDNS.addService("http", "tcp", 80);
-        Serial.printf("[CaptivePortal] mDNS started: %s.local\n", apSsid.c_str());
+        LOG_I(PORTAL, "mDNS started: %s.local", apSsid.c_str());
     }
 
     dnsServer.start(53, "*", AP_IP);
-    Serial.println("[CaptivePortal] DNS server started");
+    LOG_D(PORTAL, "DNS server started");
 
     server.on("/", HTTP_GET, handleRoot);
     server.on("/logs", HTTP_GET, handleLogs);
+    server.on("/metrics", HTTP_GET, handleMetrics);
     server.on("/wifi", HTTP_POST, handleWifiSave);
     server.on("/update", HTTP_POST, handleUpdateResult, handleUpdateUpload);
     server.on("/reset", HTTP_POST, handleFactoryReset);
     server.on("/demo-mode", HTTP_POST, handleDemoMode);
+    server.on("/battery-mode", HTTP_POST, handleBatteryMode);
     server.on("/force-update", HTTP_POST, handleForceUpdate);
     server.onNotFound(handleNotFound);
 
     server.begin();
-    Serial.println("[CaptivePortal] HTTP server started on port 80");
+    LOG_I(PORTAL, "HTTP server started on port 80");
 }
 
 void captivePortalLoop()
@@ -691,23 +757,17 @@ void captivePortalLoop()
 
     dnsServer.processNextRequest();
     server.handleClient();
+    wifiConnect().loop();
 }
 
-void webLog(const char *format, ...)
+const String& getApSsid()
 {
-    char buf[256];
-    va_list args;
-    va_start(args, format);
-    vsnprintf(buf, sizeof(buf), format, args);
-    va_end(args);
-    
-    Serial.println(buf);  // Also print to serial
-    addWebLog(String(buf));
+    return apSsid;
 }
 
-const String& getApSsid()
+void setPortalMetricsWriter(MetricsWriter writer)
 {
-    return apSsid;
+    metricsWriter = writer;
 }
 
 
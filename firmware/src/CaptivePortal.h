@@ -7,9 +7,12 @@
 
 void startCaptivePortal();
 void captivePortalLoop();
-void webLog(const char *format, ...);  // Printf-style logging to web /logs page
 const String& getApSsid();  // Get unique AP SSID (available after startCaptivePortal)
 
+// Fills the /metrics response (JSON); /metrics returns 404 until one is set
+typedef void (*MetricsWriter)(String &json);
+void setPortalMetricsWriter(MetricsWriter writer);
+
 
 
 
@@ -2,6 +2,9 @@
  * Display.cpp - E-Paper display implementation using GxEPD2 + U8g2
  *****************************************************************************/
 #include "Display.h"
+#include "utility/Log.h"
+#include "utility/FrameDiff.h"
+#include "utility/BitBlit.h"
 
 // U8g2 fonts with Cyrillic support are included via U8g2_for_Adafruit_GFX
 // Available fonts: https://github.com/olikraus/u8g2/wiki/fntlistall
@@ -16,17 +19,153 @@
 Display display;
 
 Display::Display()
-    : _display(GxEPD2_290_GDEY029T71H(EPD_CS_PIN, EPD_DC_PIN, EPD_RST_PIN, EPD_BUSY_PIN))
+    : _display(GxEPD2_290_GDEY029T71H_Modes(EPD_CS_PIN, EPD_DC_PIN, EPD_RST_PIN, EPD_BUSY_PIN))
     , _spi(HSPI)
     , _currentFontSize(FONT_SIZE_MEDIUM)
     , _currentFontPixelSize(20)
     , _textColorBlack(true)
+    , _policy(DISPLAY_WIDTH * DISPLAY_HEIGHT)
 {
 }
 
+void GxEPD2_290_GDEY029T71H_Modes::refresh(bool partial_update_mode)
+{
+    // The very first refresh is a real full one (GxEPD2 sets the panel up)
+    if (partial_update_mode || !_fastNext || _initial_refresh) {
+        _fastNext = false;
+        GxEPD2_290_GDEY029T71H::refresh(partial_update_mode);
+        return;
+    }
+    _fastNext = false;
+    _writeCommand(0x3C);  // border waveform, as for a full refresh
+    _writeData(0x05);
+    _writeCommand(0x1A);  // temperature register: 110 °C
+    _writeData(0x6E);
+    _writeData(0x00);
+    _writeCommand(0x22);  // load the waveform for it
+    _writeData(0x91);
+    _writeCommand(0x20);
+    _waitWhileBusy("_Load_Fast", 100);
+    _writeCommand(0x22);  // display mode 1 without reloading the temperature
+    _writeData(0xC7);
+    _writeCommand(0x20);
+    _waitWhileBusy("_Update_Fast", 1500);
+    // 0xC7 ends with the analog supply off; the next partial update sets
+    // its own border and waveform up again (the next full one reloads the
+    // real temperature)
+    _power_is_on = false;
+    _using_partial_mode = false;
+}
+
+void GxEPD2_290_GDEY029T71H_Modes::writeGray4Rows(bool high, const uint8_t* rows, int16_t y, int16_t h)
+{
+    _writeCommand(0x11);  // data entry: x then y increasing
+    _writeData(0x03);
+    _writeCommand(0x44);  // RAM x window, in bytes: the whole row
+    _writeData(0x00);
+    _writeData(WIDTH / 8 - 1);
+    _writeCommand(0x45);  // RAM y window
+    _writeData(y % 256);
+    _writeData(y / 256);
+    _writeData((y + h - 1) % 256);
+    _writeData((y + h - 1) / 256);
+    _writeCommand(0x4E);  // address counters to the window start
+    _writeData(0x00);
+    _writeCommand(0x4F);
+    _writeData(y % 256);
+    _writeData(y / 256);
+    _writeCommand(high ? 0x26 : 0x24);
+    _startTransfer();
+    for (int32_t i = 0; i < (int32_t)h * (WIDTH / 8); i++) _transfer(rows[i]);
+    _endTransfer();
+}
+
+void GxEPD2_290_GDEY029T71H_Modes::refreshGray4()
+{
+    _writeCommand(0x3C);  // border waveform, as for a full refresh
+    _writeData(0x05);
+    _writeCommand(0x1A);  // temperature register: 90 °C
+    _writeData(0x5A);
+    _writeData(0x00);
+    _writeCommand(0x22);  // load the waveform for it
+    _writeData(0x91);
+    _writeCommand(0x20);
+    _waitWhileBusy("_Load_4G", 100);
+    _writeCommand(0x22);  // display mode 2 without reloading the temperature
+    _writeData(0xCF);
+    _writeCommand(0x20);
+    _waitWhileBusy("_Update_4G", 2500);
+    // RAM 0x26 no longer holds the previous image: the next update must be
+    // a full one (Display sees to that), and it reloads the real temperature
+    _power_is_on = false;
+    _using_partial_mode = false;
+    _initial_refresh = false;
+}
+
+void DisplayPanel::drawPixel(int16_t x, int16_t y, uint16_t color)
+{
+    if (x < 0 || x >= width() || y < 0 || y >= height()) return;
+    switch (getRotation()) {
+        case 1:
+            _swap_int16_t(x, y);
+            x = WIDTH - x - 1;
+            break;
+        case 2:
+            x = WIDTH - x - 1;
+            y = HEIGHT - y - 1;
+            break;
+        case 3:
+            _swap_int16_t(x, y);
+            y = HEIGHT - y - 1;
+            break;
+    }
+    uint16_t i = x / 8 + y * (WIDTH / 8);
+    if (color == GxEPD_BLACK) _buffer[i] &= ~(0x80 >> (x % 8));
+    else _buffer[i] |= 0x80 >> (x % 8);
+}
+
+void DisplayPanel::display(bool partialUpdate)
+{
+    if (partialUpdate) epd2.writeImage(_buffer, 0, 0, WIDTH, HEIGHT);
+    else epd2.writeImageForFullRefresh(_buffer, 0, 0, WIDTH, HEIGHT);
+    epd2.refresh(partialUpdate);
+    // Controllers that diff against the previous image get it for next time
+    if (epd2.hasFastPartialUpdate) epd2.writeImageAgain(_buffer, 0, 0, WIDTH, HEIGHT);
+    if (!partialUpdate) epd2.powerOff();
+}
+
+void DisplayPanel::displayWindow(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+    // Clip to the screen, then turn into native coordinates
+    x = min(max(x, (int16_t)0), width());
+    y = min(max(y, (int16_t)0), height());
+    w = min(w, (int16_t)(width() - x));
+    h = min(h, (int16_t)(height() - y));
+    if (w <= 0 || h <= 0) return;
+    switch (getRotation()) {
+        case 1:
+            _swap_int16_t(x, y);
+            _swap_int16_t(w, h);
+            x = WIDTH - x - w;
+            break;
+        case 2:
+            x = WIDTH - x - w;
+            y = HEIGHT - y - h;
+            break;
+        case 3:
+            _swap_int16_t(x, y);
+            _swap_int16_t(w, h);
+            y = HEIGHT - y - h;
+            break;
+    }
+    epd2.writeImagePart(_buffer, x, y, WIDTH, HEIGHT, x, y, w, h);
+    epd2.refresh(x, y, w, h);
+    if (epd2.hasFastPartialUpdate) epd2.writeImagePartAgain(_buffer, x, y, WIDTH, HEIGHT, x, y, w, h);
+}
+
 void Display::begin()
 {
-    Serial.println("[Display] Initializing...");
+    LOG_D(DISPLAY, "Initializing...");
     
     // Initialize custom SPI (HSPI on ESP32)
     _spi.begin(EPD_SCK_PIN, -1, EPD_MOSI_PIN, EPD_CS_PIN);
@@ -46,49 +185,152 @@ void Display::begin()
     setFont(FONT_SIZE_MEDIUM);
     setTextColor(true);
     
-    // Do initial full clear to reset any ghosting
-    _display.setFullWindow();
+    // No blank refresh here: the first screen drawn is a full refresh anyway,
+    // which clears any ghosting left from before the reset
     _display.fillScreen(GxEPD_WHITE);
-    _display.display(false);  // Full hardware refresh
     
-    Serial.printf("[Display] Initialized (%dx%d)\n", _display.width(), _display.height());
+    // Without it every frame is a full refresh
+    _shown = (uint8_t*)ps_malloc(DISPLAY_FRAME_MAX_SIZE);
+    if (!_shown) LOG_W(DISPLAY, "No memory for frame diffs");
+    
+    LOG_I(DISPLAY, "Initialized (%dx%d)", _display.width(), _display.height());
 }
 
 void Display::clear()
 {
-    _display.setFullWindow();  // Must set window before drawing
     _display.fillScreen(GxEPD_WHITE);
 }
 
 void Display::refresh()
 {
     // Full refresh - complete hardware refresh cycle
-    // Must call setFullWindow before display for proper full refresh
-    _display.setFullWindow();
     _display.display(false);  // false = full refresh mode
+    _refreshes++;
+    _shownValid = false;
+    _policy.record(REFRESH_FULL, 0);
 }
 
 void Display::refreshPartial()
 {
-    // Partial refresh - faster but may have some ghosting
-    _display.setFullWindow();
-    _display.display(true);  // true = partial update mode
+    // Partial refresh - faster but may have some ghosting; a full one
+    // instead once the ghosting budget is spent (what changed isn't known
+    // here, so only the count of partial updates is charged)
+    bool full = !_policy.fits(REFRESH_PARTIAL, 0);
+    _display.display(!full);  // true = partial update mode
+    _refreshes++;
+    _shownValid = false;
+    _policy.record(full ? REFRESH_FULL : REFRESH_PARTIAL, 0, full);
 }
 
 void Display::clearAndRefresh()
 {
     // Force a complete screen clear with full hardware refresh
-    _display.setFullWindow();
     _display.fillScreen(GxEPD_WHITE);
     _display.display(false);
     delay(100);
     _display.fillScreen(GxEPD_WHITE);
     _display.display(false);
+    _refreshes += 2;
+    _shownValid = false;
+    _policy.record(REFRESH_FULL, 0);
+}
+
+RefreshType Display::refreshFrame(const uint8_t* image, uint8_t overlay, RefreshHint hint)
+{
+    static const char* const NAMES[REFRESH_TYPES] = {"skipped", "partial", "fast", "full", "gray4"};
+    FrameRect box = {0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT};
+    uint32_t changed = DISPLAY_WIDTH * DISPLAY_HEIGHT;
+    bool known = _shown && _shownValid && _shownFormat == FRAME_MONO && overlay == _shownOverlay;
+    if (known) changed = frameDiff(_shown, image, DISPLAY_WIDTH, DISPLAY_HEIGHT, box);
+    // Nothing known about the panel: the first frame (after boot, a system
+    // screen or sleep) is a full refresh, which also starts the budget over
+    RefreshType type = known ? _policy.choose(changed, hint) : REFRESH_FULL;
+
+    unsigned long start = millis();
+    if (type == REFRESH_PARTIAL) {
+        // Only the window is sent and driven; the rest of the panel is left alone
+        _display.displayWindow(box.x, box.y, box.w, box.h);
+        _refreshes++;
+    } else if (type != REFRESH_SKIPPED) {
+        if (type == REFRESH_FAST) _display.epd2.selectFast();
+        _display.display(false);
+        _refreshes++;
+    }
+    uint32_t ms = millis() - start;
+    _frameRefreshes[type]++;
+    _frameRefreshMs[type] += ms;
+    _policy.record(type, changed, known && type == REFRESH_FULL && hint != REFRESH_HINT_FULL);
+    LOG_D(DISPLAY, "Frame: %s, %u px changed (%d,%d %dx%d), %u ms, budget %u partial %u fast %u%% ink",
+          NAMES[type], changed, box.x, box.y, box.w, box.h, ms,
+          _policy.partials(), _policy.fasts(), _policy.inkUsedPercent());
+
+    if (_shown) {
+        memcpy(_shown, image, DISPLAY_FRAME_SIZE);
+        _shownValid = true;
+        _shownOverlay = overlay;
+        _shownFormat = FRAME_MONO;
+    }
+    return type;
+}
+
+// One level plane of a gray4 frame into controller RAM, in strips of native
+// rows (the panel is portrait: native row ny is logical column x = ny, native
+// column nx is logical row y = DISPLAY_HEIGHT - 1 - nx, as for setRotation(1))
+void Display::writeGray4Plane(const uint8_t* image, uint8_t bit)
+{
+    const int16_t nativeW = DISPLAY_HEIGHT;
+    const int16_t strip = 16;
+    uint8_t rows[strip * nativeW / 8];
+    for (int16_t x0 = 0; x0 < DISPLAY_WIDTH; x0 += strip) {
+        memset(rows, 0, sizeof(rows));
+        for (int16_t r = 0; r < strip; r++) {
+            int16_t x = x0 + r;
+            const uint8_t* column = image + x / 4;
+            uint8_t shift = 6 - 2 * (x % 4) + bit;
+            uint8_t* out = rows + r * (nativeW / 8);
+            for (int16_t nx = 0; nx < nativeW; nx++) {
+                int16_t y = DISPLAY_HEIGHT - 1 - nx;
+                if ((column[y * (DISPLAY_WIDTH / 4)] >> shift) & 1) out[nx / 8] |= 0x80 >> (nx % 8);
+            }
+        }
+        _display.epd2.writeGray4Rows(bit, rows, x0, strip);
+    }
+}
+
+RefreshType Display::refreshGray4(const uint8_t* image)
+{
+    RefreshType type = REFRESH_SKIPPED;
+    unsigned long start = millis();
+    if (!_shown || !_shownValid || _shownFormat != FRAME_GRAY4 || memcmp(_shown, image, DISPLAY_FRAME_GRAY4_SIZE)) {
+        type = REFRESH_GRAY4;
+        // Wakes and sets the controller up if it was asleep (clearing its RAM)
+        _display.epd2.writeScreenBuffer();
+        writeGray4Plane(image, 0);      // RAM 0x24: low bit
+        writeGray4Plane(image, 1);      // RAM 0x26: high bit
+        _display.epd2.refreshGray4();
+        _refreshes++;
+    }
+    uint32_t ms = millis() - start;
+    _frameRefreshes[type]++;
+    _frameRefreshMs[type] += ms;
+    _policy.record(type, 0);
+    LOG_D(DISPLAY, "Gray frame: %s, %u ms", type == REFRESH_SKIPPED ? "skipped" : "gray4", ms);
+
+    if (_shown) {
+        memcpy(_shown, image, DISPLAY_FRAME_GRAY4_SIZE);
+        _shownValid = true;
+        _shownOverlay = 0;
+        _shownFormat = FRAME_GRAY4;
+    }
+    return type;
 }
 
 void Display::sleep()
 {
+    // The controller loses the previous image it diffs partial updates
+    // against, so the next frame is a full refresh
     _display.hibernate();
+    _shownValid = false;
 }
 
 void Display::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, bool black)
@@ -250,9 +492,17 @@ int16_t Display::getFontHeight()
 
 void Display::drawBitmap(int16_t x, int16_t y, const uint8_t* bitmap, int16_t w, int16_t h, bool rotate180, bool invert)
 {
-    // Draw bitmap pixel by pixel
     // Original code used 180° rotation to compensate for bitmap orientation
     // invert: swap black/white (useful for white logo on black background)
+    unsigned long start = micros();
+    // Straight into the panel buffer in 8x8 blocks (in setRotation(1)
+    // layout) when the image is byte-aligned on it, as full-screen frames are
+    if (blitRotated(_display.buffer(), GxEPD2_290_GDEY029T71H_Modes::WIDTH, GxEPD2_290_GDEY029T71H_Modes::HEIGHT,
+                    x, y, bitmap, w, h, rotate180, invert)) {
+        _lastBlitUs = micros() - start;
+        return;
+    }
+    // Otherwise pixel by pixel
     for (int16_t dy = 0; dy < h; dy++) {
         for (int16_t dx = 0; dx < w; dx++) {
             int srcX, srcY;
@@ -276,6 +526,7 @@ void Display::drawBitmap(int16_t x, int16_t y, const uint8_t* bitmap, int16_t w,
             }
         }
     }
+    _lastBlitUs = micros() - start;
 }
 
 void Display::drawTextGray(int16_t x, int16_t y, const char* text)
@@ -8,8 +8,11 @@
 #define _DISPLAY_H_
 
 #include <Arduino.h>
-#include <GxEPD2_BW.h>
+#include <Adafruit_GFX.h>
+#include <epd/GxEPD2_290_GDEY029T71H.h>
 #include <U8g2_for_Adafruit_GFX.h>
+#include "utility/RefreshPolicy.h"
+#include "utility/FrameFormat.h"
 
 // Pin definitions (from DEV_Config.h)
 #define EPD_SCK_PIN 33
@@ -61,6 +64,73 @@ enum DisplayTextAlign {
 // Alias for backward compatibility
 typedef DisplayTextAlign TextAlign;
 
+// GxEPD2 driver plus two refresh modes from the GDEY029T71H example that
+// GxEPD2 doesn't have, both picked by loading the temperature register so
+// the controller runs another of its OTP waveforms:
+//  - fast full refresh (EPD_HW_Init_Fast + EPD_Update_Fast, 110 °C).
+//    DisplayPanel calls refresh() on this type, so a full display() runs
+//    the fast waveform once after selectFast().
+//  - 4-level gray (EPD_HW_Init_4G + EPD_Update_4G, 90 °C). RAM 0x24 holds
+//    the low bit of each pixel's level and RAM 0x26 the high bit (written
+//    with writeGray4Rows() after writeScreenBuffer() woke the controller),
+//    then refreshGray4().
+class GxEPD2_290_GDEY029T71H_Modes : public GxEPD2_290_GDEY029T71H {
+public:
+    using GxEPD2_290_GDEY029T71H::GxEPD2_290_GDEY029T71H;
+
+    // The next full refresh is a fast one
+    void selectFast() { _fastNext = true; }
+
+    void refresh(bool partial_update_mode = false);
+    void refresh(int16_t x, int16_t y, int16_t w, int16_t h) { GxEPD2_290_GDEY029T71H::refresh(x, y, w, h); }
+
+    // Native rows y..y+h-1 (WIDTH/8 bytes each) of one level plane
+    void writeGray4Rows(bool high, const uint8_t* rows, int16_t y, int16_t h);
+    // Show the two level planes written to the controller RAM
+    void refreshGray4();
+
+private:
+    bool _fastNext = false;
+};
+
+// What GxEPD2_BW does for this panel, full window only: a frame buffer that
+// Adafruit_GFX (and U8g2 through it) draws into, sent whole by display() or
+// a window of it by displayWindow(). Own class because GxEPD2_BW keeps its
+// buffer private and Display::drawBitmap() blits frames straight into it.
+// The buffer is native (portrait) rows, 1 = white; drawing goes through
+// the GFX rotation as with GxEPD2_BW.
+class DisplayPanel : public Adafruit_GFX {
+public:
+    static const size_t BUFFER_SIZE = GxEPD2_290_GDEY029T71H_Modes::WIDTH / 8 * GxEPD2_290_GDEY029T71H_Modes::HEIGHT;
+
+    GxEPD2_290_GDEY029T71H_Modes epd2;
+
+    explicit DisplayPanel(const GxEPD2_290_GDEY029T71H_Modes& driver)
+        : Adafruit_GFX(GxEPD2_290_GDEY029T71H_Modes::WIDTH, GxEPD2_290_GDEY029T71H_Modes::HEIGHT), epd2(driver) {}
+
+    void init(uint32_t serialDiagBitrate, bool initial, uint16_t resetDuration, bool pulldownRstMode) {
+        epd2.init(serialDiagBitrate, initial, resetDuration, pulldownRstMode);
+    }
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+    void fillScreen(uint16_t color) override { memset(_buffer, color == GxEPD_BLACK ? 0x00 : 0xFF, sizeof(_buffer)); }
+
+    // Send the buffer and refresh the whole panel
+    void display(bool partialUpdate = false);
+    // Send and refresh only the window (logical coordinates)
+    void displayWindow(int16_t x, int16_t y, int16_t w, int16_t h);
+    void hibernate() { epd2.hibernate(); }
+
+    uint8_t* buffer() { return _buffer; }
+
+private:
+    uint8_t _buffer[BUFFER_SIZE];
+};
+
+static_assert(GxEPD2_290_GDEY029T71H_Modes::WIDTH == DISPLAY_NATIVE_WIDTH &&
+              GxEPD2_290_GDEY029T71H_Modes::HEIGHT == DISPLAY_NATIVE_HEIGHT, "panel driver is not 168x384");
+static_assert(DisplayPanel::BUFFER_SIZE == DISPLAY_FRAME_SIZE, "panel buffer must hold exactly one mono frame");
+
 class Display {
 public:
     Display();
@@ -80,9 +150,31 @@ public:
     // Force complete screen clear with double refresh
     void clearAndRefresh();
     
+    // Refresh a full-screen frame just drawn into the buffer from `image`
+    // (DISPLAY_WIDTH x DISPLAY_HEIGHT, 1-bit, as given to drawBitmap), by
+    // its difference to the frame on the panel and the ghosting budget
+    // (RefreshPolicy): nothing if it's the same, a partial window around
+    // small changes, a fast refresh for large ones, a full refresh once the
+    // budget is spent. `overlay` tags anything drawn over the image (e.g.
+    // the battery icon); a different tag counts as the whole screen changed.
+    RefreshType refreshFrame(const uint8_t* image, uint8_t overlay = 0, RefreshHint hint = REFRESH_HINT_AUTO);
+    
+    // Show a 4-level gray frame (DISPLAY_WIDTH x DISPLAY_HEIGHT, FRAME_GRAY4)
+    // with the gray waveform, straight from `image` (the drawing buffer is
+    // left alone). Nothing if it's the frame already on the panel.
+    RefreshType refreshGray4(const uint8_t* image);
+    
     // Put display to sleep mode
     void sleep();
     
+    // Panel refreshes (full or partial) since boot
+    uint32_t refreshCount() const { return _refreshes; }
+    
+    // refreshFrame() outcomes and the panel time spent on each type
+    uint32_t frameRefreshes(RefreshType type) const { return _frameRefreshes[type]; }
+    uint32_t frameRefreshMs(RefreshType type) const { return _frameRefreshMs[type]; }
+    const RefreshPolicy& refreshPolicy() const { return _policy; }
+    
     // Drawing primitives
     void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, bool black = true);
     void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, bool black = true);
@@ -106,25 +198,39 @@ public:
     
     // Draw bitmap (for logos) - rotate180 compensates for bitmap orientation, invert swaps black/white
     void drawBitmap(int16_t x, int16_t y, const uint8_t* bitmap, int16_t w, int16_t h, bool rotate180 = false, bool invert = false);
+    // Time the last drawBitmap() took, µs
+    uint32_t lastBlitUs() const { return _lastBlitUs; }
     
     // Accessors
     int16_t width() const { return DISPLAY_WIDTH; }
     int16_t height() const { return DISPLAY_HEIGHT; }
     
     // Direct access if needed
-    GxEPD2_BW<GxEPD2_290_GDEY029T71H, GxEPD2_290_GDEY029T71H::HEIGHT>& getGxEPD() { return _display; }
+    DisplayPanel& getGxEPD() { return _display; }
     U8G2_FOR_ADAFRUIT_GFX& getU8g2() { return _u8g2; }
 
 private:
-    GxEPD2_BW<GxEPD2_290_GDEY029T71H, GxEPD2_290_GDEY029T71H::HEIGHT> _display;
+    DisplayPanel _display;
     U8G2_FOR_ADAFRUIT_GFX _u8g2;
     SPIClass _spi;
     FontSize _currentFontSize;
     int _currentFontPixelSize;  // Current font size in pixels
     bool _textColorBlack;
+    uint32_t _refreshes = 0;
+    uint32_t _lastBlitUs = 0;
+    
+    // Copy of the frame on the panel, valid until anything else is shown
+    uint8_t* _shown = nullptr;
+    bool _shownValid = false;
+    uint8_t _shownOverlay = 0;
+    uint8_t _shownFormat = FRAME_MONO;
+    uint32_t _frameRefreshes[REFRESH_TYPES] = {};
+    uint32_t _frameRefreshMs[REFRESH_TYPES] = {};
+    RefreshPolicy _policy;
     
     void selectU8g2Font(FontSize size);
     void selectU8g2FontByPixelSize(int pixelSize);
+    void writeGray4Plane(const uint8_t* image, uint8_t bit);
 };
 
 // Global display instance
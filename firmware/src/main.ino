@@ -17,7 +17,14 @@ extern const int CURRENT_FIRMWARE_VERSION = FW_VERSION;
 #include "CaptivePortal.h"
 #include "utility/LedColorsAndNoises.h"
 #include "utility/ApiClient.h"
+#include "utility/HeartbeatScheduler.h"
 #include "utility/FirmwareUpdate.h"
+#include "utility/Log.h"
+#include "utility/BootTimeline.h"
+#include "utility/WifiConnect.h"
+#include "utility/BatteryMode.h"
+#include "esp_sntp.h"
+#include "esp_pm.h"
 // BinanceLogo.h and CurrencySymbols.h removed — no predefined logos in v5
 #include "DEV_Config.h"
 
@@ -32,16 +39,23 @@ const int VISUAL_HEIGHT = DISPLAY_HEIGHT;  // 168
 
 // Timing
 const unsigned long POLL_INTERVAL_MS = 3000;
-const unsigned long HEARTBEAT_INTERVAL_MS = 30000;
+const unsigned long HEARTBEAT_INTERVAL_MS = 30000;    // When the server sends refreshInterval 0
+const unsigned long FRAME_RETRY_MS = 15000;           // Retry soon after a failed frame download
 const unsigned long WIFI_CHECK_INTERVAL_MS = 60000;
 const unsigned long OTA_CHECK_INTERVAL_MS = 3600000;
 const unsigned long FIRST_OTA_CHECK_DELAY_MS = 60000; // First OTA check 60s after boot
+const unsigned long PUSH_RETRY_MS = 5000;             // Pause after a failed long-poll
+const unsigned long NET_MIN_IDLE_MS = 50;             // Floor on a network task wait (no spinning)
+const unsigned long PORTAL_POLL_MS = 50;              // A phone is on the softAP (DNS + portal pages)
+const unsigned long PORTAL_IDLE_POLL_MS = 500;        // Otherwise: LAN /metrics and the WiFi join
 
 // Global state
+uint32_t schedulerClock() { return millis(); }
+uint32_t schedulerRandom(uint32_t bound) { return esp_random() % bound; }
 ApiClient apiClient(API_BASE_URL);
+HeartbeatScheduler heartbeatScheduler(schedulerClock, schedulerRandom);  // network task only
 DeviceState currentState = STATE_UNCLAIMED;
 unsigned long lastPollTime = 0;
-unsigned long lastHeartbeatTime = 0;
 unsigned long lastOtaCheckTime = 0;
 unsigned long startTime = 0;
 bool firstOtaCheckDone = false;
@@ -49,31 +63,133 @@ String currentClaimCode = "";
 String lastDisplayedError = "";
 
 // Frame display state (v5: bitmap rotation)
-// Bitmaps stored as PSRAM pointers — allocated once in setup()
-DisplayFrame displayFrames[MAX_DISPLAY_FRAMES];
+// Points at ApiClient's active playlist bank; bitmaps live in its PSRAM frame store
+DisplayFrame* displayFrames = nullptr;
 uint8_t displayFrameCount = 0;
+// Beep/flash one-shots still to fire per frame. Kept here rather than
+// cleared in the bank, which the network task reads when saving or
+// merging the playlist.
+bool frameBeepPending[MAX_DISPLAY_FRAMES];
+uint8_t frameFlashPending[MAX_DISPLAY_FRAMES];
 uint8_t currentFrameIndex = 0;
-uint32_t displayRefreshInterval = 60;
 String displayHash = "";
 unsigned long frameStartTime = 0;      // When current frame started showing
-bool oneShotFired[MAX_DISPLAY_FRAMES]; // Track beep/flash one-shot per download cycle
-bool hasDisplayContent = false;        // True when frames are loaded
+volatile bool hasDisplayContent = false;  // True when frames are loaded (read by the network task)
+BootTimeline bootTimeline;
+uint32_t firstFrameMs = 0;             // Reset -> first customer frame on screen (0 = not yet)
+bool restoredFromFlash = false;        // That frame came from the playlist stored in flash
+uint32_t playlistChangedAtMs = 0;      // New playlist not drawn yet: when it was set on the server
 
-// Rainbow task state
-bool isRainbow = false;
-TaskHandle_t rainbowTaskHandle = NULL;
-void startRainbow();
-void stopRainbow();
-void rainbowTask(void *pvParameters);
+// Battery mode: deep sleep between frame switches and heartbeats
+RTC_DATA_ATTR BatteryState batteryState;
+BatteryMode battery(batteryState);
+bool batteryModeEnabled = false;
 
 // Server connection tracking
 int consecutiveHeartbeatFailures = 0;
-bool isReconnecting = false;
-bool wifiDisconnectedDisplayed = false;
-TaskHandle_t amberPulseTaskHandle = NULL;
+volatile bool isReconnecting = false;
+bool otaInProgress = false;            // OTA screen is up, rotation paused
+
+// Network task (v5): claim, heartbeat and OTA requests run in netTask on the
+// WiFi core and never touch the display, LED or buzzer. Outcomes go to the UI
+// loop through netEvents, so rotation, LED effects and the captive portal keep
+// running while a request blocks or WiFi is down. Bitmaps are shared through
+// ApiClient's playlist banks: after a heartbeat swaps in a new playlist the
+// task waits on playlistAdopted before the next heartbeat can refill the bank
+// the UI may still be drawing from.
+enum NetEventType : uint8_t {
+    NET_WIFI_LOST,
+    NET_WIFI_RESTORED,
+    NET_CLAIM_STARTED,
+    NET_CLAIM_CODE,      // text: claim code
+    NET_CLAIM_FAILED,    // text: error message
+    NET_CLAIMED,
+    NET_CLAIM_EXPIRED,
+    NET_HEARTBEAT,       // heartbeat: result, frames: active playlist
+    NET_OTA_STARTED,
+    NET_OTA_FINISHED     // ok: update installed, rebooting
+};
+
+// text/heartbeat are allocated by the network task and freed by the UI loop
+struct NetEvent {
+    NetEventType type;
+    bool ok;
+    String* text;
+    HeartbeatResult* heartbeat;
+    DisplayFrame* frames;
+};
+
+// Time a task spends working (outside its delays and queue waits). While it
+// works it holds the CPU at full clock; once every task is idle, frequency
+// scaling drops it to 80 MHz.
+struct TaskLoad {
+    uint64_t busyUs = 0;
+    uint32_t maxUs = 0;
+    uint32_t wakes = 0;
+    unsigned long startUs = 0;
+    esp_pm_lock_handle_t cpuLock = nullptr;
+
+    void begin() {
+        if (cpuLock) esp_pm_lock_acquire(cpuLock);
+        wakes++;
+        startUs = micros();
+    }
+    void end() {
+        uint32_t us = micros() - startUs;
+        busyUs += us;
+        if (us > maxUs) maxUs = us;
+        if (cpuLock) esp_pm_lock_release(cpuLock);
+    }
+};
+
+const UBaseType_t NET_EVENT_QUEUE_LEN = 8;
+const uint32_t NET_TASK_STACK = 12288;  // TLS handshake + heartbeat JsonDocument
+QueueHandle_t netEvents = NULL;
+SemaphoreHandle_t playlistAdopted = NULL;
+TaskHandle_t netTaskHandle = NULL;
+TaskHandle_t uiTaskHandle = NULL;
+UBaseType_t netEventsMax = 0;
+TaskLoad netLoad;
+TaskLoad uiLoad;
+
+// Network-task state as the captive portal's /metrics serves it. The portal
+// runs on the UI task, so it never reads heartbeatScheduler, apiClient's
+// timing or netLoad while the network task updates them: the network task
+// copies them here after every pass, and both sides hold netMetricsLock.
+struct NetMetrics {
+    const char* schedState = "normal";
+    uint8_t schedFailures = 0;
+    uint32_t schedOpens = 0;
+    uint32_t schedIntervalMs = 0;
+    TaskLoad load;
+    NetTiming timing;
+};
+NetMetrics netMetrics;
+SemaphoreHandle_t netMetricsLock = NULL;
+
+// Neither loop polls on a fixed tick: each blocks on its event group until
+// something is due. The UI loop wakes for network events, the frame timer,
+// softAP joins/leaves and the portal poll (DNS/HTTP have no socket callbacks);
+// the network task for WiFi changes and its next heartbeat / poll / OTA check.
+#define UI_WAKE_NET     BIT0    // netEvents has something
+#define UI_WAKE_FRAME   BIT1    // frame on screen is due to switch
+#define UI_WAKE_WIFI    BIT2    // station or softAP client came or went
+#define UI_WAKE_ALL     (UI_WAKE_NET | UI_WAKE_FRAME | UI_WAKE_WIFI)
+#define NET_WAKE_WIFI   BIT0
+EventGroupHandle_t uiWake = NULL;
+EventGroupHandle_t netWake = NULL;
+TimerHandle_t frameTimer = NULL;
+
+// Automatic light sleep between wakes. Off by default: the softAP keeps the
+// radio (and with it the CPU) awake anyway, and LEDC stops in light sleep,
+// which would blank the frame LED.
+#ifndef UI_LIGHT_SLEEP
+#define UI_LIGHT_SLEEP 0
+#endif
 
 // Battery reading
 const float BATTERY_MULTIPLIER = 2.19f;
+volatile int batteryPercent = 100;     // Read at boot and with every heartbeat
 
 int getBatteryPercent() {
     int raw = analogRead(35);
@@ -95,12 +211,46 @@ void drawBatteryIcon(int x, int y) {
 void initializeDisplay();
 void displayClaimCode(const char *code);
 void displayFrameFullScreen(uint8_t frameIndex);
+void displayBootScreen();
 void displayWaitingForContent();
 void displayWifiMessage();
 void displayError(const char *msg);
 void displaySystemScreen(const char* tag, const char* line1, const char* line2);
-void handleApiStateMachine();
+void startNtp();
+void onNtpSync(struct timeval *tv);
+void startUiEvents();
+void onFrameTimer(TimerHandle_t timer);
+void onWifiEvent(arduino_event_id_t event);
+void startFrameTimer();
+void configurePowerManagement();
+uint32_t portalPollMs();
+uint32_t networkIdleMs();
+void startNetworkTask();
+void netTask(void *pvParameters);
+void networkStep();
+void postNetEvent(const NetEvent& ev);
+void addDisplayRefreshes(JsonObject out);
+void addAppTelemetry(JsonObject telemetry);
+void addTelemetry(JsonObject telemetry, const NetMetrics& net);
+void captureNetMetrics(NetMetrics& out);
+void publishNetMetrics();
+void writeMetrics(String& json);
+void handleNetEvent(NetEvent& ev);
+void handleHeartbeatResult(HeartbeatResult& result, DisplayFrame* frames);
+bool adoptStoredPlaylist();
+uint32_t heartbeatIntervalMs(uint32_t refreshIntervalSec);
+bool showStoredPlaylist();
+uint8_t nextValidFrame(uint8_t from);
+uint64_t frameDueAfter(uint8_t frameIndex, uint64_t shownMs);
+uint32_t batteryHeartbeatIntervalMs();
+void runBatteryWake();
+void batteryHeartbeat();
+void maybeEnterBatterySleep();
+void updateDisplay();
+void armFrameOneShots();
 void applyFrameLedBeep(uint8_t frameIndex);
+void setFrameLed(const DisplayFrame& f);
+void playOneShot(bool beep, uint8_t flashCount, const String& color);
 void led_Purple();
 void led_Green();
 void led_Red();
@@ -110,20 +260,19 @@ void led_Off();
 void setLedBrightness(const String& brightness);
 void playBuzzerPositive();
 void playBuzzerNegative();
+void playFrameBeep(const ToneStep* tones, uint8_t toneCount, MelodyId melody);
 void initializePins();
 
 // Demo mode functions
 void renderDemoHeader();
 void renderDemoUptime();
 void runDemoLoop();
-void demoLedTask(void *pvParameters);
 
 // IP address display
 void displayIPAddress();
 
 // Reconnecting state functions
 void displayReconnecting();
-void amberPulseTask(void *pvParameters);
 void startAmberPulse();
 void stopAmberPulse();
 
@@ -155,6 +304,19 @@ void displaySystemScreen(const char* tag, const char* line1, const char* line2)
     }
 }
 
+// Boot screen — simple text, no Binance logo
+void displayBootScreen() {
+    display.clear();
+    display.setFontSize(32);
+    display.setTextColor(true);
+    int textW = display.getTextWidth("TigerMeter");
+    display.drawText((384 - textW) / 2, (168 - display.getFontHeight()) / 2 - 10, "TigerMeter");
+    display.setFontSize(16);
+    const char* ver = FIRMWARE_VERSION;
+    int verW = display.getTextWidth(ver);
+    display.drawText((384 - verW) / 2, (168 - display.getFontHeight()) / 2 + 15, ver);
+}
+
 void displayWaitingForContent() {
     displaySystemScreen("...", NULL, "Waiting for");
     display.setFontSize(16);
@@ -193,185 +355,221 @@ void displayFrameFullScreen(uint8_t frameIndex) {
     if (frameIndex >= displayFrameCount) return;
     if (displayFrames[frameIndex].durationSec == 0) return; // Invalid/skipped frame
 
-    display.clear();
-    display.drawBitmap(0, 0, displayFrames[frameIndex].bitmap, DISPLAY_WIDTH, DISPLAY_HEIGHT, false, false);
-    display.refresh();
+    const DisplayFrame& f = displayFrames[frameIndex];
+    if (f.format == FRAME_GRAY4) {
+        // Gray levels go straight to the panel RAM (no low battery icon)
+        display.refreshGray4(f.bitmap);
+    } else {
+        bool lowBattery = batteryPercent < 5;
+        display.clear();
+        display.drawBitmap(0, 0, f.bitmap, DISPLAY_WIDTH, DISPLAY_HEIGHT, false, false);
+        if (lowBattery) drawBatteryIcon(5, 5);  // Low battery warning
+        // Only what changed since the frame on the panel (nothing, if it's the same)
+        display.refreshFrame(f.bitmap, lowBattery, (RefreshHint)f.refreshHint);
+    }
+    if (playlistChangedAtMs) {
+        apiClient.notePlaylistShown(playlistChangedAtMs);
+        playlistChangedAtMs = 0;
+    }
+    if (firstFrameMs == 0) {
+        firstFrameMs = millis();
+        LOG_I(MAIN, "First frame on screen %lu ms after boot", (unsigned long)firstFrameMs);
+    }
 
-    Serial.printf("[Main] Drawing frame %d/%d (duration=%us)\n",
-                  frameIndex + 1, displayFrameCount, displayFrames[frameIndex].durationSec);
+    LOG_D(MAIN, "Drawing frame %d/%d (duration=%us)",
+          frameIndex + 1, displayFrameCount, displayFrames[frameIndex].durationSec);
 }
 
-// Apply LED color, beep, flash for a given frame (one-shot per download cycle)
+// Set LED color + brightness (or keyframe sequence) for a frame
+void setFrameLed(const DisplayFrame& f) {
+    setLedBrightness(String(f.ledBrightness));
+    LedRgb color;
+    if (!strcmp(f.ledBrightness, "off")) {
+        led_Off();
+    } else if (f.ledKeyframeCount > 0) {
+        playLedSequence(f.ledKeyframes, f.ledKeyframeCount);
+    } else if (!strcmp(f.ledColor, "rainbow")) {
+        rainbowCycle(6000);
+    } else if (ledColorFromName(f.ledColor, color)) {
+        setLedColor(color, ledBrightness);
+    } else {
+        led_Off();
+    }
+}
+
+// Beep and/or flash the LED over its steady colour (neither blocks)
+void playOneShot(bool beep, uint8_t flashCount, const String& color) {
+    if (beep) {
+        playBuzzerPositive();
+    }
+    if (flashCount > 0) {
+        pulseColorByName(color, flashCount, 800);
+    }
+}
+
+// Arm the beep/flash one-shots of the playlist just put on display
+void armFrameOneShots() {
+    for (uint8_t i = 0; i < MAX_DISPLAY_FRAMES; i++) {
+        frameBeepPending[i] = i < displayFrameCount && displayFrames[i].beep;
+        frameFlashPending[i] = i < displayFrameCount ? displayFrames[i].flashCount : 0;
+    }
+}
+
+// Apply LED color for a frame and fire its pending beep/flash. One-shots are
+// consumed in frameBeepPending/frameFlashPending, so rotation doesn't repeat
+// them; the next playlist or metadata update re-arms them. The bank itself
+// is only read.
 void applyFrameLedBeep(uint8_t frameIndex) {
     if (frameIndex >= displayFrameCount) return;
 
-    DisplayFrame& f = displayFrames[frameIndex];
-    String color = String(f.ledColor);
-    String brightness = String(f.ledBrightness);
+    const DisplayFrame& f = displayFrames[frameIndex];
+    setFrameLed(f);
 
-    // Always set LED color + brightness for this frame
-    stopRainbow();
-    setLedBrightness(brightness);
-    if (brightness == "off") {
-        led_Off();
-    } else if (color == "rainbow") {
-        startRainbow();
-    } else if (color == "green") led_Green();
-    else if (color == "red") led_Red();
-    else if (color == "blue") led_Blue();
-    else if (color == "yellow") led_Yellow();
-    else if (color == "purple") led_Purple();
-    else if (color == "cyan" || color == "magenta" || color == "white") led_Green(); // Fallback
-    else led_Off();
-
-    // One-shot beep/flash (fire only first time after download)
-    if (!oneShotFired[frameIndex]) {
-        oneShotFired[frameIndex] = true;
-
-        if (f.beep) {
-            playBuzzerPositive();
-        }
-        if (f.flashCount > 0) {
-            for (int i = 0; i < f.flashCount; i++) {
-                pulseColorByName(color, 800);
-                if (i < f.flashCount - 1) delay(100);
-            }
-            // Restore LED
-            setLedBrightness(brightness);
-            if (brightness == "off") {
-                led_Off();
-            } else if (color == "rainbow") startRainbow();
-            else if (color == "green") led_Green();
-            else if (color == "red") led_Red();
-            else if (color == "blue") led_Blue();
-            else if (color == "yellow") led_Yellow();
-            else if (color == "purple") led_Purple();
-            else led_Off();
-        }
+    if (frameBeepPending[frameIndex] || frameFlashPending[frameIndex] > 0) {
+        if (frameBeepPending[frameIndex]) playFrameBeep(f.tones, f.toneCount, f.melody);
+        playOneShot(false, frameFlashPending[frameIndex], String(f.ledColor));
+        frameBeepPending[frameIndex] = false;
+        frameFlashPending[frameIndex] = 0;
     }
 }
 
 void setup()
 {
+    // UART driver TX buffer: logDrain() hands over what fits and the ISR sends it
+    Serial.setTxBufferSize(1024);
     Serial.begin(115200);
     delay(100);
 
-    Serial.println("[Main] Starting TigerMeter v5 (API MODE)...");
+    LOG_I(MAIN, "Starting TigerMeter v5 (API MODE)...");
 
     startTime = millis();
 
+    // Woken from a battery-mode sleep: draw / heartbeat whatever is due and
+    // go back to sleep, without the LED, portal or network task
+    if (battery.resumed()) {
+        runBatteryWake();
+        // runBatteryWake never returns
+    }
+    battery.stop();
+    batteryPercent = getBatteryPercent();
+    startUiEvents();
+
+    // Boot: each phase is timed (telemetry "boot" in the first heartbeat), and
+    // the screen is refreshed once — the stored playlist, the boot screen, or
+    // the WiFi setup screen when there is no network to join. WiFi associates
+    // in the background while that refresh runs.
+
     // Initialize LEDC for LED PWM control
+    bootTimeline.begin(BOOT_LEDC);
     initializePins();
 
     // Immediately set LED to dim yellow (10% brightness)
-    setLedPWM(229, 247, 255);
+    setLedColor(LED_RGB_YELLOW, 26);
+    bootTimeline.end(BOOT_LEDC);
 
-    // Initialize e-paper display
-    Serial.println("[Main] Initializing e-paper display...");
+    // Initialize e-paper display (no refresh yet)
+    LOG_D(MAIN, "Initializing e-paper display...");
+    bootTimeline.begin(BOOT_DISPLAY);
     initializeDisplay();
-    Serial.println("[Main] Display initialized");
+    bootTimeline.end(BOOT_DISPLAY);
+    LOG_D(MAIN, "Display initialized");
 
-    // Allocate PSRAM buffers for display frames
-    Serial.println("[Main] Allocating PSRAM frame buffers...");
-    for (int i = 0; i < MAX_DISPLAY_FRAMES; i++) {
-        displayFrames[i].bitmap = (uint8_t*)ps_malloc(DISPLAY_FRAME_SIZE);
-        if (!displayFrames[i].bitmap) {
-            Serial.printf("[Main] ERROR: PSRAM alloc failed for frame %d\n", i);
-        }
-        displayFrames[i].durationSec = 0;
-        displayFrames[i].ledColor[0] = '\0';
-        displayFrames[i].ledBrightness[0] = '\0';
-        displayFrames[i].beep = false;
-        displayFrames[i].flashCount = 0;
+    // Check if demo mode is enabled locally, and whether there is a network to join
+    bool wifiConfigured;
+    {
+        Preferences bootPrefs;
+        bootPrefs.begin("tigermeter", true);
+        localDemoMode = bootPrefs.getBool("demoMode", false);
+        wifiConfigured = bootPrefs.getString("ssid", "").length() > 0;
+        batteryModeEnabled = bootPrefs.getBool("batteryMode", false);
+        bootPrefs.end();
     }
-    Serial.printf("[Main] PSRAM free: %u bytes\n", ESP.getFreePsram());
-
-    // Show boot screen — simple text, no Binance logo
-    display.clear();
-    display.setFontSize(32);
-    display.setTextColor(true);
-    int textW = display.getTextWidth("TigerMeter");
-    display.drawText((384 - textW) / 2, (168 - display.getFontHeight()) / 2 - 10, "TigerMeter");
-    display.setFontSize(16);
-    const char* ver = FIRMWARE_VERSION;
-    int verW = display.getTextWidth(ver);
-    display.drawText((384 - verW) / 2, (168 - display.getFontHeight()) / 2 + 15, ver);
-    display.refresh();
-    Serial.println("[Main] Boot screen displayed");
 
-    // Fade in yellow LED
-    fadeInYellow(2000);
+    // Initialize API client (credentials, frame cache, stored playlist)
+    bootTimeline.begin(BOOT_PSRAM);
+    apiClient.begin();
+    bootTimeline.end(BOOT_PSRAM);
+    LOG_D(MAIN, "PSRAM free: %u bytes", ESP.getFreePsram());
 
-    // Start captive portal AP + OTA
+    // Start captive portal AP + OTA; joins the stored network
+    if (wifiConfigured) bootTimeline.begin(BOOT_WIFI);
+    bootTimeline.begin(BOOT_PORTAL);
     startCaptivePortal();
-
-    // Check if demo mode is enabled locally
-    {
-        Preferences demoPrefs;
-        demoPrefs.begin("tigermeter", true);
-        localDemoMode = demoPrefs.getBool("demoMode", false);
-        demoPrefs.end();
-    }
+    bootTimeline.end(BOOT_PORTAL);
 
     if (localDemoMode) {
-        Serial.println("[Main] Demo mode enabled, starting demo loop...");
+        LOG_I(MAIN, "Demo mode enabled, starting demo loop...");
         playBuzzerPositive();
-        xTaskCreatePinnedToCore(demoLedTask, "demoLed", 2048, NULL, 1, NULL, 1);
+        rainbowCycle(6000);
         runDemoLoop();
         // runDemoLoop never returns
     }
 
-    // Show WiFi message
-    displayWifiMessage();
-    display.refresh();
-    Serial.println("[Main] WiFi message displayed");
+    // Last playlist from flash goes up right away, without waiting for WiFi
+    bootTimeline.begin(BOOT_PAINT);
+    bool restored = showStoredPlaylist();
+    if (!restored) {
+        if (wifiConfigured) {
+            displayBootScreen();
+        } else {
+            displayWifiMessage();
+        }
+        display.refresh();
+        LOG_D(MAIN, "%s screen displayed", wifiConfigured ? "Boot" : "WiFi");
+    }
+    bootTimeline.end(BOOT_PAINT);
 
-    // Try to connect using stored credentials
+    // Fade in yellow LED
+    if (!restored) fadeInYellow(2000);
+
+    // Wait for the stored network (a restored playlist keeps rotating)
     unsigned long startAttemptTime = millis();
     const unsigned long connectionTimeout = 20000;
-    while (WiFi.status() != WL_CONNECTED && millis() - startAttemptTime < connectionTimeout)
+    while (wifiConfigured && WiFi.status() != WL_CONNECTED && millis() - startAttemptTime < connectionTimeout)
     {
         captivePortalLoop();
+        logDrain();
+        updateDisplay();
         delay(100);
     }
 
-    // Initialize API client
-    apiClient.begin();
-
-    // Initialize NTP time if WiFi is connected
     if (WiFi.status() == WL_CONNECTED) {
-        displayIPAddress();
-        delay(1000);
-        Serial.println("[Main] WiFi connected, initializing NTP...");
-        configTime(0, 0, "pool.ntp.org", "time.nist.gov");
-        int ntpWait = 0;
-        while (time(nullptr) < 1000000000 && ntpWait < 50) {
-            delay(100);
-            ntpWait++;
-        }
-        if (time(nullptr) > 1000000000) {
-            Serial.println("[Main] NTP time synchronized");
-        } else {
-            Serial.println("[Main] NTP sync timeout, will retry later");
-        }
+        bootTimeline.end(BOOT_WIFI);
+        startNtp();
+    } else if (!restored && wifiConfigured) {
+        // Couldn't join: the boot screen gives way to the setup hint
+        led_Yellow();
+        displayWifiMessage();
+        display.refresh();
     }
 
     // Check if we have stored credentials
     if (apiClient.hasCredentials()) {
         currentState = STATE_ACTIVE;
-        Serial.println("[Main] Found stored credentials, entering ACTIVE state");
-        led_Green();
+        LOG_I(MAIN, "Found stored credentials, entering ACTIVE state");
+        if (!restored) led_Green();
     } else {
         currentState = STATE_UNCLAIMED;
-        Serial.println("[Main] No credentials, entering UNCLAIMED state");
+        LOG_I(MAIN, "No credentials, entering UNCLAIMED state");
     }
 
-    // Main loop
+    // Main loop: UI only, networking runs in netTask. Sleeps until an event
+    // or the portal poll is due.
+    configurePowerManagement();
+    startNetworkTask();
     while (1)
     {
+        xEventGroupWaitBits(uiWake, UI_WAKE_ALL, pdTRUE, pdFALSE, pdMS_TO_TICKS(portalPollMs()));
+        uiLoad.begin();
         captivePortalLoop();
-        handleApiStateMachine();
-        delay(50);
+        logDrain();
+        NetEvent ev;
+        while (xQueueReceive(netEvents, &ev, 0) == pdTRUE) {
+            handleNetEvent(ev);
+        }
+        updateDisplay();
+        maybeEnterBatterySleep();
+        uiLoad.end();
     }
 }
 
@@ -380,34 +578,187 @@ void loop()
     // Not used in API mode
 }
 
-void handleApiStateMachine()
+// SNTP syncs in the background; nothing at boot waits for it
+void startNtp()
 {
-    unsigned long now = millis();
+    static bool started = false;
+    if (started) return;
+    started = true;
+    bootTimeline.begin(BOOT_NTP);
+    sntp_set_time_sync_notification_cb(onNtpSync);
+    configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+    LOG_D(MAIN, "NTP started");
+}
+
+void onNtpSync(struct timeval *tv)
+{
+    (void)tv;
+    if (!bootTimeline.ended(BOOT_NTP)) {
+        bootTimeline.end(BOOT_NTP);
+        LOG_I(MAIN, "NTP time synchronized");
+    }
+}
+
+// Event group and frame timer the UI loop waits on; WiFi events wake both loops
+void startUiEvents()
+{
+    uiWake = xEventGroupCreate();
+    netWake = xEventGroupCreate();
+    frameTimer = xTimerCreate("frame", 1, pdFALSE, NULL, onFrameTimer);
+    WiFi.onEvent(onWifiEvent);
+}
+
+void onFrameTimer(TimerHandle_t timer)
+{
+    (void)timer;
+    xEventGroupSetBits(uiWake, UI_WAKE_FRAME);
+}
+
+void onWifiEvent(arduino_event_id_t event)
+{
+    switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+        xEventGroupSetBits(netWake, NET_WAKE_WIFI);
+        xEventGroupSetBits(uiWake, UI_WAKE_WIFI);
+        break;
+    case ARDUINO_EVENT_WIFI_AP_STACONNECTED:
+    case ARDUINO_EVENT_WIFI_AP_STADISCONNECTED:
+        xEventGroupSetBits(uiWake, UI_WAKE_WIFI);
+        break;
+    default:
+        break;
+    }
+}
 
-    // Check WiFi periodically
-    if (WiFi.status() != WL_CONNECTED)
+// The frame on screen starts now; the frame timer wakes the UI loop when it's
+// due (right away for a frame without a bitmap, which is skipped)
+void startFrameTimer()
+{
+    frameStartTime = millis();
+    if (!frameTimer) return;
+    uint32_t ms = currentFrameIndex < displayFrameCount ? displayFrames[currentFrameIndex].durationSec * 1000UL : 0;
+    xTimerChangePeriod(frameTimer, pdMS_TO_TICKS(ms) + 1, 0);
+}
+
+// Frequency scaling: 240 MHz while a task holds its TaskLoad lock, 80 MHz
+// when all are idle. Needs CONFIG_PM_ENABLE in the core's sdkconfig; without
+// it the device just stays at 240 MHz.
+void configurePowerManagement()
+{
+    esp_pm_config_esp32_t pm = {};
+    pm.max_freq_mhz = 240;
+    pm.min_freq_mhz = 80;
+    pm.light_sleep_enable = UI_LIGHT_SLEEP;
+    esp_err_t err = esp_pm_configure(&pm);
+    if (err != ESP_OK) {
+        LOG_W(MAIN, "Power management unavailable (%s), staying at 240 MHz", esp_err_to_name(err));
+        return;
+    }
+    esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "ui", &uiLoad.cpuLock);
+    esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "net", &netLoad.cpuLock);
+    LOG_I(MAIN, "Power management: 80-240 MHz, light sleep %s", UI_LIGHT_SLEEP ? "on" : "off");
+}
+
+// DNS answers and portal pages need polling; quickly only while a phone is on the softAP
+uint32_t portalPollMs()
+{
+    return WiFi.softAPgetStationNum() > 0 ? PORTAL_POLL_MS : PORTAL_IDLE_POLL_MS;
+}
+
+// ============== NETWORK TASK ==============
+// Post an outcome to the UI loop; blocks while the queue is full
+void postNetEvent(const NetEvent& ev)
+{
+    xQueueSend(netEvents, &ev, portMAX_DELAY);
+    xEventGroupSetBits(uiWake, UI_WAKE_NET);
+    UBaseType_t depth = uxQueueMessagesWaiting(netEvents);
+    if (depth > netEventsMax) netEventsMax = depth;
+}
+
+void startNetworkTask()
+{
+    netEvents = xQueueCreate(NET_EVENT_QUEUE_LEN, sizeof(NetEvent));
+    playlistAdopted = xSemaphoreCreateBinary();
+    netMetricsLock = xSemaphoreCreateMutex();
+    uiTaskHandle = xTaskGetCurrentTaskHandle();
+    apiClient.setTelemetryHook(addAppTelemetry);
+    setPortalMetricsWriter(writeMetrics);
+    // Core 0 runs the WiFi/lwIP stack; the Arduino (UI) task is on core 1
+    xTaskCreatePinnedToCore(netTask, "net", NET_TASK_STACK, NULL, 1, &netTaskHandle, 0);
+    LOG_I(MAIN, "Started network task");
+}
+
+void netTask(void *pvParameters)
+{
+    (void)pvParameters;
+    // setup() already put up the screen for the state WiFi is in
+    bool wifiLost = WiFi.status() != WL_CONNECTED;
+    for (;;)
     {
-        if (!wifiDisconnectedDisplayed) {
-            led_Yellow();
-            displayWifiMessage();
-            display.refresh();
-            wifiDisconnectedDisplayed = true;
+        if (WiFi.status() != WL_CONNECTED) {
+            if (!wifiLost) {
+                wifiLost = true;
+                postNetEvent({NET_WIFI_LOST});
+            }
+        } else {
+            if (wifiLost) {
+                wifiLost = false;
+                bootTimeline.end(BOOT_WIFI);
+                startNtp();
+                postNetEvent({NET_WIFI_RESTORED});
+            }
+            netLoad.begin();
+            networkStep();
+            netLoad.end();
         }
-        return;
+        publishNetMetrics();
+        logDrain();
+        // Until the next thing is due, or WiFi comes or goes
+        uint32_t idle = wifiLost ? WIFI_CHECK_INTERVAL_MS : networkIdleMs();
+        if (idle < NET_MIN_IDLE_MS) idle = NET_MIN_IDLE_MS;
+        xEventGroupWaitBits(netWake, NET_WAKE_WIFI, pdTRUE, pdFALSE, pdMS_TO_TICKS(idle));
     }
-    if (wifiDisconnectedDisplayed) {
-        displayIPAddress();
+}
+
+// Time until networkStep() has something to do
+uint32_t networkIdleMs()
+{
+    unsigned long now = millis();
+    switch (currentState)
+    {
+    case STATE_WAITING_ATTACH:
+    {
+        unsigned long elapsed = now - lastPollTime;
+        return elapsed >= POLL_INTERVAL_MS ? 0 : POLL_INTERVAL_MS - elapsed;
     }
-    wifiDisconnectedDisplayed = false;
+    case STATE_ACTIVE:
+    {
+        // Same conditions as the OTA check in networkStep()
+        unsigned long otaDue = !firstOtaCheckDone && OtaUpdate::getLatestVersion() > 0
+            ? startTime + FIRST_OTA_CHECK_DELAY_MS
+            : lastOtaCheckTime + OTA_CHECK_INTERVAL_MS;
+        long untilOta = (long)(otaDue - now);
+        uint32_t idle = heartbeatScheduler.msUntilDue();
+        if (untilOta <= 0) return 0;
+        return (uint32_t)untilOta < idle ? (uint32_t)untilOta : idle;
+    }
+    default:
+        return 0;
+    }
+}
+
+// One pass of the claim / heartbeat / OTA state machine (network task only)
+void networkStep()
+{
+    unsigned long now = millis();
 
     switch (currentState)
     {
     case STATE_UNCLAIMED:
     {
-        Serial.println("[Main] STATE_UNCLAIMED - issuing claim...");
-        if (lastDisplayedError.isEmpty()) {
-            led_Blue();
-        }
+        LOG_I(NET, "STATE_UNCLAIMED - issuing claim...");
+        postNetEvent({NET_CLAIM_STARTED});
 
         ClaimResult result = apiClient.issueClaim();
 
@@ -415,22 +766,13 @@ void handleApiStateMachine()
         {
             currentClaimCode = result.code;
             currentState = STATE_CLAIMING;
-            lastDisplayedError = "";
-            led_Blue();
-            displayClaimCode(result.code.c_str());
-            display.refresh();
-            Serial.println("[Main] Got claim code: " + result.code);
-            playBuzzerPositive();
+            LOG_I(NET, "Got claim code: %s", result.code.c_str());
+            postNetEvent({NET_CLAIM_CODE, true, new String(result.code)});
         }
         else
         {
-            Serial.println("[Main] Claim failed: " + result.errorMessage);
-            if (lastDisplayedError != result.errorMessage) {
-                lastDisplayedError = result.errorMessage;
-                displayError(result.errorMessage.c_str());
-                display.refresh();
-            }
-            led_Yellow();
+            LOG_W(NET, "Claim failed: %s", result.errorMessage.c_str());
+            postNetEvent({NET_CLAIM_FAILED, false, new String(result.errorMessage)});
             delay(5000);
         }
         break;
@@ -446,37 +788,22 @@ void handleApiStateMachine()
         if (now - lastPollTime >= POLL_INTERVAL_MS)
         {
             lastPollTime = now;
-            led_Blue();
 
             PollResult result = apiClient.pollClaim();
 
             if (result.claimed)
             {
                 currentState = STATE_ACTIVE;
-                Serial.println("[Main] Claimed! Device ID: " + result.deviceId);
-                led_Green();
-                playBuzzerPositive();
-
-                displaySystemScreen("OK", "Connected!", NULL);
-                display.refresh();
-                delay(2000);
-
-                lastHeartbeatTime = 0;
-                hasDisplayContent = false;
-                displayFrameCount = 0;
-                for (int i = 0; i < MAX_DISPLAY_FRAMES; i++) oneShotFired[i] = false;
-            }
-            else if (result.pending)
-            {
-                led_Blue();
+                LOG_I(NET, "Claimed! Device ID: %s", result.deviceId.c_str());
+                heartbeatScheduler.reset();
+                postNetEvent({NET_CLAIMED});
             }
             else if (result.expired || result.notFound)
             {
-                Serial.println("[Main] Claim expired/consumed, restarting...");
+                LOG_I(NET, "Claim expired/consumed, restarting...");
                 currentClaimCode = "";
                 currentState = STATE_UNCLAIMED;
-                lastDisplayedError = "Claim expired";
-                led_Yellow();
+                postNetEvent({NET_CLAIM_EXPIRED});
             }
         }
         break;
@@ -485,181 +812,61 @@ void handleApiStateMachine()
     case STATE_ACTIVE:
     {
         // Send heartbeats
-        unsigned long heartbeatIntervalMs = (displayRefreshInterval > 0)
-            ? (displayRefreshInterval * 1000UL)
-            : HEARTBEAT_INTERVAL_MS;
-        if (now - lastHeartbeatTime >= heartbeatIntervalMs || lastHeartbeatTime == 0)
+        if (heartbeatScheduler.due())
         {
-            lastHeartbeatTime = now;
-
             int uptimeSeconds = (now - startTime) / 1000;
             int rssi = WiFi.RSSI();
-            int battery = getBatteryPercent();
+            batteryPercent = getBatteryPercent();
 
             bool forceRefresh = !hasDisplayContent || isReconnecting;
-            HeartbeatResult result = apiClient.sendHeartbeat(battery, rssi, uptimeSeconds, forceRefresh);
-
-            // Factory reset
-            if (result.factoryReset)
-            {
-                Serial.println("[Main] Remote factory reset requested!");
-                led_Red();
-                playBuzzerNegative();
-
-                displaySystemScreen("RST", "Factory Reset", "Rebooting...");
-                display.refresh();
-                delay(2000);
-
-                Preferences prefs;
-                prefs.begin("tigermeter", false);
-                prefs.clear();
-                prefs.end();
+            bootTimeline.begin(BOOT_HEARTBEAT);
+            HeartbeatResult* result = new HeartbeatResult(apiClient.sendHeartbeat(batteryPercent, rssi, uptimeSeconds, forceRefresh));
 
-                Serial.println("[Main] All data cleared, rebooting...");
-                ESP.restart();
-            }
-
-            // Demo mode toggle
-            if (result.demoMode != localDemoMode)
-            {
-                Serial.printf("[Main] Demo mode changed remotely: %s\n", result.demoMode ? "ON" : "OFF");
-
-                Preferences prefs;
-                prefs.begin("tigermeter", false);
-                prefs.putBool("demoMode", result.demoMode);
-                prefs.end();
-
-                displaySystemScreen("DEMO", result.demoMode ? "Demo Enabled" : "Demo Disabled", "Rebooting...");
-                display.refresh();
-
-                if (result.demoMode) playBuzzerPositive();
-                delay(2000);
-                ESP.restart();
-            }
-
-            if (result.success)
+            if (result->success)
             {
-                consecutiveHeartbeatFailures = 0;
-
-                if (isReconnecting) {
-                    Serial.println("[Main] Connection restored!");
-                    stopAmberPulse();
-                    isReconnecting = false;
+                bootTimeline.end(BOOT_HEARTBEAT);
+                OtaUpdate::setAutoUpdate(result->autoUpdate);
+                OtaUpdate::setLatestVersion(result->latestFirmwareVersion);
+                if (result->firmwareDownloadUrl.length() > 0) {
+                    OtaUpdate::setFirmwareUrl(result->firmwareDownloadUrl);
                 }
-
-                OtaUpdate::setAutoUpdate(result.autoUpdate);
-                OtaUpdate::setLatestVersion(result.latestFirmwareVersion);
-                if (result.firmwareDownloadUrl.length() > 0) {
-                    OtaUpdate::setFirmwareUrl(result.firmwareDownloadUrl);
+                if (result->hasNewDisplay) {
+                    heartbeatScheduler.setInterval(heartbeatIntervalMs(result->refreshInterval));
                 }
-
-                // --- NEW DISPLAY DATA ---
-                if (result.hasNewDisplay && result.frameCount > 0)
-                {
-                    Serial.printf("[Main] New display: %d frames, interval=%us\n", result.frameCount, result.refreshInterval);
-
-                    // Copy frames to local buffer
-                    displayFrameCount = result.frameCount;
-                    displayRefreshInterval = result.refreshInterval;
-                    displayHash = result.displayHash;
-                    hasDisplayContent = true;
-
-                    // Copy frames (each is 8064 bytes)
-                    for (int i = 0; i < result.frameCount; i++) {
-                        memcpy(displayFrames[i].bitmap, result.frames[i].bitmap, DISPLAY_FRAME_SIZE);
-                        strncpy(displayFrames[i].ledColor, result.frames[i].ledColor, 15);
-                        displayFrames[i].ledColor[15] = '\0';
-                        strncpy(displayFrames[i].ledBrightness, result.frames[i].ledBrightness, 7);
-                        displayFrames[i].ledBrightness[7] = '\0';
-                        displayFrames[i].durationSec = result.frames[i].durationSec;
-                        displayFrames[i].beep = result.frames[i].beep;
-                        displayFrames[i].flashCount = result.frames[i].flashCount;
-                    }
-
-                    // Reset rotation + one-shot tracking
-                    currentFrameIndex = 0;
-                    frameStartTime = now;
-                    for (int i = 0; i < MAX_DISPLAY_FRAMES; i++) oneShotFired[i] = false;
-
-                    // Draw first frame
-                    if (displayFrames[0].durationSec > 0) {
-                        displayFrameFullScreen(0);
-                        applyFrameLedBeep(0);
-                    }
-                }
-                else if (result.hasNewDisplay && result.frameCount == 0) {
-                    // Empty frames — "waiting for content"
-                    hasDisplayContent = false;
-                    displayFrameCount = 0;
-                    displayRefreshInterval = result.refreshInterval;
-                    displayWaitingForContent();
-                    display.refresh();
-                    led_Off();
-                    stopRainbow();
+                heartbeatScheduler.onSuccess(result->nextPollSec * 1000UL);
+                // New content is waiting on the server but its frames didn't arrive
+                if (result->errorMessage.length() > 0) {
+                    heartbeatScheduler.expectChangeIn(FRAME_RETRY_MS);
                 }
-                // else: no new display data, just keep rotating
             }
-            else if (result.httpCode == 401 || result.httpCode == 403)
+            else if (result->httpCode == 401 || result->httpCode == 403)
             {
-                const char* reason = result.httpCode == 403 ? "Device revoked" : "Auth expired";
-                Serial.printf("[Main] %s, restarting claim...\n", reason);
-                consecutiveHeartbeatFailures = 0;
-                if (isReconnecting) {
-                    stopAmberPulse();
-                    isReconnecting = false;
-                }
-                hasDisplayContent = false;
-                displayFrameCount = 0;
                 currentState = STATE_UNCLAIMED;
                 currentClaimCode = "";
-                lastDisplayedError = reason;
-                led_Yellow();
+                heartbeatScheduler.reset();
             }
             else
             {
-                consecutiveHeartbeatFailures++;
-                Serial.printf("[Main] Heartbeat failed (%d consecutive failures): %s\n",
-                              consecutiveHeartbeatFailures, result.errorMessage.c_str());
-
-                if (consecutiveHeartbeatFailures >= 2 && hasDisplayContent && !isReconnecting)
-                {
-                    Serial.println("[Main] Server connection lost, entering reconnecting state");
-                    isReconnecting = true;
-                    displayReconnecting();
-                    startAmberPulse();
-                }
+                heartbeatScheduler.onFailure(result->retryAfterSec * 1000UL);
+                LOG_W(NET, "Heartbeat failed, scheduler %s (%d failures), next in %us",
+                      heartbeatScheduler.stateName(), heartbeatScheduler.failures(),
+                      heartbeatScheduler.msUntilDue() / 1000);
             }
-        }
 
-        // --- FRAME ROTATION ---
-        if (hasDisplayContent && displayFrameCount > 0 && !isReconnecting) {
-            uint8_t idx = currentFrameIndex;
-            if (displayFrames[idx].durationSec > 0) {
-                uint32_t elapsed = (now - frameStartTime) / 1000;
-                if (elapsed >= displayFrames[idx].durationSec) {
-                    // Advance to next frame
-                    currentFrameIndex = (currentFrameIndex + 1) % displayFrameCount;
-                    frameStartTime = now;
-                    uint8_t newIdx = currentFrameIndex;
-                    if (displayFrames[newIdx].durationSec > 0) {
-                        displayFrameFullScreen(newIdx);
-                        applyFrameLedBeep(newIdx);
-                    }
-                }
-            } else {
-                // Skip invalid frame (zero duration)
-                currentFrameIndex = (currentFrameIndex + 1) % displayFrameCount;
-                frameStartTime = now;
-                if (displayFrames[currentFrameIndex].durationSec > 0) {
-                    displayFrameFullScreen(currentFrameIndex);
-                    applyFrameLedBeep(currentFrameIndex);
-                }
-            }
-        }
+            // The UI loop owns the result from here on
+            bool newPlaylist = result->hasNewDisplay && result->frameCount > 0;
+            bool rebooting = result->factoryReset || result->demoMode != localDemoMode;
+            postNetEvent({NET_HEARTBEAT, result->success, nullptr, result, apiClient.activePlaylist().frames});
 
-        // Low battery warning
-        if (hasDisplayContent && getBatteryPercent() < 5) {
-            drawBatteryIcon(5, 5);
+            if (rebooting) {
+                vTaskSuspend(NULL);  // The UI loop restarts the device
+            }
+            // The old bank may still be on screen until the UI switches to the
+            // new one; the next heartbeat would overwrite it
+            if (newPlaylist) {
+                apiClient.savePlaylist();  // for the next boot; the UI already has it
+                xSemaphoreTake(playlistAdopted, portMAX_DELAY);
+            }
         }
 
         // --- OTA CHECK ---
@@ -668,7 +875,7 @@ void handleApiStateMachine()
             if (now - startTime >= FIRST_OTA_CHECK_DELAY_MS) {
                 shouldCheckOta = true;
                 firstOtaCheckDone = true;
-                Serial.println("[OTA] First check (60s after boot)");
+                LOG_I(OTA, "First check (60s after boot)");
             }
         } else if (now - lastOtaCheckTime >= OTA_CHECK_INTERVAL_MS) {
             shouldCheckOta = true;
@@ -678,25 +885,39 @@ void handleApiStateMachine()
             lastOtaCheckTime = now;
 
             if (OtaUpdate::isUpdateAvailable()) {
-                Serial.printf("[Main] OTA update available: v%d -> v%d\n",
-                              OtaUpdate::getCurrentVersion(),
-                              OtaUpdate::getLatestVersion());
-
-                displaySystemScreen("OTA", NULL, NULL);
-                display.refresh();
+                LOG_I(NET, "OTA update available: v%d -> v%d",
+                      OtaUpdate::getCurrentVersion(),
+                      OtaUpdate::getLatestVersion());
+                postNetEvent({NET_OTA_STARTED});
 
                 OtaResult otaResult = OtaUpdate::checkAndUpdate();
 
+                if (!otaResult.success && otaResult.updateAvailable && otaResult.errorMessage.length() > 0) {
+                    LOG_W(NET, "OTA update failed: %s", otaResult.errorMessage.c_str());
+                }
+                postNetEvent({NET_OTA_FINISHED, otaResult.success});
                 if (otaResult.success) {
-                    displaySystemScreen("OTA", "Update OK!", "Rebooting...");
-                    display.refresh();
+                    vTaskSuspend(NULL);  // The UI loop reboots into the new firmware
+                }
+            }
+        }
 
-                    led_Green();
-                    playBuzzerPositive();
-                    delay(2000);
-                    ESP.restart();
-                } else if (otaResult.updateAvailable && otaResult.errorMessage.length() > 0) {
-                    Serial.printf("[Main] OTA update failed: %s\n", otaResult.errorMessage.c_str());
+        // --- PUSH (long-poll) ---
+        // Until the next heartbeat is due, keep a long-poll open so a content
+        // change is fetched right away instead of at the next interval. Not
+        // while backing off: the server is failing anyway.
+        if (currentState == STATE_ACTIVE && apiClient.pushSupported() &&
+            heartbeatScheduler.state() == HeartbeatScheduler::SCHED_NORMAL) {
+            uint32_t waitSec = heartbeatScheduler.msUntilDue() / 1000;
+            if (waitSec > API_LONG_POLL_SEC) waitSec = API_LONG_POLL_SEC;
+            if (waitSec >= 1) {
+                netLoad.end();  // Idle wait, not work
+                WaitResult wait = apiClient.waitForChange(waitSec);
+                netLoad.begin();
+                if (wait == WAIT_CHANGED) {
+                    heartbeatScheduler.triggerNow();
+                } else if (wait == WAIT_ERROR) {
+                    delay(PUSH_RETRY_MS);
                 }
             }
         }
@@ -704,20 +925,431 @@ void handleApiStateMachine()
     }
 
     case STATE_ERROR:
-        led_Yellow();
-        lastDisplayedError = "Error";
         delay(5000);
         currentState = STATE_UNCLAIMED;
         break;
     }
 }
 
+// Busy time and stack headroom of one task
+void addTaskLoad(JsonObject out, const TaskLoad& load, TaskHandle_t task)
+{
+    out["busyMs"] = (uint32_t)(load.busyUs / 1000);
+    out["maxMs"] = load.maxUs / 1000;
+    out["stackFree"] = uxTaskGetStackHighWaterMark(task);
+    out["wakes"] = load.wakes;
+    out["wakesPerMin"] = (uint32_t)(load.wakes * 60000ULL / (millis() | 1));
+}
+
+// Frame refreshes by type (count and total panel time) and the ghosting
+// budget spent since the last full refresh
+void addDisplayRefreshes(JsonObject out)
+{
+    static const char* const NAMES[REFRESH_TYPES] = {"skipped", "partial", "fast", "full", "gray4"};
+    for (int t = 0; t < REFRESH_TYPES; t++) {
+        JsonObject o = out[NAMES[t]].to<JsonObject>();
+        o["count"] = display.frameRefreshes((RefreshType)t);
+        o["ms"] = display.frameRefreshMs((RefreshType)t);
+    }
+    out["total"] = display.refreshCount();
+    out["blitUs"] = display.lastBlitUs();
+    const RefreshPolicy& policy = display.refreshPolicy();
+    JsonObject ghost = out["ghost"].to<JsonObject>();
+    ghost["partials"] = policy.partials();
+    ghost["fasts"] = policy.fasts();
+    ghost["inkPct"] = policy.inkUsedPercent();
+    ghost["cleanses"] = policy.cleanses();
+}
+
+// Network-task state as of now (network task, or a battery wake's only task)
+void captureNetMetrics(NetMetrics& out)
+{
+    out.schedState = heartbeatScheduler.stateName();
+    out.schedFailures = heartbeatScheduler.failures();
+    out.schedOpens = heartbeatScheduler.breakerOpens();
+    out.schedIntervalMs = heartbeatScheduler.intervalMs();
+    out.load = netLoad;
+    out.timing = apiClient.timing();
+}
+
+// Network task: refresh the copy /metrics serves
+void publishNetMetrics()
+{
+    xSemaphoreTake(netMetricsLock, portMAX_DELAY);
+    captureNetMetrics(netMetrics);
+    xSemaphoreGive(netMetricsLock);
+}
+
+// Heartbeat telemetry hook (network task): its own state, read directly
+void addAppTelemetry(JsonObject telemetry)
+{
+    static NetMetrics net;  // only the network task gets here; keeps it off the stack
+    captureNetMetrics(net);
+    addTelemetry(telemetry, net);
+}
+
+// Scheduler state, time each task spent working, the event backlog and the
+// services' counters; `net` is the network task's side of it
+void addTelemetry(JsonObject telemetry, const NetMetrics& net)
+{
+    JsonObject sched = telemetry["sched"].to<JsonObject>();
+    sched["state"] = net.schedState;
+    sched["failures"] = net.schedFailures;
+    sched["opens"] = net.schedOpens;
+    sched["intervalMs"] = net.schedIntervalMs;
+
+    // No network task on a battery wake
+    if (netEvents) {
+        JsonObject tasks = telemetry["tasks"].to<JsonObject>();
+        addTaskLoad(tasks["net"].to<JsonObject>(), net.load, netTaskHandle);
+        addTaskLoad(tasks["ui"].to<JsonObject>(), uiLoad, uiTaskHandle);
+        JsonObject queue = tasks["queue"].to<JsonObject>();
+        queue["depth"] = uxQueueMessagesWaiting(netEvents);
+        queue["max"] = netEventsMax;
+    }
+    if (battery.active()) {
+        battery.toJson(telemetry["battery"].to<JsonObject>());
+    }
+
+    wifiConnect().toJson(telemetry["wifi"].to<JsonObject>());
+    ledService().toJson(telemetry["led"].to<JsonObject>());
+    buzzerService().toJson(telemetry["buzzer"].to<JsonObject>());
+    addDisplayRefreshes(telemetry["display"].to<JsonObject>());
+
+    // Boot: the timeline and its refreshes until a heartbeat has been
+    // answered, time to the first customer frame once there is one
+    bool booting = !bootTimeline.ended(BOOT_HEARTBEAT);
+    if (booting || firstFrameMs > 0) {
+        JsonObject boot = telemetry["boot"].to<JsonObject>();
+        if (booting) {
+            bootTimeline.toJson(boot["phases"].to<JsonObject>());
+            boot["refreshes"] = display.refreshCount();
+        }
+        if (firstFrameMs > 0) {
+            boot["firstFrameMs"] = firstFrameMs;
+            boot["fromFlash"] = restoredFromFlash;
+        }
+    }
+}
+
+// Captive portal /metrics (UI task): request timing plus the same counters
+// the heartbeat carries, readable on the LAN without going through the
+// server. Network-task state comes from the copy it last published.
+void writeMetrics(String& json)
+{
+    JsonDocument doc;
+    doc["uptimeSeconds"] = millis() / 1000;
+    doc["rssi"] = WiFi.RSSI();
+    xSemaphoreTake(netMetricsLock, portMAX_DELAY);
+    netMetrics.timing.toJson(doc["net"].to<JsonObject>());
+    addTelemetry(doc.as<JsonObject>(), netMetrics);
+    xSemaphoreGive(netMetricsLock);
+    serializeJson(doc, json);
+}
+
+// ============== UI LOOP ==============
+// Apply one network outcome to the display, LED and buzzer
+void handleNetEvent(NetEvent& ev)
+{
+    switch (ev.type)
+    {
+    case NET_WIFI_LOST:
+        // A loaded playlist keeps rotating offline; only an empty screen shows the setup hint
+        if (!hasDisplayContent) {
+            led_Yellow();
+            displayWifiMessage();
+            display.refresh();
+        }
+        break;
+
+    case NET_WIFI_RESTORED:
+        if (!hasDisplayContent) {
+            displayIPAddress();
+        }
+        break;
+
+    case NET_CLAIM_STARTED:
+        if (lastDisplayedError.isEmpty()) {
+            led_Blue();
+        }
+        break;
+
+    case NET_CLAIM_CODE:
+        lastDisplayedError = "";
+        led_Blue();
+        displayClaimCode(ev.text->c_str());
+        display.refresh();
+        playBuzzerPositive();
+        break;
+
+    case NET_CLAIM_FAILED:
+        if (lastDisplayedError != *ev.text) {
+            lastDisplayedError = *ev.text;
+            displayError(ev.text->c_str());
+            display.refresh();
+        }
+        led_Yellow();
+        break;
+
+    case NET_CLAIMED:
+        led_Green();
+        playBuzzerPositive();
+
+        displaySystemScreen("OK", "Connected!", NULL);
+        display.refresh();
+        delay(2000);
+
+        hasDisplayContent = false;
+        displayFrameCount = 0;
+        break;
+
+    case NET_CLAIM_EXPIRED:
+        lastDisplayedError = "Claim expired";
+        led_Yellow();
+        break;
+
+    case NET_HEARTBEAT:
+        handleHeartbeatResult(*ev.heartbeat, ev.frames);
+        break;
+
+    case NET_OTA_STARTED:
+        otaInProgress = true;
+        displaySystemScreen("OTA", NULL, NULL);
+        display.refresh();
+        break;
+
+    case NET_OTA_FINISHED:
+        if (ev.ok) {
+            displaySystemScreen("OTA", "Update OK!", "Rebooting...");
+            display.refresh();
+
+            led_Green();
+            playBuzzerPositive();
+            delay(2000);
+            logFlush();
+            ESP.restart();
+        }
+        otaInProgress = false;
+        if (hasDisplayContent) {
+            displayFrameFullScreen(currentFrameIndex);
+        }
+        break;
+    }
+
+    delete ev.text;
+    delete ev.heartbeat;
+}
+
+void handleHeartbeatResult(HeartbeatResult& result, DisplayFrame* frames)
+{
+    // Factory reset
+    if (result.factoryReset)
+    {
+        LOG_W(MAIN, "Remote factory reset requested!");
+        led_Red();
+        playBuzzerNegative();
+
+        displaySystemScreen("RST", "Factory Reset", "Rebooting...");
+        display.refresh();
+        delay(2000);
+
+        Preferences prefs;
+        prefs.begin("tigermeter", false);
+        prefs.clear();
+        prefs.end();
+
+        LOG_I(MAIN, "All data cleared, rebooting...");
+        logFlush();
+        ESP.restart();
+    }
+
+    // Demo mode toggle
+    if (result.demoMode != localDemoMode)
+    {
+        LOG_I(MAIN, "Demo mode changed remotely: %s", result.demoMode ? "ON" : "OFF");
+
+        Preferences prefs;
+        prefs.begin("tigermeter", false);
+        prefs.putBool("demoMode", result.demoMode);
+        prefs.end();
+
+        displaySystemScreen("DEMO", result.demoMode ? "Demo Enabled" : "Demo Disabled", "Rebooting...");
+        display.refresh();
+
+        if (result.demoMode) playBuzzerPositive();
+        delay(2000);
+        logFlush();
+        ESP.restart();
+    }
+
+    if (result.success)
+    {
+        consecutiveHeartbeatFailures = 0;
+
+        if (isReconnecting) {
+            LOG_I(MAIN, "Connection restored!");
+            stopAmberPulse();
+            isReconnecting = false;
+        }
+
+        // --- NEW DISPLAY DATA ---
+        // Metadata-only updates (same bitmaps) keep the rotation position
+        // and skip the e-paper refresh; only LED/one-shots are re-applied
+        bool metaOnly = result.hasNewDisplay && result.metaOnly && hasDisplayContent;
+        if (result.hasNewDisplay && result.frameCount > 0)
+        {
+            LOG_I(MAIN, "New display: %d frames, interval=%us%s", result.frameCount,
+                  result.refreshInterval, metaOnly ? " (metadata only)" : "");
+
+            // The heartbeat swapped the new playlist in; switch to it and let
+            // the network task reuse the old bank
+            displayFrames = frames;
+            displayFrameCount = result.frameCount;
+            displayHash = result.displayHash;
+            hasDisplayContent = true;
+            armFrameOneShots();
+            if (playlistAdopted) xSemaphoreGive(playlistAdopted);
+
+            if (metaOnly) {
+                applyFrameLedBeep(currentFrameIndex);
+            } else {
+                // Reset rotation, draw first frame
+                playlistChangedAtMs = result.changedAtMs;
+                currentFrameIndex = 0;
+                startFrameTimer();
+                if (displayFrames[0].durationSec > 0) {
+                    displayFrameFullScreen(0);
+                    applyFrameLedBeep(0);
+                }
+            }
+        }
+        else if (result.hasNewDisplay && result.frameCount == 0) {
+            // Empty frames — "waiting for content"
+            hasDisplayContent = false;
+            displayFrameCount = 0;
+            displayWaitingForContent();
+            display.refresh();
+            led_Off();
+        }
+        // else: no new display data, just keep rotating
+
+        // One-shot command (beep/flash without touching the playlist)
+        if (result.hasCommand) {
+            LOG_I(MAIN, "Command #%u: beep=%d flash=%d",
+                  result.commandSeq, result.commandBeep, result.commandFlashCount);
+            bool onFrame = hasDisplayContent && currentFrameIndex < displayFrameCount;
+            String color = onFrame ? String(displayFrames[currentFrameIndex].ledColor) : String("green");
+            playOneShot(result.commandBeep, result.commandFlashCount, color);
+        }
+    }
+    else if (result.httpCode == 401 || result.httpCode == 403)
+    {
+        const char* reason = result.httpCode == 403 ? "Device revoked" : "Auth expired";
+        LOG_I(MAIN, "%s, restarting claim...", reason);
+        consecutiveHeartbeatFailures = 0;
+        if (isReconnecting) {
+            stopAmberPulse();
+            isReconnecting = false;
+        }
+        hasDisplayContent = false;
+        displayFrameCount = 0;
+        lastDisplayedError = reason;
+        led_Yellow();
+    }
+    else
+    {
+        consecutiveHeartbeatFailures++;
+        LOG_W(MAIN, "Heartbeat failed (%d consecutive failures): %s",
+              consecutiveHeartbeatFailures, result.errorMessage.c_str());
+
+        if (consecutiveHeartbeatFailures >= 2 && hasDisplayContent && !isReconnecting)
+        {
+            LOG_W(MAIN, "Server connection lost, entering reconnecting state");
+            isReconnecting = true;
+            displayReconnecting();
+            startAmberPulse();
+        }
+    }
+}
+
+// Heartbeat interval for the server's refreshInterval (0 = not set)
+uint32_t heartbeatIntervalMs(uint32_t refreshIntervalSec)
+{
+    return refreshIntervalSec > 0 ? refreshIntervalSec * 1000UL : HEARTBEAT_INTERVAL_MS;
+}
+
+// Make the playlist stored in flash the one on display (not drawn yet), and
+// poll at its interval as if its heartbeat had just arrived. Runs before the
+// network task exists, so the scheduler is still ours to set.
+bool adoptStoredPlaylist()
+{
+    if (!apiClient.restorePlaylist()) return false;
+    FramePlaylist& stored = apiClient.activePlaylist();
+    heartbeatScheduler.setInterval(heartbeatIntervalMs(stored.refreshInterval));
+    displayFrames = stored.frames;
+    displayFrameCount = stored.count;
+    armFrameOneShots();
+    displayHash = apiClient.getDisplayHash();
+    hasDisplayContent = true;
+    restoredFromFlash = true;
+    return true;
+}
+
+// Put the playlist stored in flash on screen (boot, before WiFi). The first
+// heartbeat then sends its display hash, so an unchanged playlist isn't
+// downloaded again.
+bool showStoredPlaylist()
+{
+    if (!adoptStoredPlaylist()) return false;
+
+    // First frame that has a bitmap
+    currentFrameIndex = 0;
+    while (currentFrameIndex + 1 < displayFrameCount && displayFrames[currentFrameIndex].durationSec == 0) {
+        currentFrameIndex++;
+    }
+    startFrameTimer();
+    displayFrameFullScreen(currentFrameIndex);
+    applyFrameLedBeep(currentFrameIndex);
+    return true;
+}
+
+// Frame rotation; runs every UI loop pass regardless of the network
+void updateDisplay()
+{
+    unsigned long now = millis();
+
+    // --- FRAME ROTATION ---
+    if (hasDisplayContent && displayFrameCount > 0 && !isReconnecting && !otaInProgress) {
+        uint8_t idx = currentFrameIndex;
+        if (displayFrames[idx].durationSec > 0) {
+            uint32_t elapsed = (now - frameStartTime) / 1000;
+            if (elapsed >= displayFrames[idx].durationSec) {
+                // Advance to next frame
+                currentFrameIndex = (currentFrameIndex + 1) % displayFrameCount;
+                startFrameTimer();
+                uint8_t newIdx = currentFrameIndex;
+                if (displayFrames[newIdx].durationSec > 0) {
+                    displayFrameFullScreen(newIdx);
+                    applyFrameLedBeep(newIdx);
+                }
+            }
+        } else {
+            // Skip invalid frame (zero duration)
+            currentFrameIndex = (currentFrameIndex + 1) % displayFrameCount;
+            startFrameTimer();
+            if (displayFrames[currentFrameIndex].durationSec > 0) {
+                displayFrameFullScreen(currentFrameIndex);
+                applyFrameLedBeep(currentFrameIndex);
+            }
+        }
+    }
+}
+
+// Controller init only: the first screen drawn does the (single) full refresh
 void initializeDisplay()
 {
-    Serial.println("[Display] e-Paper Init...");
+    LOG_D(DISPLAY, "e-Paper Init...");
     display.begin();
-    display.clear();
-    display.refresh();
 }
 
 // Old drawRectangleAndText — KEPT for demo/system screens only
@@ -736,76 +1368,200 @@ void drawRectangleAndText(const char *Text)
 // displayWifiMessage, displayClaimCode, displayIPAddress, displayError, displayReconnecting
 // are defined above with displaySystemScreen()
 
-// ============== RAINBOW LED TASK ==============
-void rainbowTask(void *pvParameters)
+// ============== BATTERY MODE ==============
+// Next frame after `from` that has a bitmap (`from` itself if there's no other)
+uint8_t nextValidFrame(uint8_t from)
 {
-    (void)pvParameters;
-    for (;;)
-    {
-        if (!isRainbow) {
-            rainbowTaskHandle = NULL;
-            vTaskDelete(NULL);
-            return;
-        }
-        rainbowCycle(6000);  // One full rainbow cycle
+    for (uint8_t k = 1; k <= displayFrameCount; k++) {
+        uint8_t idx = (from + k) % displayFrameCount;
+        if (displayFrames[idx].durationSec > 0) return idx;
     }
+    return from;
 }
 
-void startRainbow()
+// When the frame shown at `shownMs` is due to switch; never when it's the only one
+uint64_t frameDueAfter(uint8_t frameIndex, uint64_t shownMs)
 {
-    if (rainbowTaskHandle == NULL) {
-        isRainbow = true;
-        xTaskCreatePinnedToCore(rainbowTask, "rainbow", 2048, NULL, 1, &rainbowTaskHandle, 1);
-        Serial.println("[Main] Started rainbow task");
-    }
+    if (nextValidFrame(frameIndex) == frameIndex) return BATTERY_NEVER;
+    return shownMs + displayFrames[frameIndex].durationSec * 1000ULL;
 }
 
-void stopRainbow()
+// The server's refresh interval, but not more often than BATTERY_HEARTBEAT_MIN_MS
+uint32_t batteryHeartbeatIntervalMs()
 {
-    if (rainbowTaskHandle != NULL) {
-        isRainbow = false;
-        delay(100);
-        if (rainbowTaskHandle != NULL) {
-            vTaskDelete(rainbowTaskHandle);
-            rainbowTaskHandle = NULL;
+    uint32_t interval = apiClient.activePlaylist().refreshInterval * 1000UL;
+    return interval > BATTERY_HEARTBEAT_MIN_MS ? interval : BATTERY_HEARTBEAT_MIN_MS;
+}
+
+// One battery-mode wake: the frame switch and/or heartbeat that are due (and
+// any that come due within BATTERY_SLEEP_MIN_MS), then back to sleep
+void runBatteryWake()
+{
+    BatteryState& state = battery.state();
+    LOG_I(MAIN, "Battery: wake #%u", state.wakes);
+
+    initializeDisplay();
+    apiClient.begin();
+    apiClient.setTelemetryHook(addAppTelemetry);
+    if (!apiClient.hasCredentials() || !adoptStoredPlaylist()) {
+        // Nothing left to show: a normal boot sorts it out
+        LOG_W(MAIN, "Battery: no stored playlist, leaving battery mode");
+        battery.stop();
+        logFlush();
+        ESP.restart();
+    }
+    currentState = STATE_ACTIVE;
+    currentFrameIndex = state.frameIndex < displayFrameCount ? state.frameIndex : 0;
+
+    for (;;) {
+        uint64_t now = battery.now();
+        if (now >= state.frameDueMs) {
+            currentFrameIndex = nextValidFrame(currentFrameIndex);
+            displayFrameFullScreen(currentFrameIndex);
+            state.frameIndex = currentFrameIndex;
+            state.frameDueMs = frameDueAfter(currentFrameIndex, now);
+        }
+        if (now >= state.heartbeatDueMs) {
+            batteryHeartbeat();
         }
-        Serial.println("[Main] Stopped rainbow task");
+
+        uint64_t next = state.frameDueMs < state.heartbeatDueMs ? state.frameDueMs : state.heartbeatDueMs;
+        now = battery.now();
+        if (next >= now + BATTERY_SLEEP_MIN_MS) break;
+        delay(next > now ? (uint32_t)(next - now) : 0);
     }
+
+    display.sleep();
+    battery.sleep(display.refreshCount());
 }
 
-// ============== AMBER PULSE (reconnecting) ==============
-void amberPulseTask(void *pvParameters)
+// WiFi up, one heartbeat, WiFi off. Failed heartbeats back off (up to 8x
+// the interval); a new playlist is stored and starts from its first frame.
+void batteryHeartbeat()
 {
-    (void)pvParameters;
-    for (;;)
+    BatteryState& state = battery.state();
+    unsigned long radioStart = millis();
+
+    String ssid, password;
     {
-        if (!isReconnecting) {
-            amberPulseTaskHandle = NULL;
-            vTaskDelete(NULL);
-            return;
+        Preferences prefs;
+        prefs.begin("tigermeter", true);
+        ssid = prefs.getString("ssid", "");
+        password = prefs.getString("password", "");
+        prefs.end();
+    }
+
+    WiFi.mode(WIFI_STA);
+    wifiConnect().begin(ssid, password);
+    while (WiFi.status() != WL_CONNECTED && millis() - radioStart < 15000) {
+        wifiConnect().loop();
+        delay(50);
+    }
+    wifiConnect().loop();
+
+    bool ok = false;
+    if (WiFi.status() == WL_CONNECTED) {
+        HeartbeatResult result = apiClient.sendHeartbeat(getBatteryPercent(), WiFi.RSSI(),
+                                                         (int)(battery.now() / 1000), false);
+        ok = result.success;
+        if (ok) {
+            OtaUpdate::setAutoUpdate(result.autoUpdate);
+            OtaUpdate::setLatestVersion(result.latestFirmwareVersion);
+            if (result.firmwareDownloadUrl.length() > 0) {
+                OtaUpdate::setFirmwareUrl(result.firmwareDownloadUrl);
+            }
+            // Factory reset, demo toggle, empty playlist: a normal boot handles
+            // them (LED, buzzer and screens aren't set up on a battery wake)
+            if (result.factoryReset || result.demoMode != localDemoMode ||
+                (result.hasNewDisplay && result.frameCount == 0)) {
+                LOG_I(MAIN, "Battery: server change needs a full boot, leaving battery mode");
+                battery.stop();
+                logFlush();
+                ESP.restart();
+            }
+            if (result.hasNewDisplay) {
+                displayFrames = apiClient.activePlaylist().frames;
+                displayFrameCount = result.frameCount;
+                displayHash = result.displayHash;
+                apiClient.savePlaylist();
+                if (!result.metaOnly) {
+                    // From the first frame, like the always-on rotation
+                    currentFrameIndex = nextValidFrame(displayFrameCount - 1);
+                    displayFrameFullScreen(currentFrameIndex);
+                    state.frameIndex = currentFrameIndex;
+                    state.frameDueMs = frameDueAfter(currentFrameIndex, battery.now());
+                }
+            }
+            if (OtaUpdate::isUpdateAvailable()) {
+                OtaResult ota = OtaUpdate::checkAndUpdate();
+                if (ota.success) {
+                    battery.stop();
+                    logFlush();
+                    ESP.restart();
+                }
+            }
+        } else if (result.httpCode == 401 || result.httpCode == 403) {
+            // Needs claiming again, which takes the portal and a screen
+            LOG_W(MAIN, "Battery: device not authorized, leaving battery mode");
+            battery.stop();
+            logFlush();
+            ESP.restart();
         }
-        pulseAmberSlow();  // One 3-second cycle
+    } else {
+        LOG_W(MAIN, "Battery: WiFi join failed");
     }
+
+    WiFi.disconnect(true);
+    WiFi.mode(WIFI_OFF);
+    battery.addRadio(millis() - radioStart);
+
+    if (ok) state.failures = 0;
+    else if (state.failures < 3) state.failures++;
+    state.heartbeatDueMs = battery.now() + ((uint64_t)batteryHeartbeatIntervalMs() << state.failures);
+}
+
+// After a power-on in battery mode: once the device is set up, has shown
+// its content and answered a heartbeat (and nobody is on the portal), the
+// sleep cycle takes over
+void maybeEnterBatterySleep()
+{
+    if (!batteryModeEnabled || currentState != STATE_ACTIVE || !hasDisplayContent) return;
+    if (otaInProgress || isReconnecting || millis() < BATTERY_AWAKE_GRACE_MS) return;
+    if (!bootTimeline.ended(BOOT_HEARTBEAT) || WiFi.softAPgetStationNum() > 0) return;
+
+    // Until the first sleep the battery clock is millis()
+    uint64_t now = millis();
+    uint64_t frameDue = frameDueAfter(currentFrameIndex, frameStartTime);
+    if (frameDue < now + BATTERY_SLEEP_MIN_MS) return;  // Let the rotation switch first
+
+    LOG_I(MAIN, "Battery mode: entering sleep cycle");
+    battery.start(currentFrameIndex, frameDue, now + batteryHeartbeatIntervalMs());
+    display.sleep();
+    battery.sleep(display.refreshCount());
 }
 
+// ============== AMBER PULSE (reconnecting) ==============
+bool amberPulsing = false;
+
 void startAmberPulse()
 {
-    if (amberPulseTaskHandle == NULL) {
-        xTaskCreatePinnedToCore(amberPulseTask, "amberPulse", 2048, NULL, 1, &amberPulseTaskHandle, 1);
-        Serial.println("[Main] Started amber pulse task");
+    if (!amberPulsing) {
+        amberPulsing = true;
+        pulseAmberSlow();
+        LOG_D(MAIN, "Started amber pulse");
     }
 }
 
+// Back to the frame's own LED
 void stopAmberPulse()
 {
-    if (amberPulseTaskHandle != NULL) {
+    if (amberPulsing) {
+        amberPulsing = false;
         isReconnecting = false;
-        delay(100);
-        if (amberPulseTaskHandle != NULL) {
-            vTaskDelete(amberPulseTaskHandle);
-            amberPulseTaskHandle = NULL;
+        if (hasDisplayContent && currentFrameIndex < displayFrameCount) {
+            setFrameLed(displayFrames[currentFrameIndex]);
         }
-        Serial.println("[Main] Stopped amber pulse task");
+        LOG_D(MAIN, "Stopped amber pulse");
     }
 }
 
@@ -934,9 +1690,10 @@ void runDemoLoop()
         if (!ntpInitialized && WiFi.status() == WL_CONNECTED) {
             configTime(0, 0, "pool.ntp.org", "time.nist.gov");
             ntpInitialized = true;
-            Serial.println("[DEMO] NTP time initialized");
+            LOG_D(DEMO, "NTP time initialized");
         }
         captivePortalLoop();
+        logDrain();
 
         unsigned long now = millis();
 
@@ -949,17 +1706,14 @@ void runDemoLoop()
             unsigned int mm = (uptimeSec / 60) % 60;
             unsigned int ss = uptimeSec % 60;
 
-            Serial.println("\n===== [DEMO] Debug Info =====");
-            Serial.printf("[DEMO] Uptime: %02u:%02u:%02u\r\n", hh, mm, ss);
-            Serial.println("[DEMO] MAC: " + WiFi.macAddress());
-            Serial.printf("[DEMO] AP IP: %s\r\n", WiFi.softAPIP().toString().c_str());
-            Serial.printf("[DEMO] Free Heap: %u bytes\r\n", ESP.getFreeHeap());
-            Serial.printf("[DEMO] Connected clients: %d\r\n", WiFi.softAPgetStationNum());
-
             int batteryRaw = analogRead(35);
             float batteryVoltage = (batteryRaw / 4095.0) * 3.3;
-            Serial.printf(" %.2fV (raw: %d)\r\n", batteryVoltage, batteryRaw);
-            Serial.println("=============================");
+            LOG_D(DEMO, "Uptime: %02u:%02u:%02u", hh, mm, ss);
+            LOG_D(DEMO, "MAC: %s", WiFi.macAddress().c_str());
+            LOG_D(DEMO, "AP IP: %s", WiFi.softAPIP().toString().c_str());
+            LOG_D(DEMO, "Free Heap: %u bytes", ESP.getFreeHeap());
+            LOG_D(DEMO, "Connected clients: %d", WiFi.softAPgetStationNum());
+            LOG_D(DEMO, "Battery: %.2fV (raw: %d)", batteryVoltage, batteryRaw);
         }
 
         if (now - lastUpdate >= 1000)
@@ -974,17 +1728,4 @@ void runDemoLoop()
     }
 }
 
-void demoLedTask(void *pvParameters)
-{
-    (void)pvParameters;
-    const uint16_t pulseDuration = 3000;
-    for (;;)
-    {
-        for (int i = 0; i < 7; i++)
-        {
-            pulseRainbowColor(i, pulseDuration);
-        }
-    }
-}
-
 #endif // API_MODE
\ No newline at end of file
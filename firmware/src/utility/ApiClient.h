@@ -3,10 +3,23 @@
 
 #include <Arduino.h>
 #include <HTTPClient.h>
+#include <WiFiClientSecure.h>
 #include <ArduinoJson.h>
 #include <WiFi.h>
 #include <Preferences.h>
 #include "mbedtls/md.h"
+#include "JsonStream.h"
+#include "FrameTransport.h"
+#include "FrameCodec.h"
+#include "FrameStore.h"
+#include "FrameFormat.h"
+#include "PlaylistStore.h"
+#include "Sha256.h"
+#include "LedEffect.h"
+#include "Melody.h"
+#include "RefreshPolicy.h"
+#include "NetTiming.h"
+#include "Log.h"
 
 // API Configuration - change API_BASE_URL to your computer's IP
 #ifndef API_BASE_URL
@@ -17,6 +30,19 @@
 #define HMAC_KEY "change-me-dev-hmac"
 #endif
 
+// Keep-alive: drop the shared connection after this much idle time instead of
+// risking a request on a socket the server (Caddy/Fastify) has already closed
+#ifndef API_KEEPALIVE_IDLE_MS
+#define API_KEEPALIVE_IDLE_MS 65000
+#endif
+
+// Push mode: longest a GET /wait long-poll is held open (the server caps it
+// too), plus the extra time allowed for the response before giving up
+#ifndef API_LONG_POLL_SEC
+#define API_LONG_POLL_SEC 50
+#endif
+#define API_LONG_POLL_GRACE_MS 10000
+
 // Generate FIRMWARE_VERSION string from FW_VERSION number (e.g. 29 -> "v29")
 #ifndef FW_VERSION
 #define FW_VERSION 0
@@ -37,20 +63,37 @@ enum DeviceState {
 };
 #endif
 
-// Display frame buffer size (384x168 1-bit packed = 8064 bytes)
-#define DISPLAY_FRAME_SIZE 8064
 #define MAX_DISPLAY_FRAMES 8
 
 // Single display frame (decoded bitmap pointer — allocated in PSRAM to save DRAM)
 struct DisplayFrame {
-    uint8_t* bitmap;             // pointer to DISPLAY_FRAME_SIZE bytes (ps_malloc)
+    uint8_t* bitmap;             // frameFormatSize(format) bytes in a FrameStore slot (PSRAM)
+    char hash[FRAME_HASH_LEN + 1];  // content hash ("" for inline legacy frames)
     char ledColor[16];
     char ledBrightness[8];
     uint32_t durationSec;
     bool beep;
     uint8_t flashCount;
+    LedKeyframe ledKeyframes[LED_MAX_KEYFRAMES];  // LED sequence; replaces ledColor when present
+    uint8_t ledKeyframeCount;
+    MelodyId melody;             // what the beep plays (tones win when present)
+    ToneStep tones[BUZZER_MAX_TONES];
+    uint8_t toneCount;
+    uint8_t refreshHint;         // RefreshHint: how the panel should refresh for this frame
+    uint8_t format;              // FrameFormat of the bitmap
+};
+
+// One playlist bank: frame metadata plus bitmap pointers into FrameStore
+// slots. ApiClient keeps two (active + staging) and flips between them.
+struct FramePlaylist {
+    DisplayFrame frames[MAX_DISPLAY_FRAMES];
+    int8_t slots[MAX_DISPLAY_FRAMES];   // FrameStore slot per frame, -1 if none
+    uint8_t count;
+    uint32_t refreshInterval;
 };
 
+static_assert(MAX_DISPLAY_FRAMES <= PLAYLIST_STORE_MAX_FRAMES, "stored playlist too small");
+
 // Claim result structure
 struct ClaimResult {
     bool success;
@@ -75,6 +118,14 @@ struct PollResult {
     int httpCode;
 };
 
+// Long-poll outcome (waitForChange)
+enum WaitResult {
+    WAIT_CHANGED,       // display/command/status changed: heartbeat now
+    WAIT_TIMEOUT,       // nothing changed within the timeout
+    WAIT_ERROR,         // network/server error
+    WAIT_UNSUPPORTED    // server has no /wait route; push is disabled
+};
+
 // Heartbeat result structure (v5: bitmap frames)
 struct HeartbeatResult {
     bool success;
@@ -90,10 +141,23 @@ struct HeartbeatResult {
     int latestFirmwareVersion;
     String firmwareDownloadUrl;
 
-    // Frame data (if hasNewDisplay)
-    DisplayFrame frames[MAX_DISPLAY_FRAMES];
+    // Scheduling hints (0 = none): when to heartbeat next after a success,
+    // and how long to back off after a failure (body retryAfter or Retry-After)
+    uint32_t nextPollSec;
+    uint32_t retryAfterSec;
+
+    // Frame data (if hasNewDisplay): the frames themselves are in
+    // ApiClient::activePlaylist() once the update is swapped in
     uint8_t frameCount;
     uint32_t refreshInterval;
+    bool metaOnly;          // Same bitmaps as the current playlist, only metadata changed
+    uint32_t changedAtMs;   // millis() when the display was set on the server (0 = unknown)
+
+    // One-shot command (fire once, independent of the playlist)
+    bool hasCommand;
+    uint32_t commandSeq;
+    bool commandBeep;
+    uint8_t commandFlashCount;
 };
 
 // NVS storage keys
@@ -101,6 +165,424 @@ const char* NVS_NAMESPACE = "tigermeter";
 const char* NVS_DEVICE_ID = "deviceId";
 const char* NVS_DEVICE_SECRET = "deviceSecret";
 const char* NVS_DISPLAY_HASH = "displayHash";
+const char* NVS_COMMAND_SEQ = "cmdSeq";
+
+// Maps the streamed heartbeat response onto a HeartbeatResult (scalars) and
+// the staging FramePlaylist (frames). Scalar fields are picked by path. A
+// frame normally carries just its content hash, which is resolved against
+// the FrameStore (missing bitmaps are fetched afterwards via POST /frames).
+// Older servers send the bitmap inline instead — base64 in JSON or a binary
+// blob — and it is decoded chunk by chunk straight into a fresh PSRAM slot,
+// so DRAM use doesn't grow with frame count. An inline bitmap whose frame
+// names a hash is hashed while it decodes and only committed if the digest
+// matches; otherwise it is fetched again.
+class HeartbeatStreamHandler : public JsonStreamHandler, public FrameBlobHandler {
+public:
+    HeartbeatStreamHandler(HeartbeatResult& result, FramePlaylist& staging, FrameStore& store)
+        : _result(result), _playlist(staging), _slot(staging.slots), _store(store), _sawFrames(false) {
+        for (int i = 0; i < MAX_DISPLAY_FRAMES; i++) {
+            _slot[i] = -1;
+            _base[i][0] = '\0';
+        }
+        memset(_frameCodec, CODEC_RAW, sizeof(_frameCodec));
+    }
+
+    bool sawFrames() const { return _sawFrames; }
+    uint32_t decodeUs() const { return _decodeTimer.us(); }
+    uint8_t verified() const { return _verified; }
+    uint8_t mismatches() const { return _mismatches; }
+    uint32_t hashBytes() const { return _b64Digest.sha().bytes() + _blobDigest.sha().bytes(); }
+    uint32_t hashUs() const { return _b64Digest.sha().us() + _blobDigest.sha().us(); }
+    int slot(int i) const { return i < MAX_DISPLAY_FRAMES ? _slot[i] : -1; }
+    // Previous version of frame i the server can patch from ("" if none)
+    const char* baseHash(int i) const { return i < MAX_DISPLAY_FRAMES ? _base[i] : ""; }
+    bool frameValid(int i) const { return _store.valid(slot(i)); }
+
+    // Drop the references taken while parsing (update not applied)
+    void releaseSlots() {
+        for (int i = 0; i < MAX_DISPLAY_FRAMES; i++) {
+            _store.release(_slot[i]);
+            _slot[i] = -1;
+        }
+    }
+
+    void onContainerBegin(const JsonStreamPath& path, bool isArray) override {
+        if (path.depth == 1 && isArray && path.isKey(0, "frames")) {
+            _sawFrames = true;
+            return;
+        }
+        // New frame object: reset to defaults, fields may arrive in any order
+        int i = frameIndex(path, 2);
+        if (i >= 0 && !isArray) {
+            DisplayFrame& df = _playlist.frames[i];
+            df.bitmap = nullptr;
+            df.hash[0] = '\0';
+            strcpy(df.ledColor, "green");
+            strcpy(df.ledBrightness, "mid");
+            df.durationSec = 30;
+            df.beep = false;
+            df.flashCount = 0;
+            df.ledKeyframeCount = 0;
+            df.melody = MELODY_NONE;
+            df.toneCount = 0;
+            df.refreshHint = REFRESH_HINT_AUTO;
+            df.format = FRAME_MONO;
+            _frameCodec[i] = CODEC_RAW;
+            _base[i][0] = '\0';
+            if (_result.frameCount < i + 1) _result.frameCount = i + 1;
+            return;
+        }
+        if (isArray) return;
+        // New keyframe: black, no fade, no hold until its fields arrive
+        int k = frameItemIndex(path, 4, "ledKeyframes", LED_MAX_KEYFRAMES, i);
+        if (k >= 0) {
+            DisplayFrame& df = _playlist.frames[i];
+            df.ledKeyframes[k] = {LED_RGB_OFF, 0, 0};
+            if (df.ledKeyframeCount < k + 1) df.ledKeyframeCount = k + 1;
+            return;
+        }
+        // New tone: a full-volume rest until its fields arrive
+        k = frameItemIndex(path, 4, "tones", BUZZER_MAX_TONES, i);
+        if (k >= 0) {
+            DisplayFrame& df = _playlist.frames[i];
+            df.tones[k] = {0, 0, 255};
+            if (df.toneCount < k + 1) df.toneCount = k + 1;
+        }
+    }
+
+    Print* onStringBegin(const JsonStreamPath& path) override {
+        int i = frameIndex(path, 3);
+        if (i >= 0 && path.isKey(2, "bitmap") && inlineSlot(i) >= 0) {
+            uint8_t* bitmap = _playlist.frames[i].bitmap;
+            _decoder.begin(bitmap, DISPLAY_FRAME_MAX_SIZE);
+            _inlineFrame = i;
+            if (!_playlist.frames[i].hash[0]) return _decodeTimer.wrap(&_decoder);
+            return _decodeTimer.wrap(_b64Digest.wrap(&_decoder, bitmap));
+        }
+        return nullptr;
+    }
+
+    void onStringEnd(const JsonStreamPath& path) override {
+        int i = frameIndex(path, 3);
+        if (i < 0 || i != _inlineFrame || !path.isKey(2, "bitmap")) return;
+        _inlineFrame = -1;
+        size_t decodedLen = _decoder.finish();
+        bool ok = !_decoder.invalid() && !_decoder.overflow() && isFrameSize(decodedLen);
+        if (!ok) {
+            _store.invalidate(_slot[i]);
+            LOG_W(API, "Frame %d: invalid bitmap size %u", i, (unsigned)decodedLen);
+        } else if (checkDigest(_b64Digest, i)) {
+            _store.commit(_slot[i], decodedLen);
+        }
+    }
+
+    // Binary transport: blob i is the bitmap of frames[i] from the header,
+    // encoded with frames[i].enc and decoded on the fly into its PSRAM slot
+    Print* onBlobBegin(uint8_t index, uint32_t length) override {
+        _blobDecoder = nullptr;
+        if (index >= _result.frameCount || _frameCodec[index] == CODEC_XOR || inlineSlot(index) < 0) return nullptr;
+        uint8_t* bitmap = _playlist.frames[index].bitmap;
+        _blobDecoder = _decoders.select(_frameCodec[index], bitmap, DISPLAY_FRAME_MAX_SIZE);
+        if (!_blobDecoder) {
+            LOG_W(API, "Frame %d: unsupported codec", index);
+            return nullptr;
+        }
+        if (!_playlist.frames[index].hash[0]) return _decodeTimer.wrap(_blobDecoder);
+        return _decodeTimer.wrap(_blobDigest.wrap(_blobDecoder, bitmap));
+    }
+
+    void onBlobEnd(uint8_t index) override {
+        if (!_blobDecoder) return;
+        FrameDecoder& d = *_blobDecoder;
+        if (d.finish() && !d.invalid() && !d.overflow() && isFrameSize(d.length())) {
+            if (checkDigest(_blobDigest, index)) _store.commit(_slot[index], d.length());
+        } else {
+            _store.invalidate(_slot[index]);
+            LOG_W(API, "Frame %d: bad blob (%s, %u bytes)", index,
+                  FRAME_CODEC_NAMES[_frameCodec[index]], (unsigned)d.length());
+        }
+        _blobDecoder = nullptr;
+    }
+
+    void onScalar(const JsonStreamPath& path, const char* value, bool isString) override {
+        if (path.depth == 1) {
+            const char* key = path.keys[0];
+            if (!strcmp(key, "factoryReset")) _result.factoryReset = isTrue(value);
+            else if (!strcmp(key, "autoUpdate")) _result.autoUpdate = isTrue(value);
+            else if (!strcmp(key, "demoMode")) _result.demoMode = isTrue(value);
+            else if (!strcmp(key, "latestFirmwareVersion")) _result.latestFirmwareVersion = atoi(value);
+            else if (!strcmp(key, "firmwareDownloadUrl") && isString) _result.firmwareDownloadUrl = value;
+            else if (!strcmp(key, "displayHash") && isString) _result.displayHash = value;
+            else if (!strcmp(key, "refreshInterval")) _result.refreshInterval = strtoul(value, nullptr, 10);
+            else if (!strcmp(key, "nextPollSec")) _result.nextPollSec = strtoul(value, nullptr, 10);
+            else if (!strcmp(key, "changedMsAgo")) _result.changedAtMs = millis() - strtoul(value, nullptr, 10);
+            return;
+        }
+
+        if (path.depth == 2 && path.isKey(0, "command")) {
+            const char* key = path.keys[1];
+            if (!strcmp(key, "seq")) {
+                _result.commandSeq = strtoul(value, nullptr, 10);
+                _result.hasCommand = true;
+            } else if (!strcmp(key, "beep")) {
+                _result.commandBeep = isTrue(value);
+            } else if (!strcmp(key, "flashCount")) {
+                int n = atoi(value);
+                _result.commandFlashCount = n < 0 ? 0 : (n > 10 ? 10 : n);
+            }
+            return;
+        }
+
+        int i;
+        int k = frameItemIndex(path, 5, "ledKeyframes", LED_MAX_KEYFRAMES, i);
+        if (k >= 0) {
+            LedKeyframe& kf = _playlist.frames[i].ledKeyframes[k];
+            const char* key = path.keys[4];
+            if (!strcmp(key, "color") && isString) {
+                if (!ledColorFromName(value, kf.color)) LOG_W(API, "Frame %d: unknown keyframe color %s", i, value);
+            } else if (!strcmp(key, "fadeMs")) {
+                kf.fadeMs = clampMs(value);
+            } else if (!strcmp(key, "holdMs")) {
+                kf.holdMs = clampMs(value);
+            }
+            return;
+        }
+        k = frameItemIndex(path, 5, "tones", BUZZER_MAX_TONES, i);
+        if (k >= 0) {
+            ToneStep& t = _playlist.frames[i].tones[k];
+            const char* key = path.keys[4];
+            long n = atol(value);
+            n = n < 0 ? 0 : n;
+            if (!strcmp(key, "hz")) t.hz = n > TONE_MAX_HZ ? TONE_MAX_HZ : n;
+            else if (!strcmp(key, "ms")) t.ms = n > TONE_MAX_MS ? TONE_MAX_MS : n;
+            else if (!strcmp(key, "duty")) t.duty = n > 255 ? 255 : n;
+            return;
+        }
+
+        i = frameIndex(path, 3);
+        if (i < 0) return;
+        DisplayFrame& df = _playlist.frames[i];
+        const char* key = path.keys[2];
+        if (!strcmp(key, "hash") && isString && _slot[i] < 0) {
+            strncpy(df.hash, value, FRAME_HASH_LEN);
+            df.hash[FRAME_HASH_LEN] = '\0';
+            _slot[i] = _store.acquire(df.hash);
+            df.bitmap = _store.bitmap(_slot[i]);
+        } else if (!strcmp(key, "base") && isString) {
+            strncpy(_base[i], value, FRAME_HASH_LEN);
+            _base[i][FRAME_HASH_LEN] = '\0';
+        } else if (!strcmp(key, "ledColor") && isString) {
+            strncpy(df.ledColor, value, 15);
+            df.ledColor[15] = '\0';
+        } else if (!strcmp(key, "ledBrightness") && isString) {
+            strncpy(df.ledBrightness, value, 7);
+            df.ledBrightness[7] = '\0';
+        } else if (!strcmp(key, "durationSec")) {
+            df.durationSec = strtoul(value, nullptr, 10);
+        } else if (!strcmp(key, "beep")) {
+            df.beep = isTrue(value);
+        } else if (!strcmp(key, "flashCount")) {
+            int n = atoi(value);
+            df.flashCount = n < 0 ? 0 : (n > 10 ? 10 : n);
+        } else if (!strcmp(key, "refresh") && isString) {
+            df.refreshHint = refreshHintFromName(value);
+        } else if (!strcmp(key, "format") && isString) {
+            df.format = frameFormatFromName(value);
+        } else if (!strcmp(key, "melody") && isString) {
+            df.melody = melodyFromName(value);
+            if (df.melody == MELODY_NONE && strcmp(value, "none")) LOG_W(API, "Frame %d: unknown melody %s", i, value);
+        } else if (!strcmp(key, "enc") && isString) {
+            _frameCodec[i] = frameCodecFromName(value);
+        }
+    }
+
+private:
+    HeartbeatResult& _result;
+    FramePlaylist& _playlist;
+    int8_t* _slot;          // = _playlist.slots
+    FrameStore& _store;
+    Base64StreamDecoder _decoder;
+    int _inlineFrame = -1;      // frame whose base64 bitmap _decoder is filling
+    FrameDecoderSet _decoders;
+    FrameDecoder* _blobDecoder = nullptr;
+    TimedPrint _decodeTimer;    // time spent in the bitmap decoders
+    DigestingSink<Base64StreamDecoder> _b64Digest;
+    DigestingSink<FrameDecoder> _blobDigest;
+    uint8_t _verified = 0;
+    uint8_t _mismatches = 0;
+    bool _sawFrames;
+    FrameCodecId _frameCodec[MAX_DISPLAY_FRAMES];
+    char _base[MAX_DISPLAY_FRAMES][FRAME_HASH_LEN + 1];
+
+    static bool isTrue(const char* v) { return strcmp(v, "true") == 0; }
+
+    // Decoded frame i against its hash (frames without one aren't checked);
+    // a mismatch leaves the slot empty so the frame is fetched again
+    template <class Decoder>
+    bool checkDigest(DigestingSink<Decoder>& digest, int i) {
+        const char* hash = _playlist.frames[i].hash;
+        if (!hash[0]) return true;
+        if (digest.matches(hash)) {
+            _verified++;
+            return true;
+        }
+        _mismatches++;
+        _store.invalidate(_slot[i]);
+        LOG_W(API, "Frame %d: hash mismatch (%.12s), rejected", i, hash);
+        return false;
+    }
+
+    // Slot for an inline bitmap: the hashed slot if the frame named one,
+    // otherwise a fresh anonymous slot. -1 (skip the bitmap) if the named
+    // slot already holds a verified copy, which decoding over would destroy
+    // should the inline one turn out bad.
+    int inlineSlot(int i) {
+        if (_slot[i] < 0) {
+            _slot[i] = _store.acquire(nullptr);
+            _playlist.frames[i].bitmap = _store.bitmap(_slot[i]);
+        }
+        if (_store.valid(_slot[i])) return -1;
+        return _playlist.frames[i].bitmap ? _slot[i] : -1;
+    }
+
+    // Index of frames[i] when `path` is at least `depth` deep inside it, else -1
+    static int frameIndex(const JsonStreamPath& path, uint8_t depth) {
+        if (path.depth != depth || !path.isKey(0, "frames")) return -1;
+        int i = path.indexAt(1);
+        return (i >= 0 && i < MAX_DISPLAY_FRAMES) ? i : -1;
+    }
+
+    // frames[frame].<array>[k] at `depth` (4: the item, 5: a field): returns k
+    // (ledKeyframes, tones)
+    static int frameItemIndex(const JsonStreamPath& path, uint8_t depth, const char* array, int max, int& frame) {
+        if (path.depth != depth || !path.isKey(0, "frames") || !path.isKey(2, array)) return -1;
+        frame = path.indexAt(1);
+        int k = path.indexAt(3);
+        if (frame < 0 || frame >= MAX_DISPLAY_FRAMES || k < 0 || k >= max) return -1;
+        return k;
+    }
+
+    static uint16_t clampMs(const char* value) {
+        long ms = atol(value);
+        return ms < 0 ? 0 : (ms > 60000 ? 60000 : ms);
+    }
+};
+
+// Fills FrameStore slots from a POST /frames response (binary transport):
+// header {frames: [{hash, enc, base}]}, blob i = bitmap of frames[i]. Only
+// slots already acquired and still empty are written. An "xor" blob patches
+// a copy of the base frame; the result must hash to the expected value or
+// the slot stays empty (and is re-fetched in full). Other blobs are hashed
+// while they decode and must match too.
+class FrameFetchHandler : public JsonStreamHandler, public FrameBlobHandler {
+public:
+    FrameFetchHandler(FrameStore& store) : _store(store) {
+        for (int i = 0; i < MAX_DISPLAY_FRAMES; i++) {
+            _hash[i][0] = '\0';
+            _base[i][0] = '\0';
+            _codec[i] = CODEC_RAW;
+        }
+    }
+
+    uint8_t filled() const { return _filled; }
+    uint8_t deltasApplied() const { return _deltasApplied; }
+    uint8_t deltasFailed() const { return _deltasFailed; }
+    uint32_t decodeUs() const { return _decodeTimer.us(); }
+    uint8_t verified() const { return _verified; }
+    uint8_t mismatches() const { return _mismatches; }
+    uint32_t hashBytes() const { return _digest.sha().bytes() + _patchSha.bytes(); }
+    uint32_t hashUs() const { return _digest.sha().us() + _patchSha.us(); }
+
+    void onScalar(const JsonStreamPath& path, const char* value, bool isString) override {
+        if (path.depth != 3 || !path.isKey(0, "frames") || !isString) return;
+        int i = path.indexAt(1);
+        if (i < 0 || i >= MAX_DISPLAY_FRAMES) return;
+        if (path.isKey(2, "hash")) {
+            strncpy(_hash[i], value, FRAME_HASH_LEN);
+            _hash[i][FRAME_HASH_LEN] = '\0';
+        } else if (path.isKey(2, "enc")) {
+            _codec[i] = frameCodecFromName(value);
+        } else if (path.isKey(2, "base")) {
+            strncpy(_base[i], value, FRAME_HASH_LEN);
+            _base[i][FRAME_HASH_LEN] = '\0';
+        }
+    }
+
+    Print* onBlobBegin(uint8_t index, uint32_t length) override {
+        _blobDecoder = nullptr;
+        _blobSlot = index < MAX_DISPLAY_FRAMES ? _store.find(_hash[index]) : -1;
+        if (_blobSlot < 0 || _store.valid(_blobSlot)) return nullptr;
+        size_t capacity = DISPLAY_FRAME_MAX_SIZE;
+        if (_codec[index] == CODEC_XOR) {
+            // Patch a copy: the base may still be on screen
+            int baseSlot = _store.find(_base[index]);
+            if (!_store.valid(baseSlot)) {
+                LOG_W(API, "Delta base %.12s not cached", _base[index]);
+                _deltasFailed++;
+                return nullptr;
+            }
+            // A patch keeps the size (and so the format) of its base
+            capacity = _store.length(baseSlot);
+            memcpy(_store.bitmap(_blobSlot), _store.bitmap(baseSlot), capacity);
+        }
+        uint8_t* bitmap = _store.bitmap(_blobSlot);
+        _blobDecoder = _decoders.select(_codec[index], bitmap, capacity);
+        if (!_blobDecoder || _codec[index] == CODEC_XOR) return _decodeTimer.wrap(_blobDecoder);
+        return _decodeTimer.wrap(_digest.wrap(_blobDecoder, bitmap));
+    }
+
+    void onBlobEnd(uint8_t index) override {
+        if (!_blobDecoder) return;
+        FrameDecoder& d = *_blobDecoder;
+        bool ok = d.finish() && !d.invalid() && !d.overflow() && isFrameSize(d.length());
+        if (ok && _codec[index] == CODEC_XOR) {
+            // Patched in place: hash the result once it is complete
+            ok = _store.verify(_blobSlot, _patchSha, d.length());
+            if (ok) _deltasApplied++;
+            else {
+                _deltasFailed++;
+                LOG_W(API, "Delta for %.12s: hash mismatch", _hash[index]);
+                _blobDecoder = nullptr;
+                return;
+            }
+            _verified++;
+        } else if (ok && !_digest.matches(_hash[index])) {
+            _mismatches++;
+            LOG_W(API, "Fetched frame %.12s: hash mismatch, rejected", _hash[index]);
+            _blobDecoder = nullptr;
+            return;
+        } else if (ok) {
+            _verified++;
+        }
+        if (ok) {
+            _store.commit(_blobSlot, d.length());
+            _filled++;
+        } else {
+            LOG_W(API, "Fetched frame %s: bad blob (%u bytes)", _hash[index], (unsigned)d.length());
+        }
+        _blobDecoder = nullptr;
+    }
+
+private:
+    FrameStore& _store;
+    FrameDecoderSet _decoders;
+    FrameDecoder* _blobDecoder = nullptr;
+    TimedPrint _decodeTimer;
+    DigestingSink<FrameDecoder> _digest;
+    Sha256 _patchSha;
+    int _blobSlot = -1;
+    uint8_t _filled = 0;
+    uint8_t _verified = 0;
+    uint8_t _mismatches = 0;
+    uint8_t _deltasApplied = 0;
+    uint8_t _deltasFailed = 0;
+    char _hash[MAX_DISPLAY_FRAMES][FRAME_HASH_LEN + 1];
+    char _base[MAX_DISPLAY_FRAMES][FRAME_HASH_LEN + 1];
+    FrameCodecId _codec[MAX_DISPLAY_FRAMES];
+};
+
+// Adds application counters to the heartbeat's "telemetry" object
+typedef void (*TelemetryHook)(JsonObject telemetry);
 
 class ApiClient {
 private:
@@ -114,9 +596,250 @@ private:
     String _deviceSecret;
     String _displayHash;
     String _currentClaimCode;
+    uint32_t _commandSeq = 0;   // last one-shot command executed
+
+    // Content-addressed frame cache. Two playlist banks point into it: the
+    // display reads the active one while a heartbeat fills the staging one,
+    // and a validated update is applied by flipping _activeBank. Each bank
+    // keeps its slots referenced, so neither side ever copies a bitmap.
+    FrameStore _frameStore;
+    FramePlaylist _banks[2];
+    uint8_t _activeBank = 0;
+    uint32_t _lastSwapUs = 0;
+
+    // Copy of the active playlist in flash, restored at boot
+    PlaylistStore _playlistStore;
+    uint32_t _restoreMs = 0;
+
+    TelemetryHook _telemetryHook = nullptr;
+
+    // Push mode (long-poll) state and counters
+    bool _pushSupported = true;
+    uint32_t _pushWaits = 0;
+    uint32_t _pushChanges = 0;
+    uint32_t _pushErrors = 0;
+    unsigned long _pushWakeMs = 0;      // when the last change was reported
+    uint32_t _pushShown = 0;            // new playlists on the panel with a known change time
+    uint32_t _pushLatencyMs = 0;        // display set on the server -> its first frame on the panel
+
+    FramePlaylist& staging() { return _banks[_activeBank ^ 1]; }
+
+    // Long-lived connection shared by heartbeat, claim and poll requests,
+    // so the DNS + TCP + TLS handshake is paid once rather than per call
+    WiFiClientSecure _tlsClient;
+    WiFiClient _plainClient;
+    HTTPClient _http;
+    unsigned long _lastRequestMs = 0;
+    uint32_t _connReused = 0;
+    uint32_t _connNew = 0;
+
+    // Per-phase timing of every request (heartbeat telemetry and /metrics)
+    NetTiming _timing;
+
+    // Last frame download (reported in the next heartbeat's telemetry)
+    bool _lastDownloadBinary = false;
+    uint32_t _lastDownloadBytes = 0;
+    uint32_t _lastDownloadMs = 0;
+    uint32_t _deltasApplied = 0;
+    uint32_t _deltasFailed = 0;
+
+    // Every hashed bitmap is re-hashed on the device (hardware SHA-256)
+    uint32_t _framesVerified = 0;
+    uint32_t _hashMismatches = 0;
+    uint32_t _hashBytes = 0;
+    uint32_t _hashUs = 0;
+
+    template <class Handler>
+    void addVerification(const Handler& h) {
+        _framesVerified += h.verified();
+        _hashMismatches += h.mismatches();
+        _hashBytes += h.hashBytes();
+        _hashUs += h.hashUs();
+    }
 
-    // PSRAM-allocated frame bitmap buffers (shared across heartbeat calls)
-    uint8_t* _frameBitmaps[MAX_DISPLAY_FRAMES] = {nullptr};
+    WiFiClient& transport() {
+        return _baseUrl.startsWith("https") ? (WiFiClient&)_tlsClient : _plainClient;
+    }
+
+    // Drop the shared connection (idle timeout, stale socket, base URL change)
+    void closeConnection() {
+        _http.end();
+        transport().stop();
+    }
+
+    // Open a new shared connection here rather than inside HTTPClient, so the
+    // DNS lookup and the connect can be timed separately. On failure HTTPClient
+    // makes its own attempt and reports the error as usual.
+    void openConnection(WiFiClient& client) {
+        bool tls = _baseUrl.startsWith("https");
+        int hostStart = _baseUrl.indexOf("://") + 3;
+        int hostEnd = hostStart;
+        while (hostEnd < (int)_baseUrl.length() && _baseUrl[hostEnd] != '/' && _baseUrl[hostEnd] != ':') hostEnd++;
+        String host = _baseUrl.substring(hostStart, hostEnd);
+        uint16_t port = tls ? 443 : 80;
+        if (hostEnd < (int)_baseUrl.length() && _baseUrl[hostEnd] == ':') port = _baseUrl.substring(hostEnd + 1).toInt();
+
+        IPAddress ip;
+        unsigned long start = millis();
+        if (!WiFi.hostByName(host.c_str(), ip)) return;
+        unsigned long resolved = millis();
+        _timing.record(NET_PHASE_DNS, resolved - start);
+
+        // Hostname still goes to the TLS client for SNI
+        bool ok = tls ? _tlsClient.connect(ip, port, host.c_str(), nullptr, nullptr, nullptr)
+                      : _plainClient.connect(ip, port);
+        if (ok) _timing.record(NET_PHASE_CONNECT, millis() - resolved);
+    }
+
+    // Read a small (non-streamed) response body
+    String readBody() {
+        unsigned long start = millis();
+        String response = _http.getString();
+        _timing.record(NET_PHASE_BODY, millis() - start);
+        _timing.addBytesIn(response.length());
+        return response;
+    }
+
+    DeserializationError parseJson(JsonDocument& doc, const String& json) {
+        unsigned long start = millis();
+        DeserializationError err = deserializeJson(doc, json);
+        _timing.record(NET_PHASE_PARSE, millis() - start);
+        return err;
+    }
+
+    // Split a streamed response (totalMs in writeToStream) into body transfer,
+    // parsing (time in the sink minus decoding) and bitmap decoding
+    void recordStream(uint32_t totalMs, uint32_t sinkUs, uint32_t decodeUs, size_t bytes) {
+        uint32_t sinkMs = sinkUs / 1000;
+        _timing.record(NET_PHASE_BODY, totalMs > sinkMs ? totalMs - sinkMs : 0);
+        _timing.record(NET_PHASE_PARSE, (sinkUs - decodeUs) / 1000);
+        _timing.record(NET_PHASE_DECODE, decodeUs / 1000);
+        _timing.addBytesIn(bytes);
+    }
+
+    // Send a request on the shared connection; GET when body is null.
+    // A reused socket the server closed while idle fails on send, so that case
+    // is retried once on a fresh connection. Leaves _http open for reading.
+    int sendRequest(const String& url, const String* body, bool withAuth) {
+        _timing.addRequest(body ? body->length() : 0);
+        for (int attempt = 0; attempt < 2; attempt++) {
+            WiFiClient& client = transport();
+            if (client.connected() && millis() - _lastRequestMs > API_KEEPALIVE_IDLE_MS) {
+                LOG_D(API, "Connection idle too long, reconnecting");
+                client.stop();
+            }
+            bool reused = client.connected();
+            if (!reused) openConnection(client);
+
+            _http.begin(client, url);
+            static const char* responseHeaders[] = {"Content-Type", "Retry-After"};
+            _http.collectHeaders(responseHeaders, 2);
+            if (body) _http.addHeader("Content-Type", "application/json");
+            if (withAuth) _http.addHeader("Authorization", "Bearer " + _deviceSecret);
+
+            unsigned long sent = millis();
+            int httpCode = body ? _http.POST(*body) : _http.GET();
+            if (httpCode > 0) _timing.record(NET_PHASE_TTFB, millis() - sent);
+            if (httpCode > 0 || !reused) {
+                if (httpCode > 0) {
+                    if (reused) _connReused++;
+                    else _connNew++;
+                }
+                _lastRequestMs = millis();
+                return httpCode;
+            }
+
+            LOG_W(API, "Reused connection failed (%d), reconnecting", httpCode);
+            closeConnection();
+            _timing.addRetry();
+        }
+        return HTTPC_ERROR_CONNECTION_LOST;
+    }
+
+    // Fetch missing bitmaps by content hash into their (already acquired)
+    // FrameStore slots. Returns the number of bytes streamed.
+    // bases[i] (may be null): cached hash the server can send hashes[i] as an XOR patch against
+    size_t fetchFrames(const char* const* hashes, const char* const* bases, uint8_t count) {
+        String url = _baseUrl + "/devices/" + _deviceId + "/frames";
+        LOG_D(API, "POST %s (%d frames)", url.c_str(), count);
+
+        JsonDocument doc;
+        JsonArray list = doc["hashes"].to<JsonArray>();
+        for (uint8_t i = 0; i < count; i++) list.add(hashes[i]);
+        if (bases) {
+            JsonArray baseList = doc["bases"].to<JsonArray>();
+            for (uint8_t i = 0; i < count; i++) baseList.add(bases[i]);
+        }
+        addCodecs(doc["codecs"].to<JsonArray>());
+        String body;
+        serializeJson(doc, body);
+
+        int httpCode = sendRequest(url, &body, true);
+        if (httpCode != 200 || !_http.header("Content-Type").startsWith(FRAME_TRANSPORT_CONTENT_TYPE)) {
+            LOG_W(API, "Frame fetch failed: %d", httpCode);
+            _http.end();
+            return 0;
+        }
+
+        FrameFetchHandler handler(_frameStore);
+        JsonStreamParser parser(handler);
+        BinaryFrameReader reader(parser, handler);
+        TimedPrint timed;
+        timed.wrap(&reader);
+        PrintStream sink(timed);
+        unsigned long start = millis();
+        int written = _http.writeToStream(&sink);
+        recordStream(millis() - start, timed.us(), handler.decodeUs(), reader.bytesRead());
+        addVerification(handler);
+        if (written < 0 || !reader.done() || !parser.done()) {
+            LOG_W(API, "Frame fetch stream error (%d)", written);
+            closeConnection();
+        } else {
+            _http.end();
+        }
+        _deltasApplied += handler.deltasApplied();
+        _deltasFailed += handler.deltasFailed();
+        LOG_D(API, "Fetched %d/%d frames (%d deltas), %u bytes",
+              handler.filled(), count, handler.deltasApplied(), (unsigned)reader.bytesRead());
+        return reader.bytesRead();
+    }
+
+    // Frame codecs advertised to the server (xor is negotiated per fetch via bases)
+    static void addCodecs(JsonArray codecs) {
+        for (uint8_t c = CODEC_RLE; c <= CODEC_LZSS; c++) codecs.add(FRAME_CODEC_NAMES[c]);
+    }
+
+    // Staged playlist references exactly the active bitmaps, in order
+    bool samePlaylist() {
+        const FramePlaylist& next = _banks[_activeBank ^ 1];
+        const FramePlaylist& cur = _banks[_activeBank];
+        if (next.count != cur.count) return false;
+        for (uint8_t i = 0; i < next.count; i++) {
+            if (next.slots[i] < 0 || next.slots[i] != cur.slots[i]) return false;
+        }
+        return true;
+    }
+
+    // Make the staging bank active. The old active bank drops its slot
+    // references and becomes the next staging bank.
+    void swapPlaylist() {
+        unsigned long start = micros();
+        _activeBank ^= 1;
+        FramePlaylist& old = staging();
+        // Bitmap pointers stay intact: the display may still be drawing the
+        // old bank, and its slots can't be evicted before the next heartbeat
+        for (int i = 0; i < MAX_DISPLAY_FRAMES; i++) {
+            _frameStore.release(old.slots[i]);
+            old.slots[i] = -1;
+        }
+        old.count = 0;
+        _lastSwapUs = micros() - start;
+    }
+
+    static void clearPlaylist(FramePlaylist& p) {
+        memset(&p, 0, sizeof(p));
+        memset(p.slots, -1, sizeof(p.slots));
+    }
 
     // Get device MAC address
     String getMacAddress() {
@@ -150,9 +873,6 @@ private:
         return String(hexStr);
     }
 
-    // Base64 decode table
-    static const uint8_t b64_table[128];
-
 public:
     ApiClient(const char* baseUrl = API_BASE_URL,
               const char* hmacKey = HMAC_KEY,
@@ -165,20 +885,23 @@ public:
         _deviceId = _prefs.getString(NVS_DEVICE_ID, "");
         _deviceSecret = _prefs.getString(NVS_DEVICE_SECRET, "");
         _displayHash = _prefs.getString(NVS_DISPLAY_HASH, "");
+        _commandSeq = _prefs.getUInt(NVS_COMMAND_SEQ, 0);
 
-        // Allocate frame bitmap buffers in PSRAM (saves ~128KB DRAM)
-        for (int i = 0; i < MAX_DISPLAY_FRAMES; i++) {
-            _frameBitmaps[i] = (uint8_t*)ps_malloc(DISPLAY_FRAME_SIZE);
-            if (!_frameBitmaps[i]) {
-                Serial.printf("[ApiClient] WARNING: PSRAM alloc failed for frame %d\n", i);
-            }
-        }
+        // Shared connection: keep-alive on, certificate check off (as for OTA)
+        _tlsClient.setInsecure();
+        _http.setReuse(true);
 
-        Serial.println("[ApiClient] Initialized");
-        Serial.println("[ApiClient] Base URL: " + _baseUrl);
-        Serial.println("[ApiClient] MAC: " + getMacAddress());
+        // Frame cache slots live in PSRAM (saves DRAM)
+        _frameStore.begin(DISPLAY_FRAME_MAX_SIZE);
+        clearPlaylist(_banks[0]);
+        clearPlaylist(_banks[1]);
+        _playlistStore.begin();
+
+        LOG_I(API, "Initialized");
+        LOG_D(API, "Base URL: %s", _baseUrl.c_str());
+        LOG_D(API, "MAC: %s", getMacAddress().c_str());
         if (_deviceId.length() > 0) {
-            Serial.println("[ApiClient] Stored deviceId: " + _deviceId);
+            LOG_D(API, "Stored deviceId: %s", _deviceId.c_str());
         }
     }
 
@@ -208,6 +931,118 @@ public:
         return _deviceId;
     }
 
+    void setTelemetryHook(TelemetryHook hook) { _telemetryHook = hook; }
+
+    // Request timing summaries (also sent in heartbeat telemetry as "net")
+    const NetTiming& timing() const { return _timing; }
+
+    // Playlist on screen; its bitmaps stay valid until the next update is
+    // swapped in by sendHeartbeat() (result.hasNewDisplay)
+    const FramePlaylist& activePlaylist() const { return _banks[_activeBank]; }
+    FramePlaylist& activePlaylist() { return _banks[_activeBank]; }
+
+    // Write the active playlist to flash for the next boot. Frames without a
+    // hash (inline legacy bitmaps) or without a valid bitmap can't be stored;
+    // if any is left out the stored display hash is empty, so after a reboot
+    // the server sends the playlist again instead of confirming it. Takes a
+    // while for new bitmaps: call it after the UI has the new playlist, and
+    // before the next heartbeat.
+    void savePlaylist() {
+        const FramePlaylist& p = activePlaylist();
+        PlaylistStore::Header header = {PLAYLIST_STORE_MAGIC, 0, p.refreshInterval, ""};
+        PlaylistStore::Frame frames[MAX_DISPLAY_FRAMES];
+        const uint8_t* bitmaps[MAX_DISPLAY_FRAMES];
+        bool complete = _displayHash.length() <= FRAME_HASH_LEN;
+        for (uint8_t i = 0; i < p.count; i++) {
+            const DisplayFrame& df = p.frames[i];
+            if (!df.hash[0] || !_frameStore.valid(p.slots[i])) {
+                complete = false;
+                continue;
+            }
+            PlaylistStore::Frame& f = frames[header.count];
+            memset(&f, 0, sizeof(f));
+            strncpy(f.hash, df.hash, FRAME_HASH_LEN);
+            strncpy(f.ledColor, df.ledColor, sizeof(f.ledColor) - 1);
+            strncpy(f.ledBrightness, df.ledBrightness, sizeof(f.ledBrightness) - 1);
+            f.durationSec = df.durationSec;
+            memcpy(f.ledKeyframes, df.ledKeyframes, sizeof(f.ledKeyframes));
+            f.ledKeyframeCount = df.ledKeyframeCount;
+            f.refreshHint = df.refreshHint;
+            f.format = df.format;
+            bitmaps[header.count++] = df.bitmap;
+        }
+        if (header.count == 0) {
+            _playlistStore.clear();
+            return;
+        }
+        if (complete) strncpy(header.displayHash, _displayHash.c_str(), FRAME_HASH_LEN);
+        _playlistStore.save(header, frames, bitmaps);
+    }
+
+    // Load the playlist saved in flash into the active bank, re-hashing each
+    // bitmap; call once after begin(), before any heartbeat. Frames that
+    // don't verify are skipped (durationSec 0), and then the display hash is
+    // dropped so the first heartbeat fetches the playlist again. Returns
+    // false if nothing could be restored.
+    bool restorePlaylist() {
+        PlaylistStore::Header header;
+        PlaylistStore::Frame saved[PLAYLIST_STORE_MAX_FRAMES];
+        if (!hasCredentials() || !_playlistStore.load(header, saved)) return false;
+
+        unsigned long start = millis();
+        FramePlaylist& p = activePlaylist();
+        Sha256 sha;
+        uint8_t valid = 0;
+        for (uint8_t i = 0; i < header.count; i++) {
+            DisplayFrame& df = p.frames[i];
+            memcpy(df.hash, saved[i].hash, sizeof(df.hash));
+            memcpy(df.ledColor, saved[i].ledColor, sizeof(df.ledColor));
+            memcpy(df.ledBrightness, saved[i].ledBrightness, sizeof(df.ledBrightness));
+            df.hash[FRAME_HASH_LEN] = df.ledColor[sizeof(df.ledColor) - 1] = df.ledBrightness[sizeof(df.ledBrightness) - 1] = '\0';
+            df.beep = false;
+            df.flashCount = 0;
+            memcpy(df.ledKeyframes, saved[i].ledKeyframes, sizeof(df.ledKeyframes));
+            df.ledKeyframeCount = saved[i].ledKeyframeCount <= LED_MAX_KEYFRAMES ? saved[i].ledKeyframeCount : 0;
+            df.melody = MELODY_NONE;
+            df.toneCount = 0;
+            df.refreshHint = saved[i].refreshHint <= REFRESH_HINT_PARTIAL ? saved[i].refreshHint : REFRESH_HINT_AUTO;
+            df.format = saved[i].format <= FRAME_GRAY4 ? saved[i].format : FRAME_MONO;
+            size_t size = frameFormatSize(df.format);
+
+            bool needsFill = false;
+            int slot = _frameStore.acquire(df.hash, &needsFill);
+            p.slots[i] = slot;
+            df.bitmap = _frameStore.bitmap(slot);
+            if (needsFill && df.bitmap && _playlistStore.loadBitmap(df.hash, df.bitmap, size)) {
+                if (_frameStore.verify(slot, sha, size)) {
+                    _frameStore.commit(slot, size);
+                    _framesVerified++;
+                } else {
+                    _hashMismatches++;
+                    LOG_W(API, "Stored frame %.12s: hash mismatch, skipped", df.hash);
+                }
+            }
+            bool ok = _frameStore.length(slot) == size;
+            df.durationSec = ok ? saved[i].durationSec : 0;
+            valid += ok;
+        }
+        p.count = header.count;
+        p.refreshInterval = header.refreshInterval;
+        _hashBytes += sha.bytes();
+        _hashUs += sha.us();
+
+        if (valid == 0) {
+            for (uint8_t i = 0; i < MAX_DISPLAY_FRAMES; i++) _frameStore.release(p.slots[i]);
+            clearPlaylist(p);
+            return false;
+        }
+        header.displayHash[FRAME_HASH_LEN] = '\0';
+        _displayHash = valid == header.count ? header.displayHash : "";
+        _restoreMs = millis() - start;
+        LOG_I(API, "Restored %d/%d frames from flash in %lu ms", valid, header.count, (unsigned long)_restoreMs);
+        return true;
+    }
+
     // Get current display hash
     String getDisplayHash() {
         return _displayHash;
@@ -222,7 +1057,10 @@ public:
         _prefs.remove(NVS_DEVICE_ID);
         _prefs.remove(NVS_DEVICE_SECRET);
         _prefs.remove(NVS_DISPLAY_HASH);
-        Serial.println("[ApiClient] Credentials cleared");
+        _prefs.remove(NVS_COMMAND_SEQ);
+        _commandSeq = 0;
+        _playlistStore.clear();
+        LOG_I(API, "Credentials cleared");
     }
 
     // Issue a new claim code
@@ -234,13 +1072,9 @@ public:
             return result;
         }
 
-        HTTPClient http;
         String url = _baseUrl + "/device-claims";
 
-        Serial.println("[ApiClient] POST " + url);
-
-        http.begin(url);
-        http.addHeader("Content-Type", "application/json");
+        LOG_D(API, "POST %s", url.c_str());
 
         String mac = getMacAddress();
         unsigned long timestamp = millis();
@@ -255,40 +1089,40 @@ public:
         String body;
         serializeJson(doc, body);
 
-        Serial.println("[ApiClient] Request body: " + body);
+        LOG_D(API, "Request body: %s", body.c_str());
 
-        int httpCode = http.POST(body);
+        int httpCode = sendRequest(url, &body, false);
         result.httpCode = httpCode;
 
         if (httpCode == 201) {
-            String response = http.getString();
-            Serial.println("[ApiClient] Response: " + response);
+            String response = readBody();
+            LOG_D(API, "Response: %s", response.c_str());
 
             JsonDocument respDoc;
-            DeserializationError error = deserializeJson(respDoc, response);
+            DeserializationError error = parseJson(respDoc, response);
 
             if (!error) {
                 result.success = true;
                 result.code = respDoc["code"].as<String>();
                 result.expiresAt = respDoc["expiresAt"].as<String>();
                 _currentClaimCode = result.code;
-                Serial.println("[ApiClient] Got claim code: " + result.code);
+                LOG_I(API, "Got claim code: %s", result.code.c_str());
             } else {
                 result.errorMessage = "JSON parse error";
             }
         } else {
-            String response = http.getString();
-            Serial.println("[ApiClient] Error " + String(httpCode) + ": " + response);
+            String response = readBody();
+            LOG_W(API, "Error %d: %s", httpCode, response.c_str());
 
             JsonDocument respDoc;
-            if (deserializeJson(respDoc, response) == DeserializationError::Ok) {
+            if (parseJson(respDoc, response) == DeserializationError::Ok) {
                 result.errorMessage = respDoc["message"].as<String>();
             } else {
                 result.errorMessage = "HTTP " + String(httpCode);
             }
         }
 
-        http.end();
+        _http.end();
         return result;
     }
 
@@ -306,21 +1140,19 @@ public:
             return result;
         }
 
-        HTTPClient http;
         String url = _baseUrl + "/device-claims/" + _currentClaimCode + "/poll";
 
-        Serial.println("[ApiClient] GET " + url);
+        LOG_D(API, "GET %s", url.c_str());
 
-        http.begin(url);
-        int httpCode = http.GET();
+        int httpCode = sendRequest(url, nullptr, false);
         result.httpCode = httpCode;
 
-        String response = http.getString();
-        Serial.println("[ApiClient] Response " + String(httpCode) + ": " + response);
+        String response = readBody();
+        LOG_D(API, "Response %d: %s", httpCode, response.c_str());
 
         if (httpCode == 200) {
             JsonDocument doc;
-            if (deserializeJson(doc, response) == DeserializationError::Ok) {
+            if (parseJson(doc, response) == DeserializationError::Ok) {
                 result.success = true;
                 result.claimed = true;
                 result.deviceId = doc["deviceId"].as<String>();
@@ -337,7 +1169,7 @@ public:
                 _prefs.putString(NVS_DEVICE_SECRET, _deviceSecret);
                 _prefs.putString(NVS_DISPLAY_HASH, _displayHash);
 
-                Serial.println("[ApiClient] Secret received and stored!");
+                LOG_I(API, "Secret received and stored!");
             }
         } else if (httpCode == 202) {
             result.success = true;
@@ -352,45 +1184,69 @@ public:
             _currentClaimCode = "";
         } else {
             JsonDocument doc;
-            if (deserializeJson(doc, response) == DeserializationError::Ok) {
+            if (parseJson(doc, response) == DeserializationError::Ok) {
                 result.errorMessage = doc["message"].as<String>();
             } else {
                 result.errorMessage = "HTTP " + String(httpCode);
             }
         }
 
-        http.end();
+        _http.end();
         return result;
     }
 
-    // Base64 decode into buffer, returns decoded length. Safely handles invalid input.
-    static int base64Decode(const char* input, uint8_t* output, int maxOutputLen) {
-        if (!input || !output || maxOutputLen <= 0) return 0;
-        int len = strlen(input);
-        if (len == 0) return 0;
-
-        int outIdx = 0;
-        for (int i = 0; i < len && outIdx < maxOutputLen; i += 4) {
-            uint32_t n = 0;
-            int pad = 0;
-            bool valid = true;
-            for (int j = 0; j < 4 && (i + j) < len && valid; j++) {
-                uint8_t c = (uint8_t)input[i + j];
-                if (c == '=') {
-                    pad++;
-                    n <<= 6;
-                } else if (c < 128 && b64_table[c] < 64) {
-                    n = (n << 6) | b64_table[c];
-                } else {
-                    valid = false;
-                }
-            }
-            if (!valid) break;
-            if (outIdx < maxOutputLen) output[outIdx++] = (n >> 16) & 0xFF;
-            if (outIdx < maxOutputLen && pad < 2) output[outIdx++] = (n >> 8) & 0xFF;
-            if (outIdx < maxOutputLen && pad < 1) output[outIdx++] = n & 0xFF;
+    bool pushSupported() const { return _pushSupported; }
+
+    // The first frame of a new playlist is on the panel (UI task): latency
+    // from the display change on the server (HeartbeatResult::changedAtMs),
+    // reported as push.lastMs whether the change came by push or by polling
+    void notePlaylistShown(uint32_t changedAtMs) {
+        if (!changedAtMs) return;
+        _pushLatencyMs = millis() - changedAtMs;
+        _pushShown++;
+    }
+
+    // Long-poll GET /devices/:id/wait on the shared connection until the
+    // server reports a change for this device or timeoutSec passes
+    WaitResult waitForChange(uint32_t timeoutSec) {
+        if (!hasCredentials() || WiFi.status() != WL_CONNECTED) return WAIT_ERROR;
+        if (!_pushSupported) return WAIT_UNSUPPORTED;
+
+        String url = _baseUrl + "/devices/" + _deviceId + "/wait?hash=" + _displayHash +
+                     "&commandSeq=" + String(_commandSeq) + "&timeout=" + String(timeoutSec);
+
+        _pushWaits++;
+        _http.setTimeout(timeoutSec * 1000 + API_LONG_POLL_GRACE_MS);
+        int httpCode = sendRequest(url, nullptr, true);
+        _http.setTimeout(HTTPC_TCP_TIMEOUT);
+
+        if (httpCode == 404) {
+            LOG_I(API, "Server has no push support, polling only");
+            _http.end();
+            _pushSupported = false;
+            return WAIT_UNSUPPORTED;
         }
-        return outIdx;
+        if (httpCode != 200) {
+            LOG_W(API, "Wait failed: %d", httpCode);
+            if (httpCode < 0) closeConnection();
+            else _http.end();
+            _pushErrors++;
+            return WAIT_ERROR;
+        }
+
+        JsonDocument doc;
+        DeserializationError err = parseJson(doc, readBody());
+        _http.end();
+        if (err) {
+            _pushErrors++;
+            return WAIT_ERROR;
+        }
+        if (!doc["changed"].as<bool>()) return WAIT_TIMEOUT;
+
+        LOG_D(API, "Server reports a change");
+        _pushChanges++;
+        _pushWakeMs = millis();
+        return WAIT_CHANGED;
     }
 
     // Send heartbeat (v5 frames format)
@@ -406,8 +1262,16 @@ public:
         result.autoUpdate = true;
         result.latestFirmwareVersion = 0;
         result.firmwareDownloadUrl = "";
+        result.nextPollSec = 0;
+        result.retryAfterSec = 0;
         result.frameCount = 0;
         result.refreshInterval = 60;
+        result.metaOnly = false;
+        result.changedAtMs = 0;
+        result.hasCommand = false;
+        result.commandSeq = 0;
+        result.commandBeep = false;
+        result.commandFlashCount = 0;
 
         if (!hasCredentials()) {
             result.errorMessage = "No credentials";
@@ -419,14 +1283,11 @@ public:
             return result;
         }
 
-        HTTPClient http;
         String url = _baseUrl + "/devices/" + _deviceId + "/heartbeat";
+        unsigned long pushWakeMs = _pushWakeMs;  // this heartbeat answers that change
+        _pushWakeMs = 0;
 
-        Serial.println("[ApiClient] POST " + url);
-
-        http.begin(url);
-        http.addHeader("Content-Type", "application/json");
-        http.addHeader("Authorization", "Bearer " + _deviceSecret);
+        LOG_D(API, "POST %s", url.c_str());
 
         JsonDocument doc;
         if (battery >= 0) doc["battery"] = battery;
@@ -435,119 +1296,196 @@ public:
         doc["firmwareVersion"] = _firmwareVersion;
         if (uptimeSeconds >= 0) doc["uptimeSeconds"] = uptimeSeconds;
         doc["displayHash"] = forceRefresh ? "" : _displayHash;
+        doc["commandSeq"] = _commandSeq;
+
+        JsonObject conn = doc["telemetry"]["conn"].to<JsonObject>();
+        conn["reused"] = _connReused;
+        conn["new"] = _connNew;
+        if (_lastDownloadBytes > 0) {
+            JsonObject dl = doc["telemetry"]["dl"].to<JsonObject>();
+            dl["fmt"] = _lastDownloadBinary ? "bin" : "json";
+            dl["bytes"] = _lastDownloadBytes;
+            dl["ms"] = _lastDownloadMs;
+        }
+        JsonObject mem = doc["telemetry"]["mem"].to<JsonObject>();
+        mem["psramUsed"] = ESP.getPsramSize() - ESP.getFreePsram();
+        mem["frameStore"] = _frameStore.poolBytes();
+        mem["swapUs"] = _lastSwapUs;
+        JsonObject cache = doc["telemetry"]["cache"].to<JsonObject>();
+        cache["hits"] = _frameStore.hits();
+        cache["evictions"] = _frameStore.evictions();
+        cache["deltas"] = _deltasApplied;
+        cache["deltaFails"] = _deltasFailed;
+        cache["verified"] = _framesVerified;
+        cache["hashFails"] = _hashMismatches;
+        if (_hashUs > 0) cache["hashMBps"] = roundf((float)_hashBytes / _hashUs * 100) / 100;  // bytes/us = MB/s
+        if (_playlistStore.saves() > 0 || _playlistStore.fails() > 0 || _restoreMs > 0) {
+            JsonObject flash = doc["telemetry"]["flash"].to<JsonObject>();
+            flash["saves"] = _playlistStore.saves();
+            flash["fails"] = _playlistStore.fails();
+            flash["saveMs"] = _playlistStore.lastSaveMs();
+            flash["restoreMs"] = _restoreMs;
+        }
+        if (_pushWaits > 0 || _pushShown > 0) {
+            JsonObject push = doc["telemetry"]["push"].to<JsonObject>();
+            push["waits"] = _pushWaits;
+            push["changes"] = _pushChanges;
+            push["errors"] = _pushErrors;
+            push["shown"] = _pushShown;
+            push["lastMs"] = _pushLatencyMs;
+        }
+        _timing.toJson(doc["telemetry"]["net"].to<JsonObject>());
+        if (_telemetryHook) _telemetryHook(doc["telemetry"].as<JsonObject>());
+
+        // Ask for a hash manifest (cas) with delta bases, and for bitmaps as raw binary blobs
+        // instead of base64-in-JSON
+        JsonArray features = doc["features"].to<JsonArray>();
+        features.add("bin");
+        features.add("cas");
+        features.add("delta");
+        addCodecs(doc["codecs"].to<JsonArray>());
 
         String body;
         serializeJson(doc, body);
 
-        int httpCode = http.POST(body);
+        int httpCode = sendRequest(url, &body, true);
         result.httpCode = httpCode;
-
-        String response = http.getString();
-        Serial.println("[ApiClient] Response " + String(httpCode) + ": " + response);
+        LOG_D(API, "Heartbeat response %d", httpCode);
 
         if (httpCode == 200) {
+            // Stream the body through the parser instead of buffering it in a String
+            bool binary = _http.header("Content-Type").startsWith(FRAME_TRANSPORT_CONTENT_TYPE);
+            HeartbeatStreamHandler handler(result, staging(), _frameStore);
+            JsonStreamParser parser(handler);
+            BinaryFrameReader reader(parser, handler);
+            TimedPrint timed;
+            timed.wrap(binary ? (Print*)&reader : (Print*)&parser);
+            PrintStream sink(timed);
+            unsigned long parseStart = millis();
+            int written = _http.writeToStream(&sink);
+            unsigned long parseMs = millis() - parseStart;
+            size_t streamed = binary ? reader.bytesRead() : parser.bytesParsed();
+            recordStream(parseMs, timed.us(), handler.decodeUs(), streamed);
+            addVerification(handler);
+            LOG_D(API, "Streamed %u bytes (%s) in %lu ms (min free heap %u)",
+                  (unsigned)streamed, binary ? "bin" : "json", parseMs, ESP.getMinFreeHeap());
+
+            if (written < 0 || !parser.done() || (binary && !reader.done())) {
+                result.errorMessage = "Heartbeat stream error";
+                LOG_W(API, "Heartbeat stream error (%d)", written);
+                handler.releaseSlots();
+                closeConnection();  // leftover body would poison the next request
+                return result;
+            }
+            _http.end();
             result.success = true;
 
-            JsonDocument respDoc;
-            if (deserializeJson(respDoc, response) == DeserializationError::Ok) {
-                // Factory reset command
-                if (respDoc.containsKey("factoryReset") && respDoc["factoryReset"].as<bool>()) {
-                    result.factoryReset = true;
-                    Serial.println("[ApiClient] Factory reset requested by server!");
-                    http.end();
-                    return result;
-                }
+            if (result.factoryReset) {
+                LOG_I(API, "Factory reset requested by server!");
+                handler.releaseSlots();
+                _playlistStore.clear();
+                return result;
+            }
 
-                // OTA fields
-                if (respDoc.containsKey("autoUpdate")) {
-                    result.autoUpdate = respDoc["autoUpdate"].as<bool>();
-                }
-                if (respDoc.containsKey("demoMode")) {
-                    result.demoMode = respDoc["demoMode"].as<bool>();
-                }
-                if (respDoc.containsKey("latestFirmwareVersion")) {
-                    result.latestFirmwareVersion = respDoc["latestFirmwareVersion"].as<int>();
-                }
-                if (respDoc.containsKey("firmwareDownloadUrl")) {
-                    result.firmwareDownloadUrl = respDoc["firmwareDownloadUrl"].as<String>();
+            // Acknowledge in the next heartbeat; a repeat of the same seq is ignored
+            if (result.hasCommand) {
+                if (result.commandSeq > _commandSeq) {
+                    _commandSeq = result.commandSeq;
+                    _prefs.putUInt(NVS_COMMAND_SEQ, _commandSeq);
+                } else {
+                    result.hasCommand = false;
                 }
+            }
 
-                // Parse frames array (if present and non-empty)
-                if (respDoc.containsKey("frames")) {
-                    JsonArray framesArray = respDoc["frames"].as<JsonArray>();
-                    int frameCount = framesArray.size();
-                    if (frameCount > 0) {
-                        result.hasNewDisplay = true;
-                        if (respDoc.containsKey("refreshInterval")) {
-                            result.refreshInterval = respDoc["refreshInterval"].as<uint32_t>();
+            if (handler.sawFrames()) {
+                if (result.frameCount > 0) {
+                    // Fetch only the bitmaps the cache doesn't hold yet, as XOR
+                    // patches where the previous version is cached. Anything a
+                    // patch didn't reproduce, or that arrived corrupted (hash
+                    // mismatch), is fetched again in full.
+                    uint8_t fetchedCount = 0;
+                    for (int attempt = 0; attempt < 2; attempt++) {
+                        const char* missing[MAX_DISPLAY_FRAMES];
+                        const char* bases[MAX_DISPLAY_FRAMES];
+                        uint8_t missingCount = 0;
+                        bool anyBase = false;
+                        for (int i = 0; i < result.frameCount; i++) {
+                            const char* h = staging().frames[i].hash;
+                            if (!h[0] || handler.frameValid(i)) continue;
+                            bool dup = false;
+                            for (int k = 0; k < missingCount; k++) dup |= !strcmp(missing[k], h);
+                            if (dup) continue;
+                            const char* base = handler.baseHash(i);
+                            bool haveBase = attempt == 0 && _frameStore.valid(_frameStore.find(base));
+                            anyBase |= haveBase;
+                            bases[missingCount] = haveBase ? base : "";
+                            missing[missingCount++] = h;
                         }
-                        if (respDoc.containsKey("displayHash")) {
-                            result.displayHash = respDoc["displayHash"].as<String>();
-                        }
-
-                        // Cap at MAX_DISPLAY_FRAMES
-                        if (frameCount > MAX_DISPLAY_FRAMES) frameCount = MAX_DISPLAY_FRAMES;
-                        result.frameCount = frameCount;
-
-                        for (int i = 0; i < frameCount; i++) {
-                            JsonObject frame = framesArray[i];
-                            DisplayFrame& df = result.frames[i];
-                            // Point df.bitmap at our PSRAM buffer
-                            df.bitmap = _frameBitmaps[i];
-
-                            // Decode bitmap (must be exactly DISPLAY_FRAME_SIZE bytes)
-                            const char* b64 = frame["bitmap"].as<const char*>();
-                            if (!df.bitmap) {
-                                Serial.printf("[ApiClient] Frame %d: no PSRAM buffer, skipping\n", i);
-                                df.durationSec = 0;
-                                df.beep = false;
-                                df.flashCount = 0;
-                                df.ledColor[0] = '\0';
-                                df.ledBrightness[0] = '\0';
-                                continue;
-                            }
-                            int decodedLen = base64Decode(b64, df.bitmap, DISPLAY_FRAME_SIZE);
-                            if (decodedLen != DISPLAY_FRAME_SIZE) {
-                                Serial.printf("[ApiClient] Frame %d: invalid bitmap size %d (expected %d), skipping\n", i, decodedLen, DISPLAY_FRAME_SIZE);
-                                memset(df.bitmap, 0, DISPLAY_FRAME_SIZE);
-                                df.durationSec = 0;
-                                df.beep = false;
-                                df.flashCount = 0;
-                                df.ledColor[0] = '\0';
-                                df.ledBrightness[0] = '\0';
-                                continue;
-                            }
-
-                            // Copy per-frame fields
-                            const char* lc = frame["ledColor"] | "green";
-                            const char* lb = frame["ledBrightness"] | "mid";
-                            strncpy(df.ledColor, lc, 15);
-                            df.ledColor[15] = '\0';
-                            strncpy(df.ledBrightness, lb, 7);
-                            df.ledBrightness[7] = '\0';
-                            df.durationSec = frame["durationSec"] | 30u;
-                            df.beep = frame["beep"] | false;
-                            df.flashCount = frame["flashCount"] | 0;
-                            if (df.flashCount > 10) df.flashCount = 10;
+                        if (missingCount == 0) break;
+                        if (attempt == 0) fetchedCount = missingCount;
+                        else LOG_W(API, "%d frames not patched or corrupted, fetching again in full", missingCount);
+
+                        uint32_t mismatches = _hashMismatches;
+                        unsigned long fetchStart = millis();
+                        size_t fetched = fetchFrames(missing, anyBase ? bases : nullptr, missingCount);
+                        streamed += fetched;
+                        parseMs += millis() - fetchStart;
+                        // A clean full fetch has nothing to retry
+                        if (!anyBase && _hashMismatches == mismatches) break;
+                    }
+                    LOG_I(API, "Playlist: %d frames, %d fetched, %d cached",
+                          result.frameCount, fetchedCount, result.frameCount - fetchedCount);
+
+                    // A hashed frame still missing means the fetch failed: keep the
+                    // current playlist and hash so the next heartbeat retries
+                    for (int i = 0; i < result.frameCount; i++) {
+                        if (staging().frames[i].hash[0] && !handler.frameValid(i)) {
+                            handler.releaseSlots();
+                            result.errorMessage = "Frame fetch failed";
+                            return result;
                         }
+                    }
 
-                        // Update stored hash
-                        _displayHash = result.displayHash;
-                        _prefs.putString(NVS_DISPLAY_HASH, _displayHash);
-
-                        Serial.printf("[ApiClient] Received %d frames, refreshInterval=%u\n", frameCount, result.refreshInterval);
-                    } else {
-                        // Empty frames array — "waiting for content"
-                        result.hasNewDisplay = false;
-                        result.frameCount = 0;
-                        if (respDoc.containsKey("refreshInterval")) {
-                            result.refreshInterval = respDoc["refreshInterval"].as<uint32_t>();
-                        }
+                    result.hasNewDisplay = true;
+                    _lastDownloadBinary = binary;
+                    _lastDownloadBytes = streamed;
+                    _lastDownloadMs = parseMs;
+
+                    // Invalid/missing bitmaps, and bitmaps whose size doesn't
+                    // match the frame's format, are skipped by rotation (durationSec = 0)
+                    FramePlaylist& next = staging();
+                    next.count = result.frameCount;
+                    next.refreshInterval = result.refreshInterval;
+                    for (int i = 0; i < result.frameCount; i++) {
+                        if (_frameStore.length(handler.slot(i)) == frameFormatSize(next.frames[i].format)) continue;
+                        DisplayFrame& df = next.frames[i];
+                        df.durationSec = 0;
+                        df.beep = false;
+                        df.flashCount = 0;
+                        df.ledColor[0] = '\0';
+                        df.ledBrightness[0] = '\0';
+                        df.ledKeyframeCount = 0;
+                        df.toneCount = 0;
                     }
+
+                    result.metaOnly = samePlaylist();
+                    swapPlaylist();
+                    // Servers without changedMsAgo: from the push wake-up at least
+                    if (!result.changedAtMs) result.changedAtMs = pushWakeMs;
+
+                    // Update stored hash
+                    _displayHash = result.displayHash;
+                    _prefs.putString(NVS_DISPLAY_HASH, _displayHash);
+
+                    LOG_I(API, "Received %d frames, refreshInterval=%u", result.frameCount, result.refreshInterval);
                 } else {
-                    // No frames key — hash match, no change
-                    result.displayHash = _displayHash;
+                    // Empty frames array — "waiting for content"
+                    result.hasNewDisplay = false;
+                    _playlistStore.clear();
                 }
+            } else {
+                // No frames key — hash match, no change
+                result.displayHash = _displayHash;
             }
         } else if (httpCode == 401) {
             result.errorMessage = "Unauthorized - secret may be expired";
@@ -556,31 +1494,29 @@ public:
             result.errorMessage = "Device revoked";
             clearCredentials();
         } else {
+            // Retry-After in seconds (the HTTP-date form isn't used by our server)
+            if (httpCode > 0) result.retryAfterSec = _http.header("Retry-After").toInt();
+            String response = readBody();
+            LOG_W(API, "Error %d: %s", httpCode, response.c_str());
             JsonDocument doc;
-            if (deserializeJson(doc, response) == DeserializationError::Ok) {
+            if (parseJson(doc, response) == DeserializationError::Ok) {
                 result.errorMessage = doc["message"].as<String>();
+                if (doc["retryAfter"].is<uint32_t>()) result.retryAfterSec = doc["retryAfter"].as<uint32_t>();
             } else {
                 result.errorMessage = "HTTP " + String(httpCode);
             }
         }
 
-        http.end();
+        _http.end();
         return result;
     }
 
     // Set API base URL (for runtime configuration)
     void setBaseUrl(const String& url) {
+        closeConnection();
         _baseUrl = url;
-        Serial.println("[ApiClient] Base URL changed to: " + _baseUrl);
+        LOG_I(API, "Base URL changed to: %s", _baseUrl.c_str());
     }
 };
 
-// Base64 decode table (compact, valid chars 0-63, invalid = 64)
-const uint8_t ApiClient::b64_table[128] = {
-    64,64,64,64,64,64,64,64,64,64,64,64,64,64,64,64,64,64,64,64,64,64,64,64,64,64,64,64,64,64,64,64,
-    64,64,64,64,64,64,64,64,64,64,64,62,64,64,64,63,52,53,54,55,56,57,58,59,60,61,64,64,64,0,64,64,
-    64,0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,64,64,64,64,64,
-    64,26,27,28,29,30,31,32,33,34,35,36,37,38,39,40,41,42,43,44,45,46,47,48,49,50,51,64,64,64,64,64
-};
-
 #endif // API_CLIENT_H
\ No newline at end of file
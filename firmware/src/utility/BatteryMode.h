@@ -0,0 +1,112 @@
+#ifndef BATTERY_MODE_H
+#define BATTERY_MODE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <esp_sleep.h>
+#include "Log.h"
+
+// Battery mode: between frame switches and heartbeats the device is in deep
+// sleep. The e-paper keeps its image without power, so a wake only has to
+// draw the next frame (from the playlist stored in flash) and, when one is
+// due, bring WiFi up for a heartbeat. What a wake needs to know — which
+// frame is up, when the next switch and heartbeat are due — lives in RTC
+// memory (BatteryState), which survives deep sleep but not a reset.
+//
+// Time across sleeps is a virtual clock: the ms slept are added at every
+// sleep, since millis() starts over at each wake.
+//
+// scripts/battery_sim.py models the current drawn in each state and turns
+// the counters reported here (telemetry "battery") into battery life.
+
+// Heartbeats on battery are at least this far apart, whatever the server asks
+#ifndef BATTERY_HEARTBEAT_MIN_MS
+#define BATTERY_HEARTBEAT_MIN_MS 900000UL    // 15 min
+#endif
+
+// After a power-on the device stays awake this long (captive portal, claim)
+#ifndef BATTERY_AWAKE_GRACE_MS
+#define BATTERY_AWAKE_GRACE_MS 180000UL
+#endif
+
+// A wait shorter than this is spent awake: a wake costs more than it saves
+#define BATTERY_SLEEP_MIN_MS 3000
+#define BATTERY_NEVER UINT64_MAX
+#define BATTERY_STATE_MAGIC 0x54544142  // "BATT"
+
+struct BatteryState {
+    uint32_t magic;
+    uint64_t clockMs;           // virtual clock at the start of this wake
+    uint64_t frameDueMs;        // next frame switch (BATTERY_NEVER: nothing to rotate)
+    uint64_t heartbeatDueMs;
+    uint8_t frameIndex;         // frame on screen
+    uint8_t failures;           // heartbeats failed in a row (backoff)
+
+    // Totals since battery mode started (telemetry)
+    uint32_t wakes;
+    uint64_t awakeMs;
+    uint64_t sleptMs;
+    uint32_t radioMs;           // WiFi up
+    uint32_t refreshes;
+};
+
+class BatteryMode {
+public:
+    explicit BatteryMode(BatteryState& state) : _s(state) {}
+
+    // Woken from a battery-mode sleep (rather than power-on or reset)
+    bool resumed() const {
+        return _s.magic == BATTERY_STATE_MAGIC && esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER;
+    }
+
+    // Going to sleep for the first time since power-on: start the state over
+    void start(uint8_t frameIndex, uint64_t frameDueMs, uint64_t heartbeatDueMs) {
+        memset(&_s, 0, sizeof(_s));
+        _s.magic = BATTERY_STATE_MAGIC;
+        _s.frameIndex = frameIndex;
+        _s.frameDueMs = frameDueMs;
+        _s.heartbeatDueMs = heartbeatDueMs;
+        _s.radioMs = millis();  // WiFi was up all along
+    }
+
+    // Leave battery mode: the next boot is a normal one
+    void stop() { _s.magic = 0; }
+
+    uint64_t now() const { return _s.clockMs + millis(); }
+    BatteryState& state() { return _s; }
+    bool active() const { return _s.magic == BATTERY_STATE_MAGIC; }
+
+    void addRadio(uint32_t ms) { _s.radioMs += ms; }
+
+    // Deep sleep until the earlier of the two deadlines; never returns
+    void sleep(uint32_t refreshes) {
+        uint64_t wake = _s.frameDueMs < _s.heartbeatDueMs ? _s.frameDueMs : _s.heartbeatDueMs;
+        uint64_t t = now();
+        uint64_t ms = wake > t ? wake - t : 0;
+        _s.awakeMs += millis();
+        _s.sleptMs += ms;
+        _s.refreshes += refreshes;
+        _s.wakes++;
+        _s.clockMs = t + ms;
+        LOG_I(MAIN, "Battery: sleeping %llu s (frame in %lld s, heartbeat in %lld s)", ms / 1000,
+              _s.frameDueMs == BATTERY_NEVER ? -1LL : (long long)(_s.frameDueMs - t) / 1000,
+              (long long)(_s.heartbeatDueMs - t) / 1000);
+        logFlush();
+        esp_sleep_enable_timer_wakeup(ms * 1000);
+        esp_deep_sleep_start();
+    }
+
+    // {wakes, awakeMs, sleptMs, radioMs, refreshes}
+    void toJson(JsonObject out) const {
+        out["wakes"] = _s.wakes;
+        out["awakeMs"] = _s.awakeMs + millis();
+        out["sleptMs"] = _s.sleptMs;
+        out["radioMs"] = _s.radioMs;
+        out["refreshes"] = _s.refreshes;
+    }
+
+private:
+    BatteryState& _s;
+};
+
+#endif // BATTERY_MODE_H
@@ -0,0 +1,71 @@
+#ifndef BIT_BLIT_H
+#define BIT_BLIT_H
+
+#include <stdint.h>
+
+// Blit of a 1-bit image (rows of w/8 bytes, MSB first, 1 = white) into a
+// 1-bit frame buffer that is stored a quarter turn from how it is drawn,
+// as GxEPD2 keeps the portrait panel under setRotation(1): logical pixel
+// (x, y) lives in native row x, native column nativeW - 1 - y. Eight
+// logical rows of one source byte become one byte in each of eight native
+// rows, so the image goes over in 8x8 blocks turned by a bit-matrix
+// transpose instead of pixel by pixel.
+
+inline uint8_t reverseBits8(uint8_t b) {
+    b = (b & 0xF0) >> 4 | (b & 0x0F) << 4;
+    b = (b & 0xCC) >> 2 | (b & 0x33) << 2;
+    return (b & 0xAA) >> 1 | (b & 0x55) << 1;
+}
+
+// Transpose an 8x8 bit matrix held as two 32-bit words (hi: rows 0-3,
+// lo: rows 4-7, row 0 in the top byte, column 0 in the top bit of each row)
+inline void transpose8x8(uint32_t& hi, uint32_t& lo) {
+    uint32_t t;
+    t = (hi ^ (hi >> 7)) & 0x00AA00AA; hi ^= t ^ (t << 7);
+    t = (lo ^ (lo >> 7)) & 0x00AA00AA; lo ^= t ^ (t << 7);
+    t = (hi ^ (hi >> 14)) & 0x0000CCCC; hi ^= t ^ (t << 14);
+    t = (lo ^ (lo >> 14)) & 0x0000CCCC; lo ^= t ^ (t << 14);
+    t = (hi & 0xF0F0F0F0) | ((lo >> 4) & 0x0F0F0F0F);
+    lo = ((hi << 4) & 0xF0F0F0F0) | (lo & 0x0F0F0F0F);
+    hi = t;
+}
+
+// Draw `image` (w x h) at logical (x, y) into `native` (nativeW x nativeH,
+// rows of nativeW/8 bytes). Black source pixels are drawn black (white
+// with `invert`); white ones leave the buffer alone. rotate180 turns the
+// image half a turn first. Returns false, drawing nothing, unless y, w and
+// h are multiples of 8 and the image lies wholly on the buffer.
+inline bool blitRotated(uint8_t* native, int16_t nativeW, int16_t nativeH,
+                        int16_t x, int16_t y, const uint8_t* image, int16_t w, int16_t h,
+                        bool rotate180, bool invert) {
+    if ((y | w | h | nativeW) & 7) return false;
+    if (x < 0 || y < 0 || w <= 0 || h <= 0 || x + w > nativeH || y + h > nativeW) return false;
+    const int16_t srcStride = w / 8;
+    const int16_t dstStride = nativeW / 8;
+    for (int16_t by = 0; by < h; by += 8) {
+        // Native byte column holding logical rows y+by .. y+by+7 (reversed)
+        uint8_t* column = native + (nativeW - 8 - y - by) / 8;
+        for (int16_t bx = 0; bx < srcStride; bx++) {
+            // Source rows by+7 .. by as the matrix rows 0 .. 7: a transposed
+            // row is then one native byte, lowest logical row in its low bit
+            uint8_t s[8];
+            for (int r = 0; r < 8; r++) {
+                if (rotate180) s[7 - r] = reverseBits8(image[(h - 1 - by - r) * srcStride + (srcStride - 1 - bx)]);
+                else s[7 - r] = image[(by + r) * srcStride + bx];
+            }
+            uint32_t hi = (uint32_t)s[0] << 24 | (uint32_t)s[1] << 16 | (uint32_t)s[2] << 8 | s[3];
+            uint32_t lo = (uint32_t)s[4] << 24 | (uint32_t)s[5] << 16 | (uint32_t)s[6] << 8 | s[7];
+            if ((hi & lo) == 0xFFFFFFFF) continue;     // all white: nothing to draw
+            transpose8x8(hi, lo);
+            uint8_t* out = column + (int32_t)(x + bx * 8) * dstStride;
+            for (int c = 0; c < 8; c++) {
+                uint8_t b = c < 4 ? hi >> (24 - 8 * c) : lo >> (56 - 8 * c);
+                if (invert) out[c * dstStride] |= (uint8_t)~b;
+                else out[c * dstStride] &= b;
+            }
+        }
+    }
+    return true;
+}
+
+#endif // BIT_BLIT_H
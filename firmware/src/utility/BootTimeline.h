@@ -0,0 +1,60 @@
+#ifndef BOOT_TIMELINE_H
+#define BOOT_TIMELINE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// When each boot phase started and how long it took, in ms since reset.
+// Phases may overlap (WiFi associates in the background while the screen
+// refreshes) and end in another task (WiFi, NTP, first heartbeat), so each
+// is just a start and an end stamp; begin()/end() only count the first time.
+
+enum BootPhase : uint8_t {
+    BOOT_LEDC,          // LED PWM channels
+    BOOT_DISPLAY,       // e-paper SPI + controller init
+    BOOT_PSRAM,         // ApiClient: NVS, frame store in PSRAM, stored playlist
+    BOOT_PORTAL,        // AP, HTTP/DNS servers, station connect started
+    BOOT_PAINT,         // the one boot refresh (stored frame or boot screen)
+    BOOT_WIFI,          // station connect started -> got IP
+    BOOT_NTP,           // SNTP started -> time synchronized
+    BOOT_HEARTBEAT,     // first heartbeat sent -> answered
+    BOOT_PHASE_COUNT
+};
+
+// Keys in the telemetry JSON, in order of BootPhase
+static const char* const BOOT_PHASE_NAMES[] = {"ledc", "display", "psram", "portal", "paint", "wifi", "ntp", "heartbeat"};
+
+class BootTimeline {
+public:
+    void begin(BootPhase p) {
+        if (!_start[p]) _start[p] = stamp();
+    }
+
+    void end(BootPhase p) {
+        if (_start[p] && !_end[p]) _end[p] = stamp();
+    }
+
+    bool ended(BootPhase p) const { return _end[p] != 0; }
+
+    // {ledc: {at, ms}, ...}: `at` = start; phases still running have no `ms`
+    void toJson(JsonObject out) const {
+        for (uint8_t p = 0; p < BOOT_PHASE_COUNT; p++) {
+            if (!_start[p]) continue;
+            JsonObject phase = out[BOOT_PHASE_NAMES[p]].to<JsonObject>();
+            phase["at"] = _start[p];
+            if (_end[p]) phase["ms"] = _end[p] - _start[p];
+        }
+    }
+
+private:
+    volatile uint32_t _start[BOOT_PHASE_COUNT] = {0};
+    volatile uint32_t _end[BOOT_PHASE_COUNT] = {0};
+
+    // 0 means "not yet", so a stamp is never 0
+    static uint32_t stamp() {
+        uint32_t ms = millis();
+        return ms ? ms : 1;
+    }
+};
+
+#endif // BOOT_TIMELINE_H
@@ -0,0 +1,145 @@
+#ifndef BUZZER_SERVICE_H
+#define BUZZER_SERVICE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <driver/ledc.h>
+#include "Melody.h"
+
+// The one task that drives the buzzer. Callers post a sound (a named
+// melody or a frame's tone pattern) and return right away; the task sets
+// the LEDC frequency and duty per step and sleeps on its queue for the
+// step's length, so a beep no longer holds up the caller.
+//
+// Priorities (BuzzerPriority): a higher one cuts the sound in progress
+// off, an equal one plays after it (only the latest waits), a lower one is
+// dropped.
+
+#define BUZZER_QUEUE_LEN 4
+#define BUZZER_TASK_STACK 2048
+
+class BuzzerService {
+public:
+    // Timer and channel are already configured (initializePins())
+    void begin(ledc_mode_t mode, ledc_timer_t timer, ledc_channel_t channel, uint8_t dutyBits) {
+        if (_queue) return;
+        _mode = mode;
+        _timer = timer;
+        _channel = channel;
+        _halfDuty = 1u << (dutyBits - 1);
+        _queue = xQueueCreate(BUZZER_QUEUE_LEN, sizeof(Item));
+        xTaskCreatePinnedToCore(taskEntry, "buzzer", BUZZER_TASK_STACK, this, 3, &_task, 1);
+    }
+
+    void play(const BuzzerCommand& cmd) {
+        if (!_queue || cmd.count == 0) return;
+        Item item = {cmd, millis()};
+        if (xQueueSend(_queue, &item, pdMS_TO_TICKS(20)) == pdTRUE) _commands++;
+        else _dropped++;
+    }
+
+    void play(MelodyId id, uint8_t priority) { play(buzzerMelody(id, priority)); }
+
+    // {commands, preempted, dropped, lagMs: worst command -> first tone,
+    //  overrunMs: worst step that ran longer than asked}
+    void toJson(JsonObject out) const {
+        out["commands"] = _commands;
+        out["preempted"] = _preempted;
+        out["dropped"] = _dropped;
+        out["lagMs"] = _maxLagMs;
+        out["overrunMs"] = _maxOverrunMs;
+    }
+
+private:
+    struct Item {
+        BuzzerCommand cmd;
+        uint32_t sentMs;
+    };
+
+    QueueHandle_t _queue = nullptr;
+    TaskHandle_t _task = nullptr;
+    ledc_mode_t _mode = LEDC_LOW_SPEED_MODE;
+    ledc_timer_t _timer = LEDC_TIMER_0;
+    ledc_channel_t _channel = LEDC_CHANNEL_0;
+    uint32_t _halfDuty = 2048;
+    uint16_t _hz = 0;           // frequency the timer is set to
+
+    volatile uint32_t _commands = 0;
+    volatile uint32_t _preempted = 0;
+    volatile uint32_t _dropped = 0;
+    volatile uint32_t _maxLagMs = 0;
+    volatile uint32_t _maxOverrunMs = 0;
+
+    static void taskEntry(void* arg) { static_cast<BuzzerService*>(arg)->run(); }
+
+    void run() {
+        Item current, pending;
+        bool hasPending = false;
+        for (;;) {
+            if (hasPending) {
+                current = pending;
+                hasPending = false;
+            } else {
+                xQueueReceive(_queue, &current, portMAX_DELAY);
+            }
+            uint32_t lag = millis() - current.sentMs;
+            if (lag > _maxLagMs) _maxLagMs = lag;
+
+            bool cut = false;
+            for (uint8_t i = 0; i < current.cmd.count && !cut; i++) {
+                const ToneStep& step = current.cmd.steps[i];
+                tone(step);
+                uint32_t start = millis();
+                cut = waitStep(start, step.ms, current.cmd.priority, pending, hasPending);
+                uint32_t took = millis() - start;
+                if (!cut && took > step.ms + 1u && took - step.ms > _maxOverrunMs) _maxOverrunMs = took - step.ms;
+            }
+            if (cut) _preempted++;
+            silence();
+        }
+    }
+
+    // Sleep until the step is over, taking commands meanwhile. true: a higher
+    // priority one came in (now in `pending`) and the current sound stops.
+    bool waitStep(uint32_t start, uint32_t ms, uint8_t priority, Item& pending, bool& hasPending) {
+        Item item;
+        for (;;) {
+            uint32_t elapsed = millis() - start;
+            if (elapsed >= ms) return false;
+            if (xQueueReceive(_queue, &item, pdMS_TO_TICKS(ms - elapsed)) != pdTRUE) return false;
+            if (item.cmd.priority < priority) {
+                _dropped++;
+                continue;
+            }
+            if (hasPending) _dropped++;
+            pending = item;
+            hasPending = true;
+            if (item.cmd.priority > priority) return true;
+        }
+    }
+
+    void tone(const ToneStep& step) {
+        if (step.hz == 0 || step.duty == 0) {
+            silence();
+            return;
+        }
+        if (step.hz != _hz) {
+            ledc_set_freq(_mode, _timer, step.hz);
+            _hz = step.hz;
+        }
+        ledc_set_duty(_mode, _channel, (_halfDuty * step.duty + 127) / 255);
+        ledc_update_duty(_mode, _channel);
+    }
+
+    void silence() {
+        ledc_set_duty(_mode, _channel, 0);
+        ledc_update_duty(_mode, _channel);
+    }
+};
+
+inline BuzzerService& buzzerService() {
+    static BuzzerService instance;
+    return instance;
+}
+
+#endif // BUZZER_SERVICE_H
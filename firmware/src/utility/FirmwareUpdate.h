@@ -5,6 +5,9 @@
 #include <HTTPClient.h>
 #include <Update.h>
 #include <WiFiClientSecure.h>
+#include <ArduinoJson.h>
+#include "Log.h"
+#include "Sha256.h"
 
 // Exposed from main.ino
 extern const int CURRENT_FIRMWARE_VERSION;
@@ -82,7 +85,7 @@ namespace OtaUpdate {
                 http.end();
                 
                 if (newUrl.length() > 0) {
-                    Serial.printf("[OTA] Redirect %d -> %s\n", httpCode, newUrl.c_str());
+                    LOG_D(OTA, "Redirect %d -> %s", httpCode, newUrl.c_str());
                     currentUrl = newUrl;
                     continue;
                 }
@@ -95,6 +98,25 @@ namespace OtaUpdate {
         return currentUrl;
     }
     
+    // sha256 of firmware-ota.bin, published next to it in version.json
+    // ("" if the file or the field is missing)
+    inline String fetchFirmwareSha256() {
+        WiFiClientSecure client;
+        client.setInsecure();
+        HTTPClient http;
+        http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
+        http.begin(client, firmwareBaseUrl + "/version.json");
+        String sha;
+        if (http.GET() == HTTP_CODE_OK) {
+            JsonDocument doc;
+            if (deserializeJson(doc, http.getString()) == DeserializationError::Ok) {
+                sha = doc["sha256"] | "";
+            }
+        }
+        http.end();
+        return sha;
+    }
+
     // Perform OTA update from GitHub releases
     inline OtaResult performUpdate(int targetVersion) {
         OtaResult result = {false, false, targetVersion, ""};
@@ -113,11 +135,14 @@ namespace OtaUpdate {
         
         // Build firmware URL: {baseUrl}/firmware-ota.bin (single file, always latest)
         String firmwareUrl = firmwareBaseUrl + "/firmware-ota.bin";
-        Serial.printf("[OTA] Downloading firmware from: %s\n", firmwareUrl.c_str());
+        LOG_I(OTA, "Downloading firmware from: %s", firmwareUrl.c_str());
         
+        String expectedSha = fetchFirmwareSha256();
+        if (expectedSha.length() == 0) LOG_W(OTA, "No sha256 published, image will not be verified");
+
         // Follow redirects to get final download URL (GitHub uses redirects)
         String finalUrl = followRedirects(firmwareUrl);
-        Serial.printf("[OTA] Final URL: %s\n", finalUrl.c_str());
+        LOG_D(OTA, "Final URL: %s", finalUrl.c_str());
         
         // Download and apply firmware
         WiFiClientSecure client;
@@ -131,13 +156,13 @@ namespace OtaUpdate {
         
         if (httpCode != HTTP_CODE_OK) {
             result.errorMessage = "HTTP error: " + String(httpCode);
-            Serial.printf("[OTA] Download failed: %d\n", httpCode);
+            LOG_E(OTA, "Download failed: %d", httpCode);
             http.end();
             return result;
         }
         
         int contentLength = http.getSize();
-        Serial.printf("[OTA] Firmware size: %d bytes\n", contentLength);
+        LOG_D(OTA, "Firmware size: %d bytes", contentLength);
         
         if (contentLength <= 0) {
             result.errorMessage = "Invalid content length";
@@ -148,36 +173,60 @@ namespace OtaUpdate {
         // Start OTA update
         if (!Update.begin(contentLength)) {
             result.errorMessage = "Not enough space";
-            Serial.printf("[OTA] Update.begin failed: %s\n", Update.errorString());
+            LOG_E(OTA, "Update.begin failed: %s", Update.errorString());
             http.end();
             return result;
         }
         
-        Serial.println("[OTA] Starting firmware update...");
+        LOG_I(OTA, "Starting firmware update...");
         
-        // Write firmware in chunks
+        // Write firmware in chunks, hashing each one on the way
         WiFiClient* stream = http.getStreamPtr();
-        size_t written = Update.writeStream(*stream);
+        Sha256 sha;
+        sha.begin();
+        uint8_t buf[1024];
+        size_t written = 0;
+        while (written < (size_t)contentLength) {
+            size_t want = contentLength - written;
+            size_t n = stream->readBytes(buf, want < sizeof(buf) ? want : sizeof(buf));
+            if (n == 0) break;  // stream timed out
+            sha.update(buf, n);
+            if (Update.write(buf, n) != n) break;
+            written += n;
+        }
         
-        if (written != contentLength) {
+        if (written != (size_t)contentLength) {
             result.errorMessage = "Write incomplete";
-            Serial.printf("[OTA] Write failed: %d/%d bytes\n", written, contentLength);
+            LOG_E(OTA, "Write failed: %u/%d bytes", (unsigned)written, contentLength);
             Update.abort();
             http.end();
             return result;
         }
         
+        // Reject a corrupted image before it becomes the boot partition
+        if (expectedSha.length() > 0) {
+            if (!sha.finishMatches(expectedSha.c_str())) {
+                result.errorMessage = "Checksum mismatch";
+                LOG_E(OTA, "Image sha256 mismatch (expected %.12s)", expectedSha.c_str());
+                Update.abort();
+                http.end();
+                return result;
+            }
+            LOG_I(OTA, "Image sha256 verified (%u bytes hashed in %u ms)",
+                  (unsigned)sha.bytes(), (unsigned)(sha.us() / 1000));
+        }
+        
         // Finalize update
         if (!Update.end()) {
             result.errorMessage = String(Update.errorString());
-            Serial.printf("[OTA] Update.end failed: %s\n", Update.errorString());
+            LOG_E(OTA, "Update.end failed: %s", Update.errorString());
             http.end();
             return result;
         }
         
         http.end();
         
-        Serial.println("[OTA] Update successful! Rebooting...");
+        LOG_I(OTA, "Update successful! Rebooting...");
         result.success = true;
         
         return result;
@@ -197,8 +246,8 @@ namespace OtaUpdate {
             return result;
         }
         
-        Serial.printf("[OTA] Update available: v%d -> v%d\n", 
-                      CURRENT_FIRMWARE_VERSION, latestVersion);
+        LOG_I(OTA, "Update available: v%d -> v%d",
+              CURRENT_FIRMWARE_VERSION, latestVersion);
         
         return performUpdate(latestVersion);
     }
@@ -0,0 +1,248 @@
+#ifndef FRAME_CODEC_H
+#define FRAME_CODEC_H
+
+#include <Arduino.h>
+
+// Streaming frame decoders for the binary transport. The server picks one
+// codec per frame from the list the device advertises ("codecs" in the
+// heartbeat) and names it in the frame metadata ("enc", absent = raw).
+// Every decoder writes straight into the caller's frame buffer; the only
+// scratch state is a few bytes, LZSS back-references read from the output.
+// "xor" is a patch against a base frame the device already holds; the caller
+// copies the base into the output buffer before feeding the patch.
+
+enum FrameCodecId : uint8_t {
+    CODEC_RAW,
+    CODEC_RLE,      // PackBits
+    CODEC_LZSS,     // flag byte per 8 items, 12-bit offset / 4-bit length refs
+    CODEC_XOR,      // sparse XOR patch against a base frame
+    CODEC_UNKNOWN
+};
+
+// Names advertised to the server, in order of FrameCodecId
+static const char* const FRAME_CODEC_NAMES[] = {"raw", "rle", "lzss", "xor"};
+
+inline FrameCodecId frameCodecFromName(const char* name) {
+    for (uint8_t i = 0; i < CODEC_UNKNOWN; i++) {
+        if (!strcmp(name, FRAME_CODEC_NAMES[i])) return (FrameCodecId)i;
+    }
+    return CODEC_UNKNOWN;
+}
+
+class FrameDecoder : public Print {
+public:
+    virtual ~FrameDecoder() {}
+
+    void begin(uint8_t* out, size_t capacity) {
+        _out = out;
+        _capacity = capacity;
+        _len = 0;
+        _overflow = false;
+        _invalid = false;
+        reset();
+    }
+
+    // True if the input ended cleanly (not in the middle of a token)
+    virtual bool finish() { return true; }
+
+    size_t length() const { return _len; }
+    bool overflow() const { return _overflow; }
+    bool invalid() const { return _invalid; }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    using Print::write;
+
+protected:
+    uint8_t* _out = nullptr;
+    size_t _capacity = 0;
+    size_t _len = 0;
+    bool _overflow = false;
+    bool _invalid = false;
+
+    virtual void reset() {}
+
+    // Excess output is dropped and flagged rather than failing the stream
+    void put(uint8_t b) {
+        if (_len >= _capacity) { _overflow = true; return; }
+        _out[_len++] = b;
+    }
+};
+
+class RawDecoder : public FrameDecoder {
+public:
+    size_t write(const uint8_t* buf, size_t size) override {
+        size_t n = size;
+        if (_len + n > _capacity) {
+            n = _capacity - _len;
+            _overflow = true;
+        }
+        memcpy(_out + _len, buf, n);
+        _len += n;
+        return size;
+    }
+};
+
+// PackBits: n = 0..127 -> n+1 literal bytes follow; n = -127..-1 -> next
+// byte repeated 1-n times; -128 is a no-op
+class RleDecoder : public FrameDecoder {
+public:
+    bool finish() override { return _literal == 0 && _repeat == 0; }
+
+    size_t write(const uint8_t* buf, size_t size) override {
+        for (size_t i = 0; i < size; i++) {
+            uint8_t b = buf[i];
+            if (_literal) {
+                put(b);
+                _literal--;
+            } else if (_repeat) {
+                while (_repeat) { put(b); _repeat--; }
+            } else {
+                int8_t n = (int8_t)b;
+                if (n >= 0) _literal = n + 1;
+                else if (n != -128) _repeat = 1 - n;
+            }
+        }
+        return size;
+    }
+
+protected:
+    void reset() override {
+        _literal = 0;
+        _repeat = 0;
+    }
+
+private:
+    uint8_t _literal = 0;
+    uint8_t _repeat = 0;
+};
+
+// LZSS: each flag byte covers the next 8 items, LSB first. Bit 1 = literal
+// byte; bit 0 = 2-byte reference {lo, hi}: offset = (lo | (hi >> 4) << 8) + 1
+// (1..4096 bytes back), length = (hi & 0x0F) + 3 (3..18)
+class LzssDecoder : public FrameDecoder {
+public:
+    bool finish() override { return !_haveLow; }
+
+    size_t write(const uint8_t* buf, size_t size) override {
+        for (size_t i = 0; i < size && !_invalid; i++) {
+            uint8_t b = buf[i];
+            if (_items == 0) {
+                _flags = b;
+                _items = 8;
+                continue;
+            }
+            if (_flags & 1) {
+                put(b);
+            } else if (!_haveLow) {
+                _low = b;
+                _haveLow = true;
+                continue;
+            } else {
+                size_t offset = (_low | ((size_t)(b >> 4) << 8)) + 1;
+                uint8_t count = (b & 0x0F) + 3;
+                _haveLow = false;
+                if (offset > _len) { _invalid = true; break; }
+                // Byte by byte: source may overlap the bytes being produced
+                for (uint8_t k = 0; k < count; k++) put(_out[_len - offset]);
+            }
+            _flags >>= 1;
+            _items--;
+        }
+        return _invalid ? 0 : size;
+    }
+
+protected:
+    void reset() override {
+        _flags = 0;
+        _items = 0;
+        _low = 0;
+        _haveLow = false;
+    }
+
+private:
+    uint8_t _flags = 0;
+    uint8_t _items = 0;
+    uint8_t _low = 0;
+    bool _haveLow = false;
+};
+
+// XOR patch: repeated {varint skip, varint len, len bytes XORed into the
+// output}; bytes past the last run keep the base contents
+class XorPatchDecoder : public FrameDecoder {
+public:
+    bool finish() override { return _state == X_SKIP && _shift == 0; }
+
+    size_t write(const uint8_t* buf, size_t size) override {
+        for (size_t i = 0; i < size && !_invalid; i++) {
+            uint8_t b = buf[i];
+            if (_state == X_DATA) {
+                if (_pos < _capacity) _out[_pos] ^= b;
+                else _overflow = true;
+                _pos++;
+                if (--_run == 0) _state = X_SKIP;
+                continue;
+            }
+            _varint |= (uint32_t)(b & 0x7F) << _shift;
+            if (b & 0x80) {
+                _shift += 7;
+                if (_shift > 28) _invalid = true;
+                continue;
+            }
+            if (_state == X_SKIP) {
+                _pos += _varint;
+                if (_pos > _capacity) _overflow = true;
+                _state = X_LEN;
+            } else {
+                _run = _varint;
+                _state = _run ? X_DATA : X_SKIP;
+            }
+            _varint = 0;
+            _shift = 0;
+        }
+        return _invalid ? 0 : size;
+    }
+
+protected:
+    void reset() override {
+        _len = _capacity;  // the whole base is already in place
+        _pos = 0;
+        _run = 0;
+        _varint = 0;
+        _shift = 0;
+        _state = X_SKIP;
+    }
+
+private:
+    enum State : uint8_t { X_SKIP, X_LEN, X_DATA };
+    size_t _pos = 0;
+    uint32_t _run = 0;
+    uint32_t _varint = 0;
+    uint8_t _shift = 0;
+    State _state = X_SKIP;
+};
+
+// One decoder of each kind; hands out the one a blob needs
+class FrameDecoderSet {
+public:
+    // Started decoder for `codec` writing into `out`, or nullptr if unsupported
+    FrameDecoder* select(FrameCodecId codec, uint8_t* out, size_t capacity) {
+        FrameDecoder* d = nullptr;
+        switch (codec) {
+            case CODEC_RAW:  d = &_raw; break;
+            case CODEC_RLE:  d = &_rle; break;
+            case CODEC_LZSS: d = &_lzss; break;
+            case CODEC_XOR:  d = &_xor; break;
+            default: return nullptr;
+        }
+        d->begin(out, capacity);
+        return d;
+    }
+
+private:
+    RawDecoder _raw;
+    RleDecoder _rle;
+    LzssDecoder _lzss;
+    XorPatchDecoder _xor;
+};
+
+#endif // FRAME_CODEC_H
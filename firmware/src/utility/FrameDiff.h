@@ -0,0 +1,47 @@
+#ifndef FRAME_DIFF_H
+#define FRAME_DIFF_H
+
+#include <stdint.h>
+#include <string.h>
+
+// What changed between two 1-bit images of the same size (rows of w/8
+// bytes, MSB first): how many pixels, and the smallest box holding all of
+// them. Compared 32 bits at a time; the box is widened to whole bytes.
+
+struct FrameRect {
+    int16_t x, y, w, h;
+};
+
+// Changed pixels between a and b (0: identical, `box` untouched). w must be
+// a multiple of 32.
+inline uint32_t frameDiff(const uint8_t* a, const uint8_t* b, int16_t w, int16_t h, FrameRect& box) {
+    const int words = w / 32;
+    uint32_t changed = 0;
+    int top = -1, bottom = -1;
+    int left = w / 8, right = -1;       // in bytes
+    for (int y = 0; y < h; y++) {
+        const uint8_t* ra = a + y * (w / 8);
+        const uint8_t* rb = b + y * (w / 8);
+        for (int i = 0; i < words; i++) {
+            uint32_t wa, wb;
+            memcpy(&wa, ra + i * 4, 4);
+            memcpy(&wb, rb + i * 4, 4);
+            uint32_t x = wa ^ wb;
+            if (!x) continue;
+            changed += __builtin_popcount(x);
+            if (top < 0) top = y;
+            bottom = y;
+            // Which bytes of the word differ (memory order, whatever the endianness)
+            for (int k = 0; k < 4; k++) {
+                if (ra[i * 4 + k] == rb[i * 4 + k]) continue;
+                int byte = i * 4 + k;
+                if (byte < left) left = byte;
+                if (byte > right) right = byte;
+            }
+        }
+    }
+    if (changed) box = {(int16_t)(left * 8), (int16_t)top, (int16_t)((right - left + 1) * 8), (int16_t)(bottom - top + 1)};
+    return changed;
+}
+
+#endif // FRAME_DIFF_H
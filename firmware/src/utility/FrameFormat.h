@@ -0,0 +1,39 @@
+#ifndef FRAME_FORMAT_H
+#define FRAME_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Pixel formats of a display frame (384x168, rows top to bottom, MSB
+// first). Mono is the default; a frame opts into 4-level gray with
+// "format": "gray4" and then carries twice the bytes.
+//
+//   mono   1 bit per pixel:  1 = white, 0 = black             (8064 bytes)
+//   gray4  2 bits per pixel: 3 = white, 2 = light gray,
+//          1 = dark gray, 0 = black                          (16128 bytes)
+
+// Display frame buffer size (384x168 1-bit packed = 8064 bytes)
+#define DISPLAY_FRAME_SIZE 8064
+#define DISPLAY_FRAME_GRAY4_SIZE (DISPLAY_FRAME_SIZE * 2)
+#define DISPLAY_FRAME_MAX_SIZE DISPLAY_FRAME_GRAY4_SIZE
+
+enum FrameFormat : uint8_t {
+    FRAME_MONO,
+    FRAME_GRAY4
+};
+
+inline FrameFormat frameFormatFromName(const char* name) {
+    return strcmp(name, "gray4") == 0 ? FRAME_GRAY4 : FRAME_MONO;
+}
+
+inline size_t frameFormatSize(uint8_t format) {
+    return format == FRAME_GRAY4 ? DISPLAY_FRAME_GRAY4_SIZE : DISPLAY_FRAME_SIZE;
+}
+
+// A decoded bitmap of this many bytes is a whole frame of some format
+inline bool isFrameSize(size_t length) {
+    return length == DISPLAY_FRAME_SIZE || length == DISPLAY_FRAME_GRAY4_SIZE;
+}
+
+#endif // FRAME_FORMAT_H
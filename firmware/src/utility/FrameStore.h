@@ -0,0 +1,159 @@
+#ifndef FRAME_STORE_H
+#define FRAME_STORE_H
+
+#include <Arduino.h>
+#include "Sha256.h"
+#include "Log.h"
+
+// Content-addressed frame cache in PSRAM. Each slot holds one bitmap keyed
+// by its hash (sha256 hex of the raw bitmap, as sent by the server), with a
+// reference count so slots of the current and incoming playlists are never
+// evicted; unreferenced slots are reused least-recently-used first.
+// Sized to hold two full playlists, so an update never has to evict a frame
+// that is still on screen. Slots are as large as the largest frame format;
+// each remembers how many bytes its bitmap actually has.
+
+#ifndef FRAME_STORE_SLOTS
+#define FRAME_STORE_SLOTS 16
+#endif
+
+#define FRAME_HASH_LEN 64
+
+class FrameStore {
+public:
+    // Allocate all slots (frameSize bytes each) in one PSRAM block
+    bool begin(size_t frameSize) {
+        _frameSize = frameSize;
+        _pool = (uint8_t*)ps_malloc(frameSize * FRAME_STORE_SLOTS);
+        if (!_pool) {
+            LOG_E(FRAMES, "PSRAM alloc failed");
+            return false;
+        }
+        for (int i = 0; i < FRAME_STORE_SLOTS; i++) clearSlot(_slots[i]);
+        return true;
+    }
+
+    // Slot holding (or pending download of) `hash`, or -1
+    int find(const char* hash) const {
+        if (!hash || !hash[0]) return -1;
+        for (int i = 0; i < FRAME_STORE_SLOTS; i++) {
+            if (!strcmp(_slots[i].hash, hash)) return i;
+        }
+        return -1;
+    }
+
+    // Reference the slot for `hash`, allocating one (evicting the least
+    // recently used unreferenced slot) if it isn't cached. An empty hash
+    // always gets a fresh anonymous slot. *needsFill is set when the slot's
+    // bitmap still has to be written and commit()ed. Returns -1 if every
+    // slot is referenced.
+    int acquire(const char* hash, bool* needsFill = nullptr) {
+        int slot = find(hash);
+        if (slot < 0) {
+            slot = victim();
+            if (slot < 0) {
+                LOG_W(FRAMES, "No free slot");
+                return -1;
+            }
+            if (_slots[slot].valid) _evictions++;
+            clearSlot(_slots[slot]);
+            if (hash) {
+                strncpy(_slots[slot].hash, hash, FRAME_HASH_LEN);
+                _slots[slot].hash[FRAME_HASH_LEN] = '\0';
+            }
+        } else if (_slots[slot].valid) {
+            _hits++;
+        }
+        _slots[slot].refs++;
+        _slots[slot].lastUse = ++_clock;
+        if (needsFill) *needsFill = !_slots[slot].valid;
+        return slot;
+    }
+
+    void release(int slot) {
+        if (slot < 0 || slot >= FRAME_STORE_SLOTS || _slots[slot].refs == 0) return;
+        _slots[slot].refs--;
+    }
+
+    // Bitmap for the slot was written completely (`length` bytes)
+    void commit(int slot, size_t length) {
+        if (slot < 0 || slot >= FRAME_STORE_SLOTS || length > _frameSize) return;
+        _slots[slot].length = (uint16_t)length;
+        _slots[slot].valid = true;
+    }
+
+    // Download failed: forget the contents (keeps the reference)
+    void invalidate(int slot) {
+        if (slot >= 0 && slot < FRAME_STORE_SLOTS) _slots[slot].valid = false;
+    }
+
+    bool valid(int slot) const {
+        return slot >= 0 && slot < FRAME_STORE_SLOTS && _slots[slot].valid;
+    }
+
+    // Bytes in the slot's bitmap (0 unless valid)
+    size_t length(int slot) const {
+        return valid(slot) ? _slots[slot].length : 0;
+    }
+
+    uint8_t* bitmap(int slot) const {
+        if (!_pool || slot < 0 || slot >= FRAME_STORE_SLOTS) return nullptr;
+        return _pool + (size_t)slot * _frameSize;
+    }
+
+    // Recompute the sha256 of the slot's first `length` bytes and compare it
+    // with the slot's hash
+    bool verify(int slot, Sha256& sha, size_t length) const {
+        const uint8_t* data = bitmap(slot);
+        if (!data || !_slots[slot].hash[0] || length > _frameSize) return false;
+        sha.begin();
+        sha.update(data, length);
+        return sha.finishMatches(_slots[slot].hash);
+    }
+
+    const char* hash(int slot) const {
+        return (slot >= 0 && slot < FRAME_STORE_SLOTS) ? _slots[slot].hash : "";
+    }
+
+    size_t poolBytes() const { return _pool ? _frameSize * FRAME_STORE_SLOTS : 0; }
+    uint32_t hits() const { return _hits; }
+    uint32_t evictions() const { return _evictions; }
+
+private:
+    struct Slot {
+        char hash[FRAME_HASH_LEN + 1];
+        uint8_t refs;
+        bool valid;
+        uint16_t length;
+        uint32_t lastUse;
+    };
+
+    Slot _slots[FRAME_STORE_SLOTS];
+    uint8_t* _pool = nullptr;
+    size_t _frameSize = 0;
+    uint32_t _clock = 0;
+    uint32_t _hits = 0;
+    uint32_t _evictions = 0;
+
+    static void clearSlot(Slot& s) {
+        s.hash[0] = '\0';
+        s.refs = 0;
+        s.valid = false;
+        s.length = 0;
+        s.lastUse = 0;
+    }
+
+    // Unreferenced slot to reuse: empty/invalid first, then least recently used
+    int victim() const {
+        int best = -1;
+        for (int i = 0; i < FRAME_STORE_SLOTS; i++) {
+            const Slot& s = _slots[i];
+            if (s.refs > 0) continue;
+            if (!s.valid) return i;
+            if (best < 0 || s.lastUse < _slots[best].lastUse) best = i;
+        }
+        return best;
+    }
+};
+
+#endif // FRAME_STORE_H
@@ -0,0 +1,153 @@
+#ifndef FRAME_TRANSPORT_H
+#define FRAME_TRANSPORT_H
+
+#include <Arduino.h>
+#include "Log.h"
+
+// Binary heartbeat response ("application/vnd.tigermeter.frames+bin"),
+// served instead of JSON when the device advertises the "bin" feature:
+//
+//   "TMB1"              4-byte magic
+//   u16 LE headerLen    length of the JSON header that follows
+//   u8  blobCount       number of blobs after the header
+//   u8  reserved        0
+//   JSON header         same fields as the JSON response, frames without bitmap
+//   blobCount x { u32 LE length, length bytes }   blob i = bitmap of frames[i],
+//                                                  encoded per frames[i].enc (FrameCodec.h)
+//
+// All integers little-endian. Like JsonStreamParser this is a Print sink
+// fed straight from HTTPClient::writeToStream().
+
+#define FRAME_TRANSPORT_CONTENT_TYPE "application/vnd.tigermeter.frames+bin"
+
+// Receives blob payloads; return a sink for blob `index` or nullptr to skip it
+class FrameBlobHandler {
+public:
+    virtual ~FrameBlobHandler() {}
+    virtual Print* onBlobBegin(uint8_t index, uint32_t length) = 0;
+    virtual void onBlobEnd(uint8_t index) {}
+};
+
+class BinaryFrameReader : public Print {
+public:
+    static const uint8_t PREAMBLE_SIZE = 8;
+
+    // header: receives the JSON header bytes (normally a JsonStreamParser)
+    BinaryFrameReader(Print& header, FrameBlobHandler& blobs)
+        : _header(header), _blobs(blobs) { reset(); }
+
+    void reset() {
+        _state = R_PREAMBLE;
+        _fill = 0;
+        _remaining = 0;
+        _blobCount = 0;
+        _blobIndex = 0;
+        _sink = nullptr;
+        _bytes = 0;
+    }
+
+    bool done() const { return _state == R_DONE; }
+    bool failed() const { return _state == R_ERROR; }
+    size_t bytesRead() const { return _bytes; }
+    uint8_t blobCount() const { return _blobCount; }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+
+    size_t write(const uint8_t* buf, size_t size) override {
+        size_t pos = 0;
+        while (pos < size) {
+            switch (_state) {
+                case R_PREAMBLE:
+                    _scratch[_fill++] = buf[pos++];
+                    if (_fill == PREAMBLE_SIZE) parsePreamble();
+                    break;
+
+                case R_HEADER: {
+                    size_t n = chunk(size - pos);
+                    if (_header.write(buf + pos, n) != n) { _state = R_ERROR; break; }
+                    pos += n;
+                    _remaining -= n;
+                    if (_remaining == 0) nextBlob();
+                    break;
+                }
+
+                case R_BLOB_LEN:
+                    _scratch[_fill++] = buf[pos++];
+                    if (_fill == 4) {
+                        _remaining = readU32(_scratch);
+                        _sink = _blobs.onBlobBegin(_blobIndex, _remaining);
+                        if (_remaining == 0) endBlob();
+                        else _state = R_BLOB;
+                    }
+                    break;
+
+                case R_BLOB: {
+                    size_t n = chunk(size - pos);
+                    if (_sink) _sink->write(buf + pos, n);
+                    pos += n;
+                    _remaining -= n;
+                    if (_remaining == 0) endBlob();
+                    break;
+                }
+
+                case R_DONE:     // trailing garbage
+                    _state = R_ERROR;
+                    break;
+
+                case R_ERROR:
+                    _bytes += pos;
+                    return pos;
+            }
+        }
+        _bytes += size;
+        return _state == R_ERROR ? 0 : size;
+    }
+
+private:
+    enum State : uint8_t { R_PREAMBLE, R_HEADER, R_BLOB_LEN, R_BLOB, R_DONE, R_ERROR };
+
+    Print& _header;
+    FrameBlobHandler& _blobs;
+    State _state;
+    uint8_t _scratch[PREAMBLE_SIZE];
+    uint8_t _fill;
+    uint32_t _remaining;
+    uint8_t _blobCount;
+    uint8_t _blobIndex;
+    Print* _sink;
+    size_t _bytes;
+
+    static uint32_t readU32(const uint8_t* p) {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    size_t chunk(size_t available) const {
+        return available < _remaining ? available : _remaining;
+    }
+
+    void parsePreamble() {
+        if (memcmp(_scratch, "TMB1", 4) != 0) {
+            LOG_W(FRAMES, "Bad magic");
+            _state = R_ERROR;
+            return;
+        }
+        _remaining = _scratch[4] | (_scratch[5] << 8);
+        _blobCount = _scratch[6];
+        if (_remaining == 0) { _state = R_ERROR; return; }
+        _state = R_HEADER;
+    }
+
+    void nextBlob() {
+        _fill = 0;
+        _state = _blobIndex < _blobCount ? R_BLOB_LEN : R_DONE;
+    }
+
+    void endBlob() {
+        _blobs.onBlobEnd(_blobIndex);
+        _sink = nullptr;
+        _blobIndex++;
+        nextBlob();
+    }
+};
+
+#endif // FRAME_TRANSPORT_H
@@ -0,0 +1,153 @@
+#ifndef HEARTBEAT_SCHEDULER_H
+#define HEARTBEAT_SCHEDULER_H
+
+#include <stdint.h>
+
+// When to send the next heartbeat. Every delay is jittered so a fleet that
+// failed together doesn't come back in lockstep; failures back off
+// exponentially up to a cap, and after breakerThreshold failures in a row
+// the circuit breaker opens: no heartbeats (or push wakeups) until
+// breakerOpenMs passes, then a single probe decides whether it closes again.
+// Server hints (nextPollSec on success, retryAfter / Retry-After on failure)
+// override the computed delay.
+//
+// No Arduino dependencies: time and randomness are injected, so the whole
+// state machine runs on the host with a fake clock.
+
+struct HeartbeatSchedulerConfig {
+    uint32_t intervalMs = 60000;       // default, replaced by the server's refreshInterval
+    uint32_t minIntervalMs = 5000;     // floor for intervals and hints
+    uint8_t jitterPct = 10;            // +/- on regular intervals
+    uint32_t backoffBaseMs = 5000;     // first retry delay
+    uint32_t backoffMaxMs = 300000;    // retry delay cap
+    uint8_t breakerThreshold = 6;      // consecutive failures that open the breaker
+    uint32_t breakerOpenMs = 900000;   // how long the breaker stays open
+};
+
+class HeartbeatScheduler {
+public:
+    typedef uint32_t (*Clock)();                 // milliseconds, may wrap
+    typedef uint32_t (*Random)(uint32_t bound);  // uniform in [0, bound)
+
+    enum State : uint8_t {
+        SCHED_NORMAL,     // regular interval
+        SCHED_BACKOFF,    // retrying after failures
+        SCHED_OPEN,       // breaker open, waiting out breakerOpenMs
+        SCHED_HALF_OPEN   // breaker probe in flight
+    };
+
+    typedef HeartbeatSchedulerConfig Config;
+
+    HeartbeatScheduler(Clock clock, Random random, const Config& config = Config())
+        : _clock(clock), _random(random), _config(config) {
+        _intervalMs = config.intervalMs;
+        _nextMs = clock();  // first heartbeat right away
+    }
+
+    // Regular interval (server refreshInterval); applies from the next success
+    void setInterval(uint32_t ms) {
+        _intervalMs = ms < _config.minIntervalMs ? _config.minIntervalMs : ms;
+    }
+
+    // True when a heartbeat should be sent now. An open breaker whose time is
+    // up turns half-open: this heartbeat is the probe.
+    bool due() {
+        if (!reached(_nextMs)) return false;
+        if (_state == SCHED_OPEN) _state = SCHED_HALF_OPEN;
+        return true;
+    }
+
+    uint32_t msUntilDue() const {
+        uint32_t now = _clock();
+        return reached(_nextMs) ? 0 : _nextMs - now;
+    }
+
+    // Heartbeat as soon as possible (push wakeup, new claim). Ignored while
+    // the breaker is open: that's what it is for.
+    void triggerNow() {
+        if (_state == SCHED_OPEN) return;
+        _nextMs = _clock();
+    }
+
+    // Content is expected to change in `ms`: move the next heartbeat earlier
+    // if it would otherwise come later. Only in normal operation.
+    void expectChangeIn(uint32_t ms) {
+        if (_state != SCHED_NORMAL) return;
+        if (ms < _config.minIntervalMs) ms = _config.minIntervalMs;
+        uint32_t at = _clock() + ms;
+        if ((int32_t)(at - _nextMs) < 0) _nextMs = at;
+    }
+
+    // hintMs: server's nextPollSec (0 = none)
+    void onSuccess(uint32_t hintMs = 0) {
+        _failures = 0;
+        _state = SCHED_NORMAL;
+        uint32_t delay = hintMs ? hintMs : _intervalMs;
+        if (delay < _config.minIntervalMs) delay = _config.minIntervalMs;
+        scheduleIn(jitter(delay));
+    }
+
+    // retryAfterMs: server's retryAfter / Retry-After (0 = none)
+    void onFailure(uint32_t retryAfterMs = 0) {
+        if (_failures < 255) _failures++;
+        uint32_t delay;
+        if (_state == SCHED_HALF_OPEN || _failures >= _config.breakerThreshold) {
+            // Probe failed or too many failures: (re)open for the full period
+            _state = SCHED_OPEN;
+            _opens++;
+            delay = jitter(_config.breakerOpenMs);
+        } else {
+            // Exponential backoff with "equal jitter": half fixed, half random
+            _state = SCHED_BACKOFF;
+            uint32_t backoff = _config.backoffBaseMs;
+            for (uint8_t i = 1; i < _failures && backoff < _config.backoffMaxMs; i++) backoff *= 2;
+            if (backoff > _config.backoffMaxMs) backoff = _config.backoffMaxMs;
+            delay = backoff / 2 + _random(backoff / 2 + 1);
+        }
+        // Never earlier than the server asked; spread out past that point
+        if (retryAfterMs > delay) {
+            delay = retryAfterMs + _random((uint32_t)((uint64_t)retryAfterMs * _config.jitterPct / 100) + 1);
+        }
+        scheduleIn(delay);
+    }
+
+    // Back to a fresh start (credentials lost, re-claim)
+    void reset() {
+        _failures = 0;
+        _state = SCHED_NORMAL;
+        _nextMs = _clock();
+    }
+
+    State state() const { return _state; }
+    uint8_t failures() const { return _failures; }
+    uint32_t breakerOpens() const { return _opens; }
+    uint32_t intervalMs() const { return _intervalMs; }
+
+    const char* stateName() const {
+        static const char* const names[] = {"normal", "backoff", "open", "halfOpen"};
+        return names[_state];
+    }
+
+private:
+    Clock _clock;
+    Random _random;
+    Config _config;
+    State _state = SCHED_NORMAL;
+    uint32_t _intervalMs;
+    uint32_t _nextMs;
+    uint8_t _failures = 0;
+    uint32_t _opens = 0;
+
+    bool reached(uint32_t at) const { return (int32_t)(_clock() - at) >= 0; }
+
+    void scheduleIn(uint32_t ms) { _nextMs = _clock() + ms; }
+
+    // ms +/- jitterPct percent, uniformly
+    uint32_t jitter(uint32_t ms) const {
+        uint32_t spread = (uint32_t)((uint64_t)ms * _config.jitterPct / 100);
+        if (spread == 0) return ms;
+        return ms - spread + _random(2 * spread + 1);
+    }
+};
+
+#endif // HEARTBEAT_SCHEDULER_H
@@ -0,0 +1,408 @@
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <Arduino.h>
+
+// Incremental (push) JSON walker + streaming base64 decoder.
+// Both are Print sinks, so an HTTP body can be fed straight in via
+// HTTPClient::writeToStream() without ever holding the whole response.
+
+// Path to the value currently being parsed, e.g. frames[2].bitmap =
+// {keys: "frames", "", "bitmap"; index: -1, 2, -1; depth: 3}
+struct JsonStreamPath {
+    static const uint8_t MAX_DEPTH = 5;    // frames[i].ledKeyframes[k].color
+    static const uint8_t MAX_KEY = 24;
+
+    uint8_t depth;
+    char keys[MAX_DEPTH][MAX_KEY];
+    int16_t index[MAX_DEPTH];   // array element index, -1 for object members
+
+    // Object member `key` at level `level` (0-based)
+    bool isKey(uint8_t level, const char* key) const {
+        return level < depth && index[level] < 0 && strcmp(keys[level], key) == 0;
+    }
+
+    // Array element at level `level`, returns index or -1
+    int16_t indexAt(uint8_t level) const {
+        return level < depth ? index[level] : -1;
+    }
+};
+
+// Receives the values the parser walks over. Acts as the filter: anything
+// the handler doesn't recognise is simply dropped.
+class JsonStreamHandler {
+public:
+    virtual ~JsonStreamHandler() {}
+
+    // Scalar value (string, number, true/false/null), as text
+    virtual void onScalar(const JsonStreamPath& path, const char* value, bool isString) = 0;
+
+    // Object/array start and end
+    virtual void onContainerBegin(const JsonStreamPath& path, bool isArray) {}
+    virtual void onContainerEnd(const JsonStreamPath& path, bool isArray) {}
+
+    // String value start: return a sink to receive the (unescaped) string bytes
+    // directly, or nullptr to get it buffered through onScalar()
+    virtual Print* onStringBegin(const JsonStreamPath& path) { return nullptr; }
+    virtual void onStringEnd(const JsonStreamPath& path) {}
+};
+
+class JsonStreamParser : public Print {
+public:
+    static const uint8_t MAX_NESTING = 8;
+    static const uint16_t MAX_SCALAR = 256;  // longer buffered strings are truncated
+
+    JsonStreamParser(JsonStreamHandler& handler) : _handler(handler) { reset(); }
+
+    void reset() {
+        _state = S_VALUE;
+        _nesting = 0;
+        _path.depth = 0;
+        _len = 0;
+        _sink = nullptr;
+        _isKey = false;
+        _bytes = 0;
+    }
+
+    bool done() const { return _state == S_DONE; }
+    bool failed() const { return _state == S_ERROR; }
+    size_t bytesParsed() const { return _bytes; }
+
+    size_t write(uint8_t c) override {
+        if (_state == S_ERROR) return 0;
+        _bytes++;
+        feed((char)c);
+        return 1;
+    }
+
+    size_t write(const uint8_t* buf, size_t size) override {
+        for (size_t i = 0; i < size; i++) {
+            if (_state == S_ERROR) return i;
+            _bytes++;
+            feed((char)buf[i]);
+        }
+        return size;
+    }
+
+private:
+    enum State : uint8_t {
+        S_VALUE,        // expecting a value
+        S_KEY,          // expecting a key or '}'
+        S_COLON,        // expecting ':'
+        S_AFTER,        // expecting ',' or a closing bracket
+        S_STRING,
+        S_ESCAPE,
+        S_UNICODE,
+        S_LITERAL,
+        S_DONE,
+        S_ERROR
+    };
+
+    JsonStreamHandler& _handler;
+    JsonStreamPath _path;
+    State _state;
+    char _stack[MAX_NESTING];   // '{' or '['
+    uint8_t _nesting;
+    char _buf[MAX_SCALAR];
+    uint16_t _len;
+    Print* _sink;               // non-null while streaming a string value
+    bool _isKey;
+    uint16_t _unicode;
+    uint8_t _unicodeDigits;
+    size_t _bytes;
+
+    static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+    bool inArray() const { return _nesting > 0 && _stack[_nesting - 1] == '['; }
+
+    // Path level of the element currently being parsed in the innermost container
+    bool tracked() const { return _nesting > 0 && _nesting <= JsonStreamPath::MAX_DEPTH; }
+
+    void beginValue() {
+        // Array elements get their index bumped as each value starts
+        if (inArray() && tracked()) _path.index[_nesting - 1]++;
+        _path.depth = _nesting <= JsonStreamPath::MAX_DEPTH ? _nesting : JsonStreamPath::MAX_DEPTH;
+    }
+
+    void endValue() {
+        _state = _nesting == 0 ? S_DONE : S_AFTER;
+    }
+
+    void openContainer(char type) {
+        if (_nesting >= MAX_NESTING) { _state = S_ERROR; return; }
+        if (_nesting <= JsonStreamPath::MAX_DEPTH) _handler.onContainerBegin(_path, type == '[');
+        _stack[_nesting++] = type;
+        if (tracked()) {
+            _path.keys[_nesting - 1][0] = '\0';
+            _path.index[_nesting - 1] = -1;
+        }
+        _state = type == '[' ? S_VALUE : S_KEY;
+    }
+
+    void closeContainer(char type) {
+        if (_nesting == 0 || _stack[_nesting - 1] != (type == ']' ? '[' : '{')) { _state = S_ERROR; return; }
+        _nesting--;
+        _path.depth = _nesting;
+        if (_nesting <= JsonStreamPath::MAX_DEPTH) _handler.onContainerEnd(_path, type == ']');
+        endValue();
+    }
+
+    void appendChar(char c) {
+        if (_sink) {
+            _sink->write((uint8_t)c);
+        } else if (_len < MAX_SCALAR - 1) {
+            _buf[_len++] = c;
+        }
+    }
+
+    void appendCodepoint(uint16_t cp) {
+        if (cp < 0x80) {
+            appendChar((char)cp);
+        } else if (cp < 0x800) {
+            appendChar((char)(0xC0 | (cp >> 6)));
+            appendChar((char)(0x80 | (cp & 0x3F)));
+        } else {
+            appendChar((char)(0xE0 | (cp >> 12)));
+            appendChar((char)(0x80 | ((cp >> 6) & 0x3F)));
+            appendChar((char)(0x80 | (cp & 0x3F)));
+        }
+    }
+
+    void startString(bool isKey) {
+        _isKey = isKey;
+        _len = 0;
+        _sink = nullptr;
+        if (!isKey) {
+            beginValue();
+            if (_nesting <= JsonStreamPath::MAX_DEPTH) _sink = _handler.onStringBegin(_path);
+        }
+        _state = S_STRING;
+    }
+
+    void finishString() {
+        if (_isKey) {
+            if (tracked()) {
+                uint16_t n = _len < JsonStreamPath::MAX_KEY - 1 ? _len : JsonStreamPath::MAX_KEY - 1;
+                memcpy(_path.keys[_nesting - 1], _buf, n);
+                _path.keys[_nesting - 1][n] = '\0';
+            }
+            _state = S_COLON;
+            return;
+        }
+        if (_sink) {
+            _sink = nullptr;
+            _handler.onStringEnd(_path);
+        } else if (_nesting <= JsonStreamPath::MAX_DEPTH) {
+            _buf[_len] = '\0';
+            _handler.onScalar(_path, _buf, true);
+        }
+        endValue();
+    }
+
+    void finishLiteral() {
+        _buf[_len] = '\0';
+        if (_nesting <= JsonStreamPath::MAX_DEPTH) _handler.onScalar(_path, _buf, false);
+        endValue();
+    }
+
+    void feed(char c) {
+        switch (_state) {
+        case S_STRING:
+            if (c == '"') finishString();
+            else if (c == '\\') _state = S_ESCAPE;
+            else appendChar(c);
+            return;
+
+        case S_ESCAPE:
+            _state = S_STRING;
+            switch (c) {
+            case 'n': appendChar('\n'); break;
+            case 't': appendChar('\t'); break;
+            case 'r': appendChar('\r'); break;
+            case 'b': appendChar('\b'); break;
+            case 'f': appendChar('\f'); break;
+            case 'u': _state = S_UNICODE; _unicode = 0; _unicodeDigits = 0; break;
+            default: appendChar(c); break;  // \" \\ \/
+            }
+            return;
+
+        case S_UNICODE: {
+            uint8_t v;
+            if (c >= '0' && c <= '9') v = c - '0';
+            else if (c >= 'a' && c <= 'f') v = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') v = c - 'A' + 10;
+            else { _state = S_ERROR; return; }
+            _unicode = (_unicode << 4) | v;
+            if (++_unicodeDigits == 4) {
+                appendCodepoint(_unicode);
+                _state = S_STRING;
+            }
+            return;
+        }
+
+        case S_LITERAL:
+            if (isSpace(c) || c == ',' || c == '}' || c == ']') {
+                finishLiteral();
+                feed(c);  // delimiter still needs handling
+            } else if (_len < MAX_SCALAR - 1) {
+                _buf[_len++] = c;
+            }
+            return;
+
+        case S_DONE:
+            if (!isSpace(c)) _state = S_ERROR;
+            return;
+
+        case S_ERROR:
+            return;
+
+        default:
+            break;
+        }
+
+        if (isSpace(c)) return;
+
+        switch (_state) {
+        case S_VALUE:
+            if (c == '"') {
+                startString(false);
+            } else if (c == '{' || c == '[') {
+                beginValue();
+                openContainer(c);
+            } else if (c == ']' && inArray()) {
+                closeContainer(c);   // empty array
+            } else {
+                beginValue();
+                _len = 0;
+                _buf[_len++] = c;
+                _state = S_LITERAL;
+            }
+            break;
+
+        case S_KEY:
+            if (c == '"') startString(true);
+            else if (c == '}') closeContainer(c);
+            else _state = S_ERROR;
+            break;
+
+        case S_COLON:
+            _state = c == ':' ? S_VALUE : S_ERROR;
+            break;
+
+        case S_AFTER:
+            if (c == ',') _state = inArray() ? S_VALUE : S_KEY;
+            else if (c == '}' || c == ']') closeContainer(c);
+            else _state = S_ERROR;
+            break;
+
+        default:
+            _state = S_ERROR;
+            break;
+        }
+    }
+};
+
+// HTTPClient::writeToStream() wants a Stream; adapts a write-only Print sink
+class PrintStream : public Stream {
+public:
+    PrintStream(Print& out) : _out(out) {}
+
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+
+    size_t write(uint8_t c) override { return _out.write(c); }
+    size_t write(const uint8_t* buf, size_t size) override { return _out.write(buf, size); }
+
+private:
+    Print& _out;
+};
+
+// Streaming base64 decoder: decodes 4-char quanta as they arrive straight
+// into a caller-owned buffer (typically a PSRAM frame bitmap)
+class Base64StreamDecoder : public Print {
+public:
+    Base64StreamDecoder() { begin(nullptr, 0); }
+
+    void begin(uint8_t* out, size_t capacity) {
+        _out = out;
+        _capacity = capacity;
+        _len = 0;
+        _quantum = 0;
+        _count = 0;
+        _pad = 0;
+        _invalid = false;
+        _overflow = false;
+    }
+
+    // Flush a trailing unpadded quantum; returns decoded length
+    size_t finish() {
+        if (_count > 0) {
+            uint8_t chars = _count;
+            while (_count < 4) { _quantum <<= 6; _count++; _pad++; }
+            if (chars >= 2) emit(chars);
+            _count = 0;
+        }
+        return _len;
+    }
+
+    size_t length() const { return _len; }
+    bool invalid() const { return _invalid; }
+    bool overflow() const { return _overflow; }
+
+    size_t write(uint8_t c) override {
+        if (_invalid) return 0;
+        if (c == '=') {
+            _quantum <<= 6;
+            _pad++;
+        } else {
+            uint8_t v = value(c);
+            if (v > 63 || _pad > 0) { _invalid = true; return 0; }
+            _quantum = (_quantum << 6) | v;
+        }
+        if (++_count == 4) {
+            emit(4 - _pad);
+            _quantum = 0;
+            _count = 0;
+            _pad = 0;
+        }
+        return 1;
+    }
+
+    size_t write(const uint8_t* buf, size_t size) override {
+        for (size_t i = 0; i < size; i++) {
+            if (!write(buf[i])) return i;
+        }
+        return size;
+    }
+
+private:
+    uint8_t* _out;
+    size_t _capacity;
+    size_t _len;
+    uint32_t _quantum;
+    uint8_t _count;
+    uint8_t _pad;
+    bool _invalid;
+    bool _overflow;
+
+    static uint8_t value(uint8_t c) {
+        if (c >= 'A' && c <= 'Z') return c - 'A';
+        if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+        if (c >= '0' && c <= '9') return c - '0' + 52;
+        if (c == '+') return 62;
+        if (c == '/') return 63;
+        return 64;
+    }
+
+    // chars: significant base64 chars in the quantum (2..4 -> 1..3 bytes)
+    void emit(uint8_t chars) {
+        uint8_t bytes = chars - 1;
+        for (uint8_t i = 0; i < bytes; i++) {
+            if (_len >= _capacity) { _overflow = true; return; }
+            _out[_len++] = (_quantum >> (16 - 8 * i)) & 0xFF;
+        }
+    }
+};
+
+#endif // JSON_STREAM_H
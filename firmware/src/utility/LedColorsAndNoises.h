@@ -2,6 +2,8 @@
 #include <Arduino.h>
 #include <driver/ledc.h>
 #include "../DEV_Config.h"
+#include "LedService.h"
+#include "BuzzerService.h"
 
 // LEDC configuration for buzzer (ESP-IDF level for compatibility)
 static const ledc_mode_t BUZZER_SPEED_MODE = LEDC_LOW_SPEED_MODE;
@@ -17,25 +19,7 @@ static const ledc_channel_t GREEN_CHANNEL = LEDC_CHANNEL_2;
 static const ledc_channel_t BLUE_CHANNEL = LEDC_CHANNEL_3;
 static const ledc_timer_bit_t LED_RES = LEDC_TIMER_8_BIT; // 8-bit resolution (0-255)
 static const int LED_FREQ = 5000; // 5kHz PWM frequency
-static const int LED_MAX_DUTY = 255; // Max duty for 8-bit resolution
-
-// Current RGB values (0 = full brightness, 255 = off for common anode LED)
-static uint8_t currentR = 255;
-static uint8_t currentG = 255;
-static uint8_t currentB = 255;
-
-// Rainbow colors for common anode LED (target values when fully ON)
-// Format: {R_on, G_on, B_on} where 0 = fully on, 255 = off
-static const uint8_t RAINBOW_COLORS[7][3] = {
-    {0, 255, 255},   // Red
-    {0, 180, 255},   // Orange (red + some green)
-    {0, 0, 255},     // Yellow (red + green)
-    {255, 0, 255},   // Green
-    {255, 0, 180},   // Cyan (green + some blue)
-    {255, 255, 0},   // Blue
-    {0, 255, 0}      // Violet (red + blue)
-};
-static const int RAINBOW_COLOR_COUNT = 7;
+static const int LED_OFF_DUTY = 1 << LED_RES; // Pin held high: off for common anode
 
 void initializePins()
 {
@@ -55,7 +39,7 @@ void initializePins()
     red_channel_config.channel = RED_CHANNEL;
     red_channel_config.intr_type = LEDC_INTR_DISABLE;
     red_channel_config.timer_sel = LED_TIMER;
-    red_channel_config.duty = LED_MAX_DUTY; // Start off (common anode)
+    red_channel_config.duty = LED_OFF_DUTY; // Start off (common anode)
     red_channel_config.hpoint = 0;
     ledc_channel_config(&red_channel_config);
 
@@ -66,7 +50,7 @@ void initializePins()
     green_channel_config.channel = GREEN_CHANNEL;
     green_channel_config.intr_type = LEDC_INTR_DISABLE;
     green_channel_config.timer_sel = LED_TIMER;
-    green_channel_config.duty = LED_MAX_DUTY; // Start off
+    green_channel_config.duty = LED_OFF_DUTY; // Start off
     green_channel_config.hpoint = 0;
     ledc_channel_config(&green_channel_config);
 
@@ -77,7 +61,7 @@ void initializePins()
     blue_channel_config.channel = BLUE_CHANNEL;
     blue_channel_config.intr_type = LEDC_INTR_DISABLE;
     blue_channel_config.timer_sel = LED_TIMER;
-    blue_channel_config.duty = LED_MAX_DUTY; // Start off
+    blue_channel_config.duty = LED_OFF_DUTY; // Start off
     blue_channel_config.hpoint = 0;
     ledc_channel_config(&blue_channel_config);
 
@@ -99,287 +83,122 @@ void initializePins()
     channel_config.duty = 0; // start silent
     channel_config.hpoint = 0;
     ledc_channel_config(&channel_config);
-}
-
-// Track if LED channels are stopped
-static bool ledChannelsStopped = false;
 
-// Set LED PWM values directly (0 = full brightness, 255 = off for common anode)
-void setLedPWM(uint8_t r, uint8_t g, uint8_t b)
-{
-    // Restart LEDC channels if they were stopped by led_Off()
-    if (ledChannelsStopped) {
-        ledc_set_duty(LED_SPEED_MODE, RED_CHANNEL, 255);
-        ledc_update_duty(LED_SPEED_MODE, RED_CHANNEL);
-        ledc_set_duty(LED_SPEED_MODE, GREEN_CHANNEL, 255);
-        ledc_update_duty(LED_SPEED_MODE, GREEN_CHANNEL);
-        ledc_set_duty(LED_SPEED_MODE, BLUE_CHANNEL, 255);
-        ledc_update_duty(LED_SPEED_MODE, BLUE_CHANNEL);
-        ledChannelsStopped = false;
-    }
-    
-    currentR = r;
-    currentG = g;
-    currentB = b;
-    ledc_set_duty(LED_SPEED_MODE, RED_CHANNEL, r);
-    ledc_update_duty(LED_SPEED_MODE, RED_CHANNEL);
-    ledc_set_duty(LED_SPEED_MODE, GREEN_CHANNEL, g);
-    ledc_update_duty(LED_SPEED_MODE, GREEN_CHANNEL);
-    ledc_set_duty(LED_SPEED_MODE, BLUE_CHANNEL, b);
-    ledc_update_duty(LED_SPEED_MODE, BLUE_CHANNEL);
+    ledService().begin(LED_SPEED_MODE, RED_CHANNEL, GREEN_CHANNEL, BLUE_CHANNEL, LED_RES);
+    buzzerService().begin(BUZZER_SPEED_MODE, BUZZER_TIMER, BUZZER_CHANNEL, BUZZER_RES);
 }
 
-// Pulse a single color: off -> on -> off over durationMs using smooth sine wave
-// targetR, targetG, targetB: target values when fully ON (0 = full brightness for common anode)
-// Uses sinusoidal interpolation for natural "breathing" effect
-void pulseColor(uint8_t targetR, uint8_t targetG, uint8_t targetB, uint16_t durationMs)
-{
-    const int totalSteps = 100; // Total steps for full cycle
-    const int stepDelay = durationMs / totalSteps;
-    
-    for (int i = 0; i <= totalSteps; i++)
-    {
-        float t = (float)i / totalSteps;
-        // Sine wave: 0 -> 1 -> 0 over one cycle (smooth breathing)
-        float brightness = sin(t * PI);
-        
-        // Interpolate from OFF (255) toward ON (target) based on brightness
-        uint8_t r = 255 - (uint8_t)((255 - targetR) * brightness);
-        uint8_t g = 255 - (uint8_t)((255 - targetG) * brightness);
-        uint8_t b = 255 - (uint8_t)((255 - targetB) * brightness);
-        
-        setLedPWM(r, g, b);
-        delay(stepDelay);
-    }
-    
-    // Ensure LED is fully off at the end
-    setLedPWM(255, 255, 255);
-}
-
-// Pulse a rainbow color by index (0-6)
-void pulseRainbowColor(int colorIndex, uint16_t durationMs)
-{
-    if (colorIndex < 0 || colorIndex >= RAINBOW_COLOR_COUNT) return;
-    pulseColor(
-        RAINBOW_COLORS[colorIndex][0],
-        RAINBOW_COLORS[colorIndex][1],
-        RAINBOW_COLORS[colorIndex][2],
-        durationMs
-    );
-}
+// Buzzer: sounds are posted to buzzerService() and played by its task;
+// none of these block.
 
 void playBuzzerPositive()
 {
-    // return;
-    ledc_set_freq(BUZZER_SPEED_MODE, BUZZER_TIMER, 600);
-    ledc_set_duty(BUZZER_SPEED_MODE, BUZZER_CHANNEL, 1 << (BUZZER_RES - 1));
-    ledc_update_duty(BUZZER_SPEED_MODE, BUZZER_CHANNEL);
-    delay(25);
-    ledc_set_duty(BUZZER_SPEED_MODE, BUZZER_CHANNEL, 0);
-    ledc_update_duty(BUZZER_SPEED_MODE, BUZZER_CHANNEL);
-
-    ledc_set_freq(BUZZER_SPEED_MODE, BUZZER_TIMER, 1400);
-    ledc_set_duty(BUZZER_SPEED_MODE, BUZZER_CHANNEL, 1 << (BUZZER_RES - 1));
-    ledc_update_duty(BUZZER_SPEED_MODE, BUZZER_CHANNEL);
-    delay(50);
-    ledc_set_duty(BUZZER_SPEED_MODE, BUZZER_CHANNEL, 0);
-    ledc_update_duty(BUZZER_SPEED_MODE, BUZZER_CHANNEL);
+    buzzerService().play(MELODY_POSITIVE, BUZZER_PRIO_FEEDBACK);
 }
 
+// Errors that end in a reboot: cuts off anything else playing
 void playBuzzerNegative()
 {
-    ledc_set_freq(BUZZER_SPEED_MODE, BUZZER_TIMER, 1400);
-    ledc_set_duty(BUZZER_SPEED_MODE, BUZZER_CHANNEL, 1 << (BUZZER_RES - 1));
-    ledc_update_duty(BUZZER_SPEED_MODE, BUZZER_CHANNEL);
-    delay(25);
-    ledc_set_duty(BUZZER_SPEED_MODE, BUZZER_CHANNEL, 0);
-    ledc_update_duty(BUZZER_SPEED_MODE, BUZZER_CHANNEL);
-
-    ledc_set_freq(BUZZER_SPEED_MODE, BUZZER_TIMER, 600);
-    ledc_set_duty(BUZZER_SPEED_MODE, BUZZER_CHANNEL, 1 << (BUZZER_RES - 1));
-    ledc_update_duty(BUZZER_SPEED_MODE, BUZZER_CHANNEL);
-    delay(50);
-    ledc_set_duty(BUZZER_SPEED_MODE, BUZZER_CHANNEL, 0);
-    ledc_update_duty(BUZZER_SPEED_MODE, BUZZER_CHANNEL);
-}
-
-// Current brightness level (0.0 = off, 1.0 = full)
-static float currentBrightness = 1.0f;
-
-// Brightness level constants
-static const float BRIGHTNESS_OFF = 0.0f;
-static const float BRIGHTNESS_LOW = 0.08f;  // Very dim
-static const float BRIGHTNESS_MID = 0.25f;  // Moderate
-static const float BRIGHTNESS_HIGH = 1.0f;
-
-// Set brightness level from string
-void setLedBrightness(const String& brightness) {
-    if (brightness == "off") currentBrightness = BRIGHTNESS_OFF;
-    else if (brightness == "low") currentBrightness = BRIGHTNESS_LOW;
-    else if (brightness == "mid") currentBrightness = BRIGHTNESS_MID;
-    else if (brightness == "high") currentBrightness = BRIGHTNESS_HIGH;
-    else currentBrightness = BRIGHTNESS_MID; // default
+    buzzerService().play(MELODY_NEGATIVE, BUZZER_PRIO_ALERT);
 }
 
-// Apply brightness to a single channel value
-// For common anode: 0 = full ON, 255 = OFF
-// brightness 0.0 = off (return 255), brightness 1.0 = full (return original)
-uint8_t applyBrightness(uint8_t channelValue) {
-    if (currentBrightness <= 0.0f) return 255; // Off
-    if (currentBrightness >= 1.0f) return channelValue; // Full brightness
-    
-    // For common anode, we need to interpolate between channelValue and 255
-    // Lower brightness = closer to 255 (more off)
-    int diff = 255 - channelValue; // How much "on" this channel is
-    int adjustedDiff = (int)(diff * currentBrightness);
-    return 255 - adjustedDiff;
-}
-
-// Set LED with current brightness applied
-void setLedPWMWithBrightness(uint8_t r, uint8_t g, uint8_t b)
+// A frame's beep: its own tone pattern if it has one, else its melody,
+// else the positive beep
+void playFrameBeep(const ToneStep* tones, uint8_t toneCount, MelodyId melody)
 {
-    setLedPWM(applyBrightness(r), applyBrightness(g), applyBrightness(b));
+    if (toneCount > 0) buzzerService().play(buzzerTones(tones, toneCount, BUZZER_PRIO_FRAME));
+    else buzzerService().play(melody != MELODY_NONE ? melody : MELODY_POSITIVE, BUZZER_PRIO_FRAME);
 }
 
-// Original LED functions using PWM for instant switching (backward compatible)
-void led_Purple()
-{
-    setLedPWMWithBrightness(0, 255, 0); // Red + Blue ON, Green OFF
-}
+// LED: effects are posted to ledService() and played by its task; none of
+// these block.
 
-void led_Red()
-{
-    setLedPWMWithBrightness(0, 255, 255); // Red ON, Green + Blue OFF
-}
+// Brightness of the steady colours, from the frame's ledBrightness
+static uint8_t ledBrightness = LED_BRIGHTNESS_HIGH;
 
-void led_Green()
+void setLedBrightness(const String& brightness)
 {
-    setLedPWMWithBrightness(255, 0, 255); // Green ON, Red + Blue OFF
+    ledBrightness = ledBrightnessFromName(brightness.c_str());
 }
 
-void led_Yellow()
+// Steady colour at `brightness` (0..255)
+void setLedColor(LedRgb color, uint8_t brightness)
 {
-    setLedPWMWithBrightness(0, 180, 255); // Amber: Red full ON, Green partial, Blue OFF
+    LedCommand cmd = {};
+    cmd.effect = LED_SOLID;
+    cmd.color = color;
+    cmd.brightness = brightness;
+    ledService().play(cmd);
 }
 
-void led_Blue()
-{
-    setLedPWMWithBrightness(255, 255, 0); // Blue ON, Red + Green OFF
-}
+void led_Purple() { setLedColor(LED_RGB_PURPLE, ledBrightness); }
+void led_Red() { setLedColor(LED_RGB_RED, ledBrightness); }
+void led_Green() { setLedColor(LED_RGB_GREEN, ledBrightness); }
+void led_Yellow() { setLedColor(LED_RGB_YELLOW, ledBrightness); }
+void led_Blue() { setLedColor(LED_RGB_BLUE, ledBrightness); }
 
 void led_Off()
 {
-    // Stop LEDC channels to fully turn off LED (PWM at 255 still leaks some light)
-    ledc_stop(LED_SPEED_MODE, RED_CHANNEL, 1);   // 1 = idle HIGH (off for common anode)
-    ledc_stop(LED_SPEED_MODE, GREEN_CHANNEL, 1);
-    ledc_stop(LED_SPEED_MODE, BLUE_CHANNEL, 1);
-    ledChannelsStopped = true;
-    currentR = 255;
-    currentG = 255;
-    currentB = 255;
+    LedCommand cmd = {};
+    cmd.effect = LED_OFF;
+    ledService().play(cmd);
 }
 
-// Pulse LED by color name with smooth breathing effect
-// color: "green", "red", "blue", "yellow", "purple"
-// durationMs: total duration for one pulse cycle (default 800ms)
-void pulseColorByName(const String& color, uint16_t durationMs = 800)
+// Pulse `count` times (full brightness, off -> on -> off over durationMs
+// each) over the steady colour, which comes back afterwards.
+// color: "green", "red", "blue", "yellow", "purple"; unknown = green
+void pulseColorByName(const String& color, uint8_t count, uint16_t durationMs = 800)
 {
-    if (color == "green") {
-        pulseColor(255, 0, 255, durationMs);      // Green ON
-    } else if (color == "red") {
-        pulseColor(0, 255, 255, durationMs);      // Red ON
-    } else if (color == "blue") {
-        pulseColor(255, 255, 0, durationMs);      // Blue ON
-    } else if (color == "yellow") {
-        pulseColor(0, 180, 255, durationMs);      // Amber (Red + partial Green)
-    } else if (color == "purple") {
-        pulseColor(0, 255, 0, durationMs);        // Purple (Red + Blue)
-    } else {
-        // Default to green for unknown colors
-        pulseColor(255, 0, 255, durationMs);
-    }
+    LedCommand cmd = {};
+    cmd.effect = LED_FLASH;
+    if (!ledColorFromName(color.c_str(), cmd.color)) cmd.color = LED_RGB_GREEN;
+    cmd.brightness = LED_BRIGHTNESS_HIGH;
+    cmd.periodMs = durationMs;
+    cmd.count = count;
+    ledService().play(cmd);
 }
 
-// Slow amber pulse: one cycle of fade in -> fade out over ~3 seconds
+// Slow amber breathing (3 s per cycle) until the next steady colour.
 // Used for reconnecting state indication
-// Amber color: R=0 (full on), G=180 (partial), B=255 (off)
 void pulseAmberSlow()
 {
-    pulseColor(0, 180, 255, 3000);  // 3 second cycle
+    LedCommand cmd = {};
+    cmd.effect = LED_BREATHE;
+    cmd.color = LED_RGB_YELLOW;
+    cmd.brightness = LED_BRIGHTNESS_HIGH;
+    cmd.periodMs = 3000;
+    ledService().play(cmd);
 }
 
 // Fade in yellow LED from 10% to full brightness over durationMs
 // Used during startup logo screen
 void fadeInYellow(uint16_t durationMs = 2000)
 {
-    const int steps = 80;
-    const int stepDelay = durationMs / steps;
-    
-    // Yellow target: R=0 (full on), G=180 (partial), B=255 (off)
-    const uint8_t targetR = 0;
-    const uint8_t targetG = 180;
-    const uint8_t targetB = 255;
-    
-    // Start at 10% brightness (90% of the way from target to OFF)
-    // For common anode: closer to 255 = dimmer
-    const uint8_t startR = targetR + (255 - targetR) * 90 / 100;  // 229
-    const uint8_t startG = targetG + (255 - targetG) * 90 / 100;  // 247
-    const uint8_t startB = targetB;  // Already 255 (off)
-    
-    // Set initial 10% brightness immediately
-    setLedPWM(startR, startG, startB);
-    
-    // Fade from 20% to 100%
-    for (int i = 1; i <= steps; i++)
-    {
-        uint8_t r = startR - ((startR - targetR) * i) / steps;
-        uint8_t g = startG - ((startG - targetG) * i) / steps;
-        uint8_t b = startB - ((startB - targetB) * i) / steps;
-        
-        setLedPWM(r, g, b);
-        delay(stepDelay);
-    }
-    
-    // Ensure full yellow at the end
-    setLedPWM(targetR, targetG, targetB);
+    LedCommand cmd = {};
+    cmd.effect = LED_FADE_IN;
+    cmd.color = LED_RGB_YELLOW;
+    cmd.brightness = LED_BRIGHTNESS_HIGH;
+    cmd.periodMs = durationMs;
+    ledService().play(cmd);
 }
 
-// HSV to common-anode RGB conversion
-// h: 0-360, s: 0-1, v: 0-1
-// Returns common anode values (0 = full ON, 255 = OFF)
-void hsvToCommonAnodeRGB(float h, float s, float v, uint8_t &r, uint8_t &g, uint8_t &b)
+// Around the hue wheel every durationMs (default 6 seconds), until the next colour
+void rainbowCycle(uint16_t durationMs = 6000)
 {
-    float c = v * s;
-    float x = c * (1.0f - fabs(fmod(h / 60.0f, 2.0f) - 1.0f));
-    float m = v - c;
-    float rf, gf, bf;
-    
-    if (h < 60)       { rf = c; gf = x; bf = 0; }
-    else if (h < 120) { rf = x; gf = c; bf = 0; }
-    else if (h < 180) { rf = 0; gf = c; bf = x; }
-    else if (h < 240) { rf = 0; gf = x; bf = c; }
-    else if (h < 300) { rf = x; gf = 0; bf = c; }
-    else               { rf = c; gf = 0; bf = x; }
-    
-    // Convert to common anode (invert: 0=ON, 255=OFF)
-    r = 255 - (uint8_t)((rf + m) * 255);
-    g = 255 - (uint8_t)((gf + m) * 255);
-    b = 255 - (uint8_t)((bf + m) * 255);
+    LedCommand cmd = {};
+    cmd.effect = LED_RAINBOW;
+    cmd.brightness = ledBrightness;
+    cmd.periodMs = durationMs;
+    ledService().play(cmd);
 }
 
-// One full rainbow cycle: smoothly transitions through all hues
-// durationMs: time for one full cycle (default 6 seconds)
-void rainbowCycle(uint16_t durationMs = 6000)
+// Per-frame keyframe sequence from the server, looping
+void playLedSequence(const LedKeyframe* keyframes, uint8_t count)
 {
-    const int steps = 120;
-    const int stepDelay = durationMs / steps;
-    
-    for (int i = 0; i < steps; i++)
-    {
-        float hue = (float)i / steps * 360.0f;
-        uint8_t r, g, b;
-        hsvToCommonAnodeRGB(hue, 1.0f, 1.0f, r, g, b);
-        setLedPWMWithBrightness(r, g, b);
-        delay(stepDelay);
-    }
+    LedCommand cmd = {};
+    cmd.effect = LED_SEQUENCE;
+    cmd.brightness = ledBrightness;
+    cmd.keyframeCount = count < LED_MAX_KEYFRAMES ? count : LED_MAX_KEYFRAMES;
+    memcpy(cmd.keyframes, keyframes, cmd.keyframeCount * sizeof(LedKeyframe));
+    ledService().play(cmd);
 }
@@ -0,0 +1,221 @@
+#ifndef LED_EFFECT_H
+#define LED_EFFECT_H
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+// LED effects as a list of linear fades. An effect (solid, fade-in, breathe,
+// rainbow, flash-N, a server keyframe sequence) is turned into segments
+// "fade to this colour in this many ms", which LedService hands to the LEDC
+// hardware fader; nothing here touches the hardware. Curves come from small
+// integer tables (a pulse is 8 straight pieces of a sine, the rainbow 6
+// pieces around the hue wheel), so there's no float math per step.
+
+#define LED_MAX_KEYFRAMES 8
+
+// Channel intensities, 0 = off .. 255 = full (LedService inverts them for
+// the common-anode LED)
+struct LedRgb {
+    uint8_t r, g, b;
+};
+
+// One step of a per-frame sequence: fade to `color` in fadeMs, hold holdMs.
+// The sequence loops.
+struct LedKeyframe {
+    LedRgb color;
+    uint16_t fadeMs;
+    uint16_t holdMs;
+};
+
+enum LedEffectType : uint8_t {
+    LED_OFF,
+    LED_SOLID,
+    LED_FADE_IN,        // from 10% to `color` in periodMs, then stays
+    LED_BREATHE,        // off -> color -> off every periodMs, forever
+    LED_RAINBOW,        // around the hue wheel every periodMs, forever
+    LED_FLASH,          // `count` pulses of periodMs, then back to the steady effect
+    LED_SEQUENCE        // keyframes, looping
+};
+
+struct LedCommand {
+    LedEffectType effect;
+    LedRgb color;
+    uint8_t brightness;         // 0..255, applied to every colour of the effect
+    uint16_t periodMs;
+    uint8_t count;
+    uint8_t keyframeCount;
+    LedKeyframe keyframes[LED_MAX_KEYFRAMES];
+};
+
+// Fade to `to` in `ms` (0: set at once). hold: stay there until the next
+// command (the effect is over, the colour stays).
+struct LedSegment {
+    LedRgb to;
+    uint32_t ms;
+    bool hold;
+};
+
+static const LedRgb LED_RGB_OFF = {0, 0, 0};
+static const LedRgb LED_RGB_RED = {255, 0, 0};
+static const LedRgb LED_RGB_GREEN = {0, 255, 0};
+static const LedRgb LED_RGB_BLUE = {0, 0, 255};
+static const LedRgb LED_RGB_YELLOW = {255, 75, 0};     // amber: red + a little green
+static const LedRgb LED_RGB_PURPLE = {255, 0, 255};
+
+// Brightness levels of the frame "ledBrightness" names
+static const uint8_t LED_BRIGHTNESS_LOW = 20;   // ~8%
+static const uint8_t LED_BRIGHTNESS_MID = 64;   // 25%
+static const uint8_t LED_BRIGHTNESS_HIGH = 255;
+
+// sin(k * pi / 8) * 255, k = 0..8: one pulse as 8 straight pieces
+static const uint8_t LED_PULSE_LUT[9] = {0, 98, 180, 236, 255, 236, 180, 98, 0};
+
+// Hue wheel corners at full saturation; straight lines between neighbours
+// are exactly the HSV hues in between
+static const LedRgb LED_HUE_WHEEL[6] = {
+    {255, 0, 0}, {255, 255, 0}, {0, 255, 0}, {0, 255, 255}, {0, 0, 255}, {255, 0, 255}
+};
+
+static const uint16_t LED_FLASH_GAP_MS = 100;   // dark gap between flash pulses
+static const uint16_t LED_MIN_STEP_MS = 50;
+
+inline uint8_t ledScale8(uint8_t v, uint8_t scale) {
+    return (uint8_t)(((uint16_t)v * scale + 127) / 255);
+}
+
+inline LedRgb ledScale(LedRgb c, uint8_t scale) {
+    return {ledScale8(c.r, scale), ledScale8(c.g, scale), ledScale8(c.b, scale)};
+}
+
+// Point `num/den` of the way from a to b
+inline LedRgb ledLerp(LedRgb a, LedRgb b, uint32_t num, uint32_t den) {
+    auto mix = [&](uint8_t x, uint8_t y) {
+        return (uint8_t)(x + ((int32_t)y - x) * (int32_t)num / (int32_t)den);
+    };
+    return {mix(a.r, b.r), mix(a.g, b.g), mix(a.b, b.b)};
+}
+
+// Frame/server colour: a name or "#rrggbb". Unknown names are false.
+inline bool ledColorFromName(const char* name, LedRgb& out) {
+    static const struct { const char* name; LedRgb rgb; } NAMED[] = {
+        {"green", LED_RGB_GREEN},
+        {"red", LED_RGB_RED},
+        {"blue", LED_RGB_BLUE},
+        {"yellow", LED_RGB_YELLOW},
+        {"purple", LED_RGB_PURPLE},
+        {"magenta", LED_RGB_PURPLE},
+        {"cyan", {0, 255, 255}},
+        {"white", {255, 255, 255}},
+        {"off", {0, 0, 0}},
+    };
+    if (name[0] == '#' && strlen(name) == 7) {
+        char* end;
+        uint32_t v = strtoul(name + 1, &end, 16);
+        if (*end) return false;
+        out = {(uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v};
+        return true;
+    }
+    for (const auto& c : NAMED) {
+        if (!strcmp(name, c.name)) {
+            out = c.rgb;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline uint8_t ledBrightnessFromName(const char* name) {
+    if (!strcmp(name, "off")) return 0;
+    if (!strcmp(name, "low")) return LED_BRIGHTNESS_LOW;
+    if (!strcmp(name, "high")) return LED_BRIGHTNESS_HIGH;
+    return LED_BRIGHTNESS_MID;
+}
+
+// Walks one command as segments
+class LedEffectPlayer {
+public:
+    void start(const LedCommand& cmd) {
+        _cmd = cmd;
+        _step = 0;
+    }
+
+    const LedCommand& command() const { return _cmd; }
+
+    // Next segment; false once a finite effect (flash) is over
+    bool next(LedSegment& seg) {
+        const LedCommand& c = _cmd;
+        seg.hold = false;
+        switch (c.effect) {
+        case LED_OFF:
+        case LED_SOLID:
+            seg = {c.effect == LED_OFF ? LED_RGB_OFF : bright(c.color), 0, true};
+            return true;
+
+        case LED_FADE_IN:
+            if (_step == 0) seg = {ledScale(bright(c.color), 26), 0, false};   // 10% at once
+            else if (_step == 1) seg = {bright(c.color), c.periodMs, false};
+            else seg = {bright(c.color), 0, true};
+            _step++;
+            return true;
+
+        case LED_BREATHE:
+            pulseSegment(seg, _step % 9);
+            _step++;
+            return true;
+
+        case LED_RAINBOW: {
+            // Straight to the first corner, then around the wheel
+            uint8_t k = _step == 0 ? 0 : (_step - 1) % 6 + 1;
+            seg = {bright(LED_HUE_WHEEL[k % 6]), _step == 0 ? 0 : stepMs(c.periodMs / 6u), false};
+            _step++;
+            return true;
+        }
+
+        case LED_FLASH: {
+            // 9 points per pulse, then a dark gap (none after the last)
+            uint32_t perPulse = 10;
+            if (c.count == 0 || _step >= c.count * perPulse - 1) return false;
+            uint32_t k = _step % perPulse;
+            if (k == 9) seg = {LED_RGB_OFF, LED_FLASH_GAP_MS, false};
+            else pulseSegment(seg, k);
+            _step++;
+            return true;
+        }
+
+        case LED_SEQUENCE: {
+            if (c.keyframeCount == 0) {
+                seg = {LED_RGB_OFF, 0, true};
+                return true;
+            }
+            // Even steps fade to a keyframe, odd steps hold it
+            const LedKeyframe& kf = c.keyframes[(_step / 2) % c.keyframeCount];
+            // (a keyframe with neither still takes LED_MIN_STEP_MS, so the loop can't spin)
+            uint32_t holdMs = kf.fadeMs || kf.holdMs ? kf.holdMs : LED_MIN_STEP_MS;
+            seg = {bright(kf.color), (_step & 1) ? holdMs : kf.fadeMs, false};
+            // A one-keyframe sequence is just a colour
+            if ((_step & 1) && c.keyframeCount == 1) seg.hold = true;
+            _step++;
+            return true;
+        }
+        }
+        return false;
+    }
+
+private:
+    LedCommand _cmd = {};
+    uint32_t _step = 0;
+
+    LedRgb bright(LedRgb c) const { return ledScale(c, _cmd.brightness); }
+
+    // A short period mustn't give 0 ms steps: the LED task would spin
+    // through them and starve the UI loop
+    static uint32_t stepMs(uint32_t ms) { return ms < LED_MIN_STEP_MS ? LED_MIN_STEP_MS : ms; }
+
+    // Point k (0..8) of a pulse: point 0 is set at once, the rest fade in
+    void pulseSegment(LedSegment& seg, uint32_t k) const {
+        seg = {ledScale(bright(_cmd.color), LED_PULSE_LUT[k]), k == 0 ? 0 : stepMs(_cmd.periodMs / 8u), false};
+    }
+};
+
+#endif // LED_EFFECT_H
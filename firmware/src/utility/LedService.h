@@ -0,0 +1,152 @@
+#ifndef LED_SERVICE_H
+#define LED_SERVICE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <driver/ledc.h>
+#include "LedEffect.h"
+#include "Log.h"
+
+// The one task that drives the RGB LED. Callers post an effect and return
+// right away; the task plays it as LEDC hardware fades and sleeps on its
+// queue in between, so nothing else ever waits on the LED.
+//
+// Two effects at a time: the steady one (frame colour, rainbow, breathing,
+// sequence) and a flash on top of it. A new steady effect replaces the old
+// one; a flash plays over it and the steady effect picks up again when the
+// flash is done.
+//
+// A hardware fade can't be cut short (IDF 4.4 has no ledc_fade_stop), so
+// long fades are split into LED_FADE_CHUNK_MS pieces: a new command takes
+// effect at the end of the piece in progress.
+
+#ifndef LED_FADE_CHUNK_MS
+#define LED_FADE_CHUNK_MS 250
+#endif
+
+#define LED_QUEUE_LEN 4
+#define LED_TASK_STACK 2560
+
+class LedService {
+public:
+    // Channels are already configured (initializePins()). Common-anode LED:
+    // duty 2^bits keeps a pin high, fully off.
+    void begin(ledc_mode_t mode, ledc_channel_t red, ledc_channel_t green, ledc_channel_t blue, uint8_t dutyBits) {
+        if (_queue) return;
+        _mode = mode;
+        _ch[0] = red;
+        _ch[1] = green;
+        _ch[2] = blue;
+        _offDuty = 1u << dutyBits;
+        ledc_fade_func_install(0);
+        _queue = xQueueCreate(LED_QUEUE_LEN, sizeof(Item));
+        xTaskCreatePinnedToCore(taskEntry, "led", LED_TASK_STACK, this, 2, &_task, 1);
+    }
+
+    // Post an effect (LED_FLASH plays over the steady one, anything else
+    // replaces it). Never blocks for long: if the task is that far behind,
+    // the command is dropped.
+    void play(const LedCommand& cmd) {
+        if (!_queue) return;
+        Item item = {cmd, millis()};
+        if (xQueueSend(_queue, &item, pdMS_TO_TICKS(20)) == pdTRUE) _commands++;
+        else _dropped++;
+    }
+
+    // {commands, dropped, fades, lagMs: worst command -> LED}
+    void toJson(JsonObject out) const {
+        out["commands"] = _commands;
+        out["dropped"] = _dropped;
+        out["fades"] = _fades;
+        out["lagMs"] = _maxLagMs;
+    }
+
+private:
+    struct Item {
+        LedCommand cmd;
+        uint32_t sentMs;
+    };
+
+    QueueHandle_t _queue = nullptr;
+    TaskHandle_t _task = nullptr;
+    ledc_mode_t _mode = LEDC_LOW_SPEED_MODE;
+    ledc_channel_t _ch[3] = {};
+    uint32_t _offDuty = 256;
+    LedRgb _current = LED_RGB_OFF;      // where the last fade ends
+    LedEffectPlayer _steady;
+    LedEffectPlayer _flash;
+
+    volatile uint32_t _commands = 0;
+    volatile uint32_t _dropped = 0;
+    volatile uint32_t _fades = 0;
+    volatile uint32_t _maxLagMs = 0;
+
+    static void taskEntry(void* arg) { static_cast<LedService*>(arg)->run(); }
+
+    void run() {
+        LedCommand off = {};
+        off.effect = LED_OFF;
+        _steady.start(off);
+        bool flashing = false;
+        Item item;
+        for (;;) {
+            LedSegment seg;
+            if (!(flashing ? _flash : _steady).next(seg)) {
+                // Flash over: back to the steady effect, from its start
+                flashing = false;
+                _steady.start(_steady.command());
+                continue;
+            }
+            if (!playSegment(seg, item)) continue;
+
+            uint32_t lag = millis() - item.sentMs;
+            if (lag > _maxLagMs) _maxLagMs = lag;
+            if (item.cmd.effect == LED_FLASH) {
+                _flash.start(item.cmd);
+                flashing = true;
+            } else {
+                _steady.start(item.cmd);
+            }
+        }
+    }
+
+    // Play one segment; true if a command came in meanwhile (in `item`)
+    bool playSegment(const LedSegment& seg, Item& item) {
+        if (seg.ms == 0) {
+            fadeTo(seg.to, 0);
+        } else {
+            LedRgb from = _current;
+            uint32_t chunks = (seg.ms + LED_FADE_CHUNK_MS - 1) / LED_FADE_CHUNK_MS;
+            for (uint32_t i = 1; i <= chunks; i++) {
+                uint32_t ms = seg.ms * i / chunks - seg.ms * (i - 1) / chunks;
+                fadeTo(ledLerp(from, seg.to, i, chunks), ms);
+                if (xQueueReceive(_queue, &item, pdMS_TO_TICKS(ms)) == pdTRUE) return true;
+            }
+        }
+        return xQueueReceive(_queue, &item, seg.hold ? portMAX_DELAY : 0) == pdTRUE;
+    }
+
+    // All three channels towards `to` in `ms` (0: at once). Waits for a fade
+    // still running on a channel to finish first.
+    void fadeTo(LedRgb to, uint32_t ms) {
+        const uint8_t level[3] = {to.r, to.g, to.b};
+        for (int i = 0; i < 3; i++) {
+            uint32_t duty = _offDuty - (level[i] * _offDuty + 127) / 255;
+            if (ms == 0) {
+                ledc_set_duty_and_update(_mode, _ch[i], duty, 0);
+            } else {
+                ledc_set_fade_with_time(_mode, _ch[i], duty, ms);
+                ledc_fade_start(_mode, _ch[i], LEDC_FADE_NO_WAIT);
+            }
+        }
+        _current = to;
+        _fades++;
+    }
+};
+
+inline LedService& ledService() {
+    static LedService instance;
+    return instance;
+}
+
+#endif // LED_SERVICE_H
@@ -0,0 +1,157 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <Arduino.h>
+#include <stdarg.h>
+
+// Leveled logging. LOG_E/W/I/D(MODULE, fmt, ...) check the module's level
+// at compile time: below it the call (format string and arguments included)
+// is dead code and gone from the binary. Enabled lines are formatted into a
+// fixed ring buffer, never straight to the UART; logDrain() moves as much as
+// the UART can take without blocking, and the captive portal's /logs page
+// shows the tail of the same buffer.
+//
+// Build flags: LOG_LEVEL (default LOG_LVL_INFO) for every module,
+// LOG_LEVEL_<MODULE> to override one, e.g. -D LOG_LEVEL_API=LOG_LVL_DEBUG.
+
+#define LOG_LVL_NONE  0
+#define LOG_LVL_ERROR 1
+#define LOG_LVL_WARN  2
+#define LOG_LVL_INFO  3
+#define LOG_LVL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LVL_INFO
+#endif
+
+// Modules (the tag printed is the module name)
+#ifndef LOG_LEVEL_MAIN
+#define LOG_LEVEL_MAIN LOG_LEVEL        // boot, UI loop
+#endif
+#ifndef LOG_LEVEL_NET
+#define LOG_LEVEL_NET LOG_LEVEL         // network task state machine
+#endif
+#ifndef LOG_LEVEL_API
+#define LOG_LEVEL_API LOG_LEVEL         // ApiClient requests
+#endif
+#ifndef LOG_LEVEL_FRAMES
+#define LOG_LEVEL_FRAMES LOG_LEVEL      // frame cache and transport
+#endif
+#ifndef LOG_LEVEL_DISPLAY
+#define LOG_LEVEL_DISPLAY LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_PORTAL
+#define LOG_LEVEL_PORTAL LOG_LEVEL      // captive portal, AP, mDNS
+#endif
+#ifndef LOG_LEVEL_OTA
+#define LOG_LEVEL_OTA LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_DEMO
+#define LOG_LEVEL_DEMO LOG_LEVEL
+#endif
+
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 4096
+#endif
+#define LOG_LINE_MAX 192    // longer lines are truncated
+
+#define LOG_AT(level, mod, fmt, ...) \
+    do { if ((level) <= LOG_LEVEL_##mod) logWrite(level, #mod, fmt, ##__VA_ARGS__); } while (0)
+#define LOG_E(mod, fmt, ...) LOG_AT(LOG_LVL_ERROR, mod, fmt, ##__VA_ARGS__)
+#define LOG_W(mod, fmt, ...) LOG_AT(LOG_LVL_WARN, mod, fmt, ##__VA_ARGS__)
+#define LOG_I(mod, fmt, ...) LOG_AT(LOG_LVL_INFO, mod, fmt, ##__VA_ARGS__)
+#define LOG_D(mod, fmt, ...) LOG_AT(LOG_LVL_DEBUG, mod, fmt, ##__VA_ARGS__)
+
+// Byte ring shared by all tasks. Writers never wait on the UART: when the
+// drain falls behind, the oldest undrained bytes are overwritten (and
+// counted in lost()), so the buffer always holds the newest output.
+class LogRing {
+public:
+    LogRing() { _lock = xSemaphoreCreateMutex(); }
+
+    void push(const char* s, size_t n) {
+        xSemaphoreTake(_lock, portMAX_DELAY);
+        for (size_t i = 0; i < n; i++) _buf[_head++ % LOG_RING_SIZE] = s[i];
+        if (_head - _tail > LOG_RING_SIZE) {
+            // Resume the drain at the next line start, not mid-line
+            uint32_t tail = _head - LOG_RING_SIZE;
+            while (tail < _head && _buf[tail++ % LOG_RING_SIZE] != '\n') {}
+            _lost += tail - _tail;
+            _tail = tail;
+        }
+        xSemaphoreGive(_lock);
+    }
+
+    // Write up to `budget` undrained bytes to `out`
+    void drain(Print& out, size_t budget) {
+        xSemaphoreTake(_lock, portMAX_DELAY);
+        size_t n = _head - _tail;
+        if (n > budget) n = budget;
+        while (n > 0) {
+            size_t at = _tail % LOG_RING_SIZE;
+            size_t chunk = LOG_RING_SIZE - at < n ? LOG_RING_SIZE - at : n;
+            out.write((const uint8_t*)_buf + at, chunk);
+            _tail += chunk;
+            n -= chunk;
+        }
+        xSemaphoreGive(_lock);
+    }
+
+    bool empty() const { return _head == _tail; }
+    uint32_t lost() const { return _lost; }
+
+    // Last `maxBytes` of output (drained or not), from a line start
+    void tail(String& out, size_t maxBytes) {
+        xSemaphoreTake(_lock, portMAX_DELAY);
+        uint32_t have = _head < LOG_RING_SIZE ? _head : LOG_RING_SIZE;
+        if (maxBytes > have) maxBytes = have;
+        uint32_t pos = _head - maxBytes;
+        if (pos > _head - have) {
+            while (pos < _head && _buf[(pos - 1) % LOG_RING_SIZE] != '\n') pos++;
+        }
+        out.reserve(out.length() + (_head - pos));
+        for (; pos < _head; pos++) out += _buf[pos % LOG_RING_SIZE];
+        xSemaphoreGive(_lock);
+    }
+
+private:
+    char _buf[LOG_RING_SIZE];
+    uint32_t _head = 0;     // total bytes written
+    uint32_t _tail = 0;     // total bytes drained (or overwritten)
+    uint32_t _lost = 0;
+    SemaphoreHandle_t _lock;
+};
+
+inline LogRing& logRing() {
+    static LogRing ring;
+    return ring;
+}
+
+// "<ms> <level> [MODULE] message\n" into the ring; use the LOG_* macros
+inline void logWrite(uint8_t level, const char* tag, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+inline void logWrite(uint8_t level, const char* tag, const char* fmt, ...) {
+    char line[LOG_LINE_MAX];
+    int n = snprintf(line, sizeof(line), "%lu %c [%s] ", millis(), "-EWID"[level], tag);
+    va_list args;
+    va_start(args, fmt);
+    int m = vsnprintf(line + n, sizeof(line) - n, fmt, args);
+    va_end(args);
+    n += m > 0 ? m : 0;
+    if (n > LOG_LINE_MAX - 1) n = LOG_LINE_MAX - 1;  // truncated: keep room for the newline
+    line[n++] = '\n';
+    logRing().push(line, n);
+}
+
+// Hand the UART whatever fits in its TX buffer right now; call from loops
+inline void logDrain() {
+    int room = Serial.availableForWrite();
+    if (room > 0 && !logRing().empty()) logRing().drain(Serial, room);
+}
+
+// Blocking drain, before a restart
+inline void logFlush() {
+    while (!logRing().empty()) logRing().drain(Serial, LOG_RING_SIZE);
+    Serial.flush();
+}
+
+#endif // LOG_H
@@ -0,0 +1,95 @@
+#ifndef MELODY_H
+#define MELODY_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Buzzer sounds as a list of tone steps (frequency, duration, loudness),
+// played by BuzzerService. Named melodies live here; a frame can also bring
+// its own short pattern ("tones") from the server. Nothing here touches the
+// hardware.
+
+#define BUZZER_MAX_STEPS 16
+#define BUZZER_MAX_TONES 8      // server-defined pattern per frame
+
+// hz 0 is a rest. duty: loudness, 255 = 50% duty (a square wave, the
+// loudest a piezo gets), 0 = silent
+struct ToneStep {
+    uint16_t hz;
+    uint16_t ms;
+    uint8_t duty;
+};
+
+// While a sound plays, a higher priority one cuts it off, an equal one
+// waits for it to finish, a lower one is dropped
+enum BuzzerPriority : uint8_t {
+    BUZZER_PRIO_FRAME,          // frame beeps
+    BUZZER_PRIO_FEEDBACK,       // claim, OTA, demo toggle
+    BUZZER_PRIO_ALERT           // factory reset
+};
+
+enum MelodyId : uint8_t {
+    MELODY_NONE,
+    MELODY_POSITIVE,
+    MELODY_NEGATIVE,
+    MELODY_CHIME,
+    MELODY_ALERT,
+    MELODY_COUNT
+};
+
+struct BuzzerCommand {
+    uint8_t priority;
+    uint8_t count;
+    ToneStep steps[BUZZER_MAX_STEPS];
+};
+
+static const uint16_t TONE_MAX_HZ = 8000;
+static const uint16_t TONE_MAX_MS = 2000;
+
+struct Melody {
+    const char* name;
+    uint8_t count;
+    ToneStep steps[6];
+};
+
+static const Melody MELODIES[MELODY_COUNT] = {
+    {"none", 0, {}},
+    {"positive", 2, {{600, 25, 255}, {1400, 50, 255}}},
+    {"negative", 2, {{1400, 25, 255}, {600, 50, 255}}},
+    {"chime", 3, {{1047, 80, 255}, {1319, 80, 255}, {1568, 160, 200}}},
+    {"alert", 6, {{2000, 100, 255}, {0, 60, 0}, {2000, 100, 255}, {0, 60, 0}, {2000, 100, 255}, {0, 60, 0}}},
+};
+
+// Frame "melody" name; unknown names are MELODY_NONE
+inline MelodyId melodyFromName(const char* name) {
+    for (uint8_t i = 1; i < MELODY_COUNT; i++) {
+        if (!strcmp(name, MELODIES[i].name)) return (MelodyId)i;
+    }
+    return MELODY_NONE;
+}
+
+inline BuzzerCommand buzzerMelody(MelodyId id, uint8_t priority) {
+    BuzzerCommand cmd = {};
+    cmd.priority = priority;
+    if (id >= MELODY_COUNT) return cmd;
+    cmd.count = MELODIES[id].count;
+    memcpy(cmd.steps, MELODIES[id].steps, cmd.count * sizeof(ToneStep));
+    return cmd;
+}
+
+inline BuzzerCommand buzzerTones(const ToneStep* steps, uint8_t count, uint8_t priority) {
+    BuzzerCommand cmd = {};
+    cmd.priority = priority;
+    cmd.count = count < BUZZER_MAX_STEPS ? count : BUZZER_MAX_STEPS;
+    memcpy(cmd.steps, steps, cmd.count * sizeof(ToneStep));
+    return cmd;
+}
+
+// Total length of a command, ms
+inline uint32_t buzzerDurationMs(const BuzzerCommand& cmd) {
+    uint32_t ms = 0;
+    for (uint8_t i = 0; i < cmd.count; i++) ms += cmd.steps[i].ms;
+    return ms;
+}
+
+#endif // MELODY_H
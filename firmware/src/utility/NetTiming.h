@@ -0,0 +1,137 @@
+#ifndef NET_TIMING_H
+#define NET_TIMING_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Per-phase request timing. ApiClient records each phase of every request
+// into a fixed-size histogram (no allocation, constant memory however long
+// the device runs); the summaries go out with the next heartbeat and are
+// served by the captive portal at /metrics.
+//
+// "connect" covers TCP connect plus the TLS handshake: the Arduino core's
+// WiFiClientSecure does both in one call.
+
+enum NetPhase : uint8_t {
+    NET_PHASE_DNS,       // hostname lookup (new connections only)
+    NET_PHASE_CONNECT,   // TCP + TLS handshake (new connections only)
+    NET_PHASE_TTFB,      // request sent -> response status and headers read
+    NET_PHASE_BODY,      // reading the response body off the socket
+    NET_PHASE_PARSE,     // JSON / binary container parsing
+    NET_PHASE_DECODE,    // bitmap decoding (base64, frame codecs)
+    NET_PHASE_COUNT
+};
+
+// Keys in the telemetry / metrics JSON, in order of NetPhase
+static const char* const NET_PHASE_NAMES[] = {"dns", "connect", "ttfb", "body", "parse", "decode"};
+
+// Milliseconds in power-of-two buckets: bucket 0 = 0 ms, bucket k = [2^(k-1), 2^k),
+// the last one open-ended (>= 16 s). Percentiles report the bucket's upper
+// bound, clamped to the largest value seen.
+class LatencyHistogram {
+public:
+    static const uint8_t BUCKETS = 16;
+
+    void record(uint32_t ms) {
+        uint8_t b = 0;
+        while (b < BUCKETS - 1 && (ms >> b)) b++;
+        _buckets[b]++;
+        _count++;
+        _last = ms;
+        if (ms > _max) _max = ms;
+    }
+
+    uint32_t count() const { return _count; }
+    uint32_t last() const { return _last; }
+    uint32_t max() const { return _max; }
+
+    uint32_t percentile(uint8_t pct) const {
+        if (_count == 0) return 0;
+        uint32_t rank = ((uint64_t)_count * pct + 99) / 100;
+        if (rank == 0) rank = 1;
+        uint32_t seen = 0;
+        for (uint8_t b = 0; b < BUCKETS; b++) {
+            seen += _buckets[b];
+            if (seen >= rank) {
+                uint32_t upper = b == 0 ? 0 : (1UL << b) - 1;
+                return upper < _max ? upper : _max;
+            }
+        }
+        return _max;
+    }
+
+    void toJson(JsonObject out) const {
+        out["n"] = _count;
+        out["last"] = _last;
+        out["p50"] = percentile(50);
+        out["p95"] = percentile(95);
+        out["max"] = _max;
+    }
+
+private:
+    uint32_t _buckets[BUCKETS] = {0};
+    uint32_t _count = 0;
+    uint32_t _last = 0;
+    uint32_t _max = 0;
+};
+
+// Print pass-through that adds up the time spent in the wrapped sink, to
+// split a streamed response into transfer time and processing time
+class TimedPrint : public Print {
+public:
+    Print* wrap(Print* inner) {
+        _inner = inner;
+        return inner ? this : nullptr;
+    }
+
+    uint32_t us() const { return _us; }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+
+    size_t write(const uint8_t* buf, size_t size) override {
+        if (!_inner) return size;
+        unsigned long start = micros();
+        size_t n = _inner->write(buf, size);
+        _us += micros() - start;
+        return n;
+    }
+
+private:
+    Print* _inner = nullptr;
+    uint32_t _us = 0;
+};
+
+class NetTiming {
+public:
+    void record(NetPhase phase, uint32_t ms) { _phases[phase].record(ms); }
+
+    void addRequest(size_t bytesOut) {
+        _requests++;
+        _bytesOut += bytesOut;
+    }
+    void addRetry() { _retries++; }
+    void addBytesIn(size_t bytes) { _bytesIn += bytes; }
+
+    const LatencyHistogram& phase(NetPhase p) const { return _phases[p]; }
+
+    // {requests, retries, bytesIn, bytesOut, dns: {n, last, p50, p95, max}, ...};
+    // phases that never ran are left out
+    void toJson(JsonObject out) const {
+        out["requests"] = _requests;
+        out["retries"] = _retries;
+        out["bytesIn"] = _bytesIn;
+        out["bytesOut"] = _bytesOut;
+        for (uint8_t p = 0; p < NET_PHASE_COUNT; p++) {
+            if (_phases[p].count()) _phases[p].toJson(out[NET_PHASE_NAMES[p]].to<JsonObject>());
+        }
+    }
+
+private:
+    LatencyHistogram _phases[NET_PHASE_COUNT];
+    uint32_t _requests = 0;
+    uint32_t _retries = 0;
+    uint32_t _bytesIn = 0;
+    uint32_t _bytesOut = 0;
+};
+
+#endif // NET_TIMING_H
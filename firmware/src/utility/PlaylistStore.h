@@ -0,0 +1,227 @@
+#ifndef PLAYLIST_STORE_H
+#define PLAYLIST_STORE_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "FrameStore.h"
+#include "FrameFormat.h"
+#include "LedEffect.h"
+#include "Log.h"
+
+// Last playlist kept in flash (LittleFS on the "spiffs" data partition), so
+// a reboot can put content back on screen before WiFi is up and the first
+// heartbeat can send its display hash instead of downloading it all again.
+//
+// Bitmaps are stored once per content hash (/pl/<hash>), the playlist itself
+// in a small manifest (/pl/manifest). Every file is written under a temporary
+// name and renamed into place, and LittleFS renames atomically, so after a
+// power cut the manifest is either the old playlist or the new one, never a
+// mix. Bitmaps are re-hashed when they are read back.
+//
+// The partition (128 KB with min_spiffs.csv) is 32 blocks of 4 KB, a few of
+// them LittleFS's own, and every file takes whole blocks: a mono bitmap two,
+// a gray4 one four. That is one full mono playlist plus change, but no more
+// than six gray4 frames. save() works out what a playlist needs before it
+// touches anything: when it doesn't fit next to the old one the old one is
+// dropped first, when it can't fit at all the old one stays and the save
+// fails.
+
+#define PLAYLIST_STORE_DIR "/pl"
+#define PLAYLIST_STORE_MANIFEST PLAYLIST_STORE_DIR "/manifest"
+#define PLAYLIST_STORE_MAGIC 0x34504C54  // "TLP4" (TLP3: no format, TLP2: no refresh hint, TLP1: no LED keyframes)
+#define PLAYLIST_STORE_MAX_FRAMES 8
+
+class PlaylistStore {
+public:
+    struct Header {
+        uint32_t magic;
+        uint8_t count;
+        uint32_t refreshInterval;
+        char displayHash[FRAME_HASH_LEN + 1];
+    };
+
+    // Frame metadata that survives a reboot (one-shot beep/flash don't)
+    struct Frame {
+        char hash[FRAME_HASH_LEN + 1];
+        char ledColor[16];
+        char ledBrightness[8];
+        uint32_t durationSec;
+        LedKeyframe ledKeyframes[LED_MAX_KEYFRAMES];
+        uint8_t ledKeyframeCount;
+        uint8_t refreshHint;
+        uint8_t format;             // FrameFormat, sets the bitmap's size
+    };
+
+    // Mount, formatting the partition if it has no filesystem yet
+    bool begin() {
+        if (!LittleFS.begin(true)) {
+            LOG_E(FRAMES, "LittleFS mount failed, playlist won't persist");
+            return false;
+        }
+        if (!LittleFS.exists(PLAYLIST_STORE_DIR)) LittleFS.mkdir(PLAYLIST_STORE_DIR);
+        _mounted = true;
+        return true;
+    }
+
+    // Persist a playlist: bitmaps not stored yet, then the manifest, then
+    // drop bitmaps nothing refers to any more. bitmaps[i] is frames[i]'s,
+    // frameFormatSize(frames[i].format) bytes long.
+    bool save(const Header& header, const Frame* frames, const uint8_t* const* bitmaps) {
+        if (!_mounted) return false;
+        unsigned long start = millis();
+        size_t len = sizeof(Header) + header.count * sizeof(Frame);
+
+        // Room: new bitmaps and the manifest against what's free now plus
+        // what giving up the old playlist would free
+        size_t needed = blocks(len);
+        for (uint8_t i = 0; i < header.count; i++) {
+            if (!isFirst(frames, i) || LittleFS.exists(framePath(frames[i].hash))) continue;
+            needed += blocks(frameFormatSize(frames[i].format));
+        }
+        size_t room = LittleFS.totalBytes() - LittleFS.usedBytes();
+        if (needed > room) {
+            size_t freeable = staleBytes(frames, header.count);
+            if (needed > room + freeable) {
+                LOG_W(FRAMES, "Playlist needs %u bytes of flash, at most %u free: keeping the stored one",
+                      (unsigned)needed, (unsigned)(room + freeable));
+                _fails++;
+                return false;
+            }
+            LOG_W(FRAMES, "Flash full, dropping the stored playlist");
+            LittleFS.remove(PLAYLIST_STORE_MANIFEST);
+            prune(frames, header.count);
+        }
+
+        uint32_t written = 0;
+        for (uint8_t i = 0; i < header.count; i++) {
+            String path = framePath(frames[i].hash);
+            if (LittleFS.exists(path)) continue;
+            size_t frameSize = frameFormatSize(frames[i].format);
+            if (!writeFile(path, bitmaps[i], frameSize)) {
+                _fails++;
+                return false;
+            }
+            written += frameSize;
+        }
+
+        uint8_t manifest[sizeof(Header) + PLAYLIST_STORE_MAX_FRAMES * sizeof(Frame)];
+        memcpy(manifest, &header, sizeof(Header));
+        memcpy(manifest + sizeof(Header), frames, header.count * sizeof(Frame));
+        if (!writeFile(PLAYLIST_STORE_MANIFEST, manifest, len)) {
+            _fails++;
+            return false;
+        }
+        prune(frames, header.count);
+
+        _saves++;
+        _lastSaveMs = millis() - start;
+        LOG_I(FRAMES, "Playlist saved to flash: %d frames, %u new bytes in %lu ms",
+              header.count, written, (unsigned long)_lastSaveMs);
+        return true;
+    }
+
+    // Read the manifest; frames must have room for PLAYLIST_STORE_MAX_FRAMES
+    bool load(Header& header, Frame* frames) {
+        if (!_mounted) return false;
+        File f = LittleFS.open(PLAYLIST_STORE_MANIFEST, "r");
+        if (!f) return false;
+        bool ok = f.read((uint8_t*)&header, sizeof(Header)) == sizeof(Header) &&
+                  header.magic == PLAYLIST_STORE_MAGIC &&
+                  header.count <= PLAYLIST_STORE_MAX_FRAMES &&
+                  f.read((uint8_t*)frames, header.count * sizeof(Frame)) == header.count * sizeof(Frame);
+        f.close();
+        if (!ok) LOG_W(FRAMES, "Stored playlist unreadable, ignored");
+        return ok;
+    }
+
+    bool loadBitmap(const char* hash, uint8_t* out, size_t frameSize) {
+        File f = LittleFS.open(framePath(hash), "r");
+        if (!f) return false;
+        bool ok = f.read(out, frameSize) == frameSize;
+        f.close();
+        return ok;
+    }
+
+    // Forget the stored playlist (empty playlist, factory reset, unclaimed)
+    void clear() {
+        if (!_mounted || !LittleFS.exists(PLAYLIST_STORE_MANIFEST)) return;
+        LittleFS.remove(PLAYLIST_STORE_MANIFEST);
+        prune(nullptr, 0);
+        LOG_I(FRAMES, "Stored playlist cleared");
+    }
+
+    uint32_t saves() const { return _saves; }
+    uint32_t fails() const { return _fails; }
+    uint32_t lastSaveMs() const { return _lastSaveMs; }
+
+private:
+    bool _mounted = false;
+    uint32_t _saves = 0;
+    uint32_t _fails = 0;
+    uint32_t _lastSaveMs = 0;
+
+    static String framePath(const char* hash) {
+        return String(PLAYLIST_STORE_DIR "/") + hash;
+    }
+
+    // Write under a temporary name, then rename over `path`
+    static bool writeFile(const String& path, const uint8_t* data, size_t len) {
+        String tmp = path + ".tmp";
+        File f = LittleFS.open(tmp, "w");
+        if (!f) return false;
+        bool ok = f.write(data, len) == len;
+        f.close();
+        if (ok) ok = LittleFS.rename(tmp, path);
+        if (!ok) LittleFS.remove(tmp);
+        return ok;
+    }
+
+    // LittleFS gives every file whole blocks
+    static size_t blocks(size_t len) {
+        const size_t BLOCK = 4096;
+        return (len + BLOCK - 1) / BLOCK * BLOCK;
+    }
+
+    // Playlists may show the same bitmap twice; it's stored once
+    static bool isFirst(const Frame* frames, uint8_t i) {
+        for (uint8_t j = 0; j < i; j++) {
+            if (!strcmp(frames[j].hash, frames[i].hash)) return false;
+        }
+        return true;
+    }
+
+    // Flash the manifest and every file not in `keep` take up
+    static size_t staleBytes(const Frame* keep, uint8_t count) {
+        File dir = LittleFS.open(PLAYLIST_STORE_DIR);
+        if (!dir) return 0;
+        size_t bytes = 0;
+        for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+            const char* name = f.name();
+            bool used = false;
+            for (uint8_t i = 0; i < count && !used; i++) used = !strcmp(name, keep[i].hash);
+            if (!used) bytes += blocks(f.size());
+            f.close();
+        }
+        dir.close();
+        return bytes;
+    }
+
+    // Remove every bitmap (and leftover temporary file) not in `keep`
+    static void prune(const Frame* keep, uint8_t count) {
+        File dir = LittleFS.open(PLAYLIST_STORE_DIR);
+        if (!dir) return;
+        String stale[PLAYLIST_STORE_MAX_FRAMES * 2];
+        uint8_t staleCount = 0;
+        for (File f = dir.openNextFile(); f && staleCount < PLAYLIST_STORE_MAX_FRAMES * 2; f = dir.openNextFile()) {
+            const char* name = f.name();
+            bool used = !strcmp(name, "manifest");
+            for (uint8_t i = 0; i < count && !used; i++) used = !strcmp(name, keep[i].hash);
+            if (!used) stale[staleCount++] = framePath(name);
+            f.close();
+        }
+        dir.close();
+        for (uint8_t i = 0; i < staleCount; i++) LittleFS.remove(stale[i]);
+    }
+};
+
+#endif // PLAYLIST_STORE_H
@@ -0,0 +1,127 @@
+#ifndef REFRESH_POLICY_H
+#define REFRESH_POLICY_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Which waveform a frame update gets. A full refresh (~2 s, flashing)
+// leaves the panel clean; fast (the vendor's "fast refresh 1": the full
+// waveform run as if the panel were hot, ~1 s) and partial (only the
+// changed window, no flashing) are quicker but each leaves a little
+// ghosting behind. The policy keeps a ghosting budget -- partial updates,
+// fast updates and the pixels they changed since the last full refresh --
+// and asks for a cleansing full refresh only once it is spent.
+
+// Changed pixels (% of the screen) up to which a frame goes through a
+// partial window; more than that gets a fast refresh
+#ifndef DISPLAY_PARTIAL_MAX_PERCENT
+#define DISPLAY_PARTIAL_MAX_PERCENT 25
+#endif
+
+// Ghosting budget between full refreshes
+#ifndef DISPLAY_GHOST_MAX_PARTIALS
+#define DISPLAY_GHOST_MAX_PARTIALS 30
+#endif
+#ifndef DISPLAY_GHOST_MAX_FASTS
+#define DISPLAY_GHOST_MAX_FASTS 10
+#endif
+// Pixels changed by partial updates (fast ones count a quarter), % of the screen
+#ifndef DISPLAY_GHOST_INK_PERCENT
+#define DISPLAY_GHOST_INK_PERCENT 150
+#endif
+
+// What a frame update did
+enum RefreshType : uint8_t {
+    REFRESH_SKIPPED,        // same frame as on the panel
+    REFRESH_PARTIAL,        // partial window around the changes
+    REFRESH_FAST,
+    REFRESH_FULL,
+    REFRESH_GRAY4,          // 4-level gray frame (full waveform of its own)
+    REFRESH_TYPES
+};
+
+// Server's per-frame "refresh" hint
+enum RefreshHint : uint8_t {
+    REFRESH_HINT_AUTO,      // by the size of the change and the budget
+    REFRESH_HINT_FULL,      // always full (e.g. a frame with large solid areas)
+    REFRESH_HINT_FAST,      // fast even for small changes
+    REFRESH_HINT_PARTIAL    // partial even for large changes
+};
+
+inline RefreshHint refreshHintFromName(const char* name) {
+    if (!strcmp(name, "full")) return REFRESH_HINT_FULL;
+    if (!strcmp(name, "fast")) return REFRESH_HINT_FAST;
+    if (!strcmp(name, "partial")) return REFRESH_HINT_PARTIAL;
+    return REFRESH_HINT_AUTO;
+}
+
+class RefreshPolicy {
+public:
+    explicit RefreshPolicy(uint32_t screenPx) : _screenPx(screenPx) {}
+
+    // Waveform for an update that changes `changed` pixels
+    RefreshType choose(uint32_t changed, RefreshHint hint) const {
+        if (hint == REFRESH_HINT_FULL) return REFRESH_FULL;
+        if (changed == 0) return REFRESH_SKIPPED;
+        RefreshType type;
+        if (hint == REFRESH_HINT_PARTIAL) type = REFRESH_PARTIAL;
+        else if (hint == REFRESH_HINT_FAST) type = REFRESH_FAST;
+        else type = changed * 100ULL <= (uint64_t)_screenPx * DISPLAY_PARTIAL_MAX_PERCENT ? REFRESH_PARTIAL : REFRESH_FAST;
+        return fits(type, changed) ? type : REFRESH_FULL;
+    }
+
+    // After the panel was refreshed with `type`. `forced`: a full refresh
+    // that only happened because the budget was spent.
+    void record(RefreshType type, uint32_t changed, bool forced = false) {
+        switch (type) {
+        case REFRESH_PARTIAL:
+            _partials++;
+            _inkPx += changed;
+            break;
+        case REFRESH_FAST:
+            _fasts++;
+            _inkPx += changed / 4;
+            break;
+        case REFRESH_FULL:
+        case REFRESH_GRAY4:
+            _partials = _fasts = 0;
+            _inkPx = 0;
+            if (forced) _cleanses++;
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Would `type` changing `changed` pixels stay within the budget
+    bool fits(RefreshType type, uint32_t changed) const {
+        if (type == REFRESH_PARTIAL) {
+            return _partials < DISPLAY_GHOST_MAX_PARTIALS && inkFits(_inkPx + changed);
+        }
+        if (type == REFRESH_FAST) {
+            return _fasts < DISPLAY_GHOST_MAX_FASTS && inkFits(_inkPx + changed / 4);
+        }
+        return true;
+    }
+
+    uint32_t partials() const { return _partials; }
+    uint32_t fasts() const { return _fasts; }
+    uint32_t cleanses() const { return _cleanses; }
+    // Ink budget used, % (of DISPLAY_GHOST_INK_PERCENT)
+    uint32_t inkUsedPercent() const {
+        return (uint32_t)(_inkPx * 10000ULL / ((uint64_t)_screenPx * DISPLAY_GHOST_INK_PERCENT));
+    }
+
+private:
+    uint32_t _screenPx;
+    uint32_t _partials = 0;
+    uint32_t _fasts = 0;
+    uint32_t _inkPx = 0;
+    uint32_t _cleanses = 0;
+
+    bool inkFits(uint32_t inkPx) const {
+        return inkPx * 100ULL <= (uint64_t)_screenPx * DISPLAY_GHOST_INK_PERCENT;
+    }
+};
+
+#endif // REFRESH_POLICY_H
@@ -0,0 +1,106 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <Arduino.h>
+#include "mbedtls/md.h"
+
+// Incremental SHA-256 through mbedtls, which the ESP32 core builds on the
+// hardware SHA engine (it falls back to software by itself when another
+// context holds the engine). Keeps byte and time totals for telemetry.
+
+#define SHA256_HEX_LEN 64
+
+class Sha256 {
+public:
+    Sha256() {
+        mbedtls_md_init(&_ctx);
+        mbedtls_md_setup(&_ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 0);
+    }
+    ~Sha256() { mbedtls_md_free(&_ctx); }
+    Sha256(const Sha256&) = delete;
+    Sha256& operator=(const Sha256&) = delete;
+
+    void begin() { mbedtls_md_starts(&_ctx); }
+
+    void update(const uint8_t* data, size_t len) {
+        unsigned long start = micros();
+        mbedtls_md_update(&_ctx, data, len);
+        _us += micros() - start;
+        _bytes += len;
+    }
+
+    void finish(uint8_t digest[32]) { mbedtls_md_finish(&_ctx, digest); }
+
+    // Finish and compare with a lowercase hex digest
+    bool finishMatches(const char* hex) {
+        uint8_t digest[32];
+        finish(digest);
+        return hexEquals(digest, hex);
+    }
+
+    static bool hexEquals(const uint8_t digest[32], const char* hex) {
+        if (!hex || strlen(hex) != SHA256_HEX_LEN) return false;
+        static const char digits[] = "0123456789abcdef";
+        for (int i = 0; i < 32; i++) {
+            if (hex[i * 2] != digits[digest[i] >> 4] || hex[i * 2 + 1] != digits[digest[i] & 0x0F]) return false;
+        }
+        return true;
+    }
+
+    uint32_t bytes() const { return _bytes; }
+    uint32_t us() const { return _us; }
+
+private:
+    mbedtls_md_context_t _ctx;
+    uint32_t _bytes = 0;
+    uint32_t _us = 0;
+};
+
+// Hashes a decoder's output as it is produced: after each chunk passed
+// through, the newly decoded bytes go into the digest, so it is ready the
+// moment the input ends. Only for decoders that append to their output
+// (not the XOR patcher, which rewrites bytes already there).
+template <class Decoder>
+class DigestingSink : public Print {
+public:
+    // Start a digest over `decoder`'s output buffer `out`
+    Print* wrap(Decoder* decoder, const uint8_t* out) {
+        _decoder = decoder;
+        _out = out;
+        _hashed = 0;
+        _sha.begin();
+        return decoder ? this : nullptr;
+    }
+
+    bool matches(const char* hex) {
+        flush();
+        return _sha.finishMatches(hex);
+    }
+
+    const Sha256& sha() const { return _sha; }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+
+    size_t write(const uint8_t* buf, size_t size) override {
+        size_t n = _decoder->write(buf, size);
+        flush();
+        return n;
+    }
+
+private:
+    Decoder* _decoder = nullptr;
+    const uint8_t* _out = nullptr;
+    size_t _hashed = 0;
+    Sha256 _sha;
+
+    void flush() {
+        if (!_decoder) return;
+        size_t len = _decoder->length();
+        if (len > _hashed) {
+            _sha.update(_out + _hashed, len - _hashed);
+            _hashed = len;
+        }
+    }
+};
+
+#endif // SHA256_H
@@ -0,0 +1,179 @@
+#ifndef WIFI_CONNECT_H
+#define WIFI_CONNECT_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <Preferences.h>
+#include <ArduinoJson.h>
+#include "NetTiming.h"
+#include "Log.h"
+
+// Station connect with a scan-free fast path. After every successful join
+// the AP's BSSID and channel are kept in NVS; the next join for the same
+// SSID goes straight to that AP on that channel instead of scanning all
+// channels first. If the AP isn't there any more (or the join stalls), the
+// cached AP is forgotten and the join falls back to the usual full scan.
+// The driver's own auto-reconnect after a drop reuses the same target, so
+// drops are watched as well and fall back the same way.
+//
+// An optional static IP (set in the portal) skips DHCP altogether.
+//
+// The UI loop drives it through loop() (called from captivePortalLoop()).
+
+// Fast join / reconnect that hasn't got an IP by then falls back to a scan
+#ifndef WIFI_FAST_TIMEOUT_MS
+#define WIFI_FAST_TIMEOUT_MS 8000
+#endif
+
+#define NVS_WIFI_AP_SSID "apSsid"       // SSID the cached BSSID belongs to
+#define NVS_WIFI_AP_BSSID "apBssid"
+#define NVS_WIFI_AP_CHANNEL "apChannel"
+#define NVS_WIFI_STATIC_IP "staticIp"
+#define NVS_WIFI_GATEWAY "gateway"
+#define NVS_WIFI_SUBNET "subnet"
+#define NVS_WIFI_DNS "dns"
+
+class WifiConnect {
+public:
+    // Join `ssid`, through the cached AP when there is one for it
+    void begin(const String& ssid, const String& password) {
+        _ssid = ssid;
+        _password = password;
+
+        Preferences prefs;
+        prefs.begin("tigermeter", true);
+        applyStaticIp(prefs);
+        _fast = prefs.getString(NVS_WIFI_AP_SSID, "") == ssid &&
+                prefs.getBytes(NVS_WIFI_AP_BSSID, _bssid, sizeof(_bssid)) == sizeof(_bssid);
+        _channel = prefs.getUChar(NVS_WIFI_AP_CHANNEL, 0);
+        prefs.end();
+        _fast &= _channel > 0;
+
+        if (_fast) {
+            LOG_I(NET, "WiFi: joining %s on channel %d (cached AP, no scan)", ssid.c_str(), _channel);
+            WiFi.begin(ssid.c_str(), pass(), _channel, _bssid);
+        } else {
+            LOG_I(NET, "WiFi: joining %s (scan)", ssid.c_str());
+            WiFi.begin(ssid.c_str(), pass());
+        }
+        _state = JOINING;
+        _startMs = millis();
+    }
+
+    void loop() {
+        if (_state == IDLE) return;
+        bool connected = WiFi.status() == WL_CONNECTED;
+
+        if (_state == CONNECTED) {
+            if (!connected) {
+                // Dropped: the driver reconnects by itself, to the same target
+                _drops++;
+                _state = JOINING;
+                _startMs = millis();
+                LOG_W(NET, "WiFi: connection lost, reconnecting");
+            }
+            return;
+        }
+
+        uint32_t elapsed = millis() - _startMs;
+        if (connected) {
+            _connectMs.record(elapsed);
+            if (_fast) _fastJoins++;
+            else _scanJoins++;
+            _state = CONNECTED;
+            LOG_I(NET, "WiFi: connected in %u ms (%s), IP %s", elapsed, _fast ? "cached AP" : "scan",
+                  WiFi.localIP().toString().c_str());
+            rememberAp();
+            return;
+        }
+
+        // Cached AP gone (or not answering): forget it and scan
+        wl_status_t status = WiFi.status();
+        bool failed = status == WL_NO_SSID_AVAIL || status == WL_CONNECT_FAILED || elapsed > WIFI_FAST_TIMEOUT_MS;
+        if (_fast && failed) {
+            _fastFails++;
+            _fast = false;
+            LOG_W(NET, "WiFi: cached AP failed (status %d), falling back to scan", status);
+            forgetAp();
+            WiFi.disconnect();
+            WiFi.begin(_ssid.c_str(), pass());
+        }
+    }
+
+    // {fast, scan, fastFails, drops, connect: {n, last, p50, p95, max}}
+    void toJson(JsonObject out) const {
+        out["fast"] = _fastJoins;
+        out["scan"] = _scanJoins;
+        out["fastFails"] = _fastFails;
+        out["drops"] = _drops;
+        if (_connectMs.count()) _connectMs.toJson(out["connect"].to<JsonObject>());
+    }
+
+private:
+    enum State : uint8_t { IDLE, JOINING, CONNECTED };
+
+    State _state = IDLE;
+    String _ssid;
+    String _password;
+    bool _fast = false;
+    uint8_t _bssid[6] = {0};
+    uint8_t _channel = 0;
+    unsigned long _startMs = 0;
+
+    LatencyHistogram _connectMs;    // join or reconnect -> got IP
+    uint32_t _fastJoins = 0;
+    uint32_t _scanJoins = 0;
+    uint32_t _fastFails = 0;
+    uint32_t _drops = 0;
+
+    const char* pass() const { return _password.length() ? _password.c_str() : nullptr; }
+
+    // Static IP from the portal, or back to DHCP when none is set
+    static void applyStaticIp(Preferences& prefs) {
+        IPAddress ip, gateway, subnet, dns;
+        if (ip.fromString(prefs.getString(NVS_WIFI_STATIC_IP, "")) &&
+            gateway.fromString(prefs.getString(NVS_WIFI_GATEWAY, ""))) {
+            if (!subnet.fromString(prefs.getString(NVS_WIFI_SUBNET, ""))) subnet = IPAddress(255, 255, 255, 0);
+            if (!dns.fromString(prefs.getString(NVS_WIFI_DNS, ""))) dns = gateway;
+            WiFi.config(ip, gateway, subnet, dns);
+            LOG_I(NET, "WiFi: static IP %s", ip.toString().c_str());
+        } else {
+            WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+        }
+    }
+
+    // Keep the AP we joined for the next time (only written when it changed)
+    void rememberAp() {
+        uint8_t* bssid = WiFi.BSSID();
+        uint8_t channel = WiFi.channel();
+        if (!bssid || channel == 0) return;
+        if (_fast && channel == _channel && !memcmp(bssid, _bssid, sizeof(_bssid))) return;
+        memcpy(_bssid, bssid, sizeof(_bssid));
+        _channel = channel;
+
+        Preferences prefs;
+        prefs.begin("tigermeter", false);
+        prefs.putString(NVS_WIFI_AP_SSID, _ssid);
+        prefs.putBytes(NVS_WIFI_AP_BSSID, _bssid, sizeof(_bssid));
+        prefs.putUChar(NVS_WIFI_AP_CHANNEL, _channel);
+        prefs.end();
+        LOG_D(NET, "WiFi: cached AP %02X:%02X:%02X:%02X:%02X:%02X channel %d",
+              _bssid[0], _bssid[1], _bssid[2], _bssid[3], _bssid[4], _bssid[5], _channel);
+    }
+
+    static void forgetAp() {
+        Preferences prefs;
+        prefs.begin("tigermeter", false);
+        prefs.remove(NVS_WIFI_AP_SSID);
+        prefs.remove(NVS_WIFI_AP_BSSID);
+        prefs.remove(NVS_WIFI_AP_CHANNEL);
+        prefs.end();
+    }
+};
+
+inline WifiConnect& wifiConnect() {
+    static WifiConnect instance;
+    return instance;
+}
+
+#endif // WIFI_CONNECT_H
@@ -0,0 +1,192 @@
+#ifndef MOCK_ARDUINO_H
+#define MOCK_ARDUINO_H
+
+// Just enough of the Arduino core and FreeRTOS for the header-only
+// utilities to build in the native test environment. Time is simulated:
+// millis() only moves when a test (or a blocking queue receive) moves it,
+// so timing tests are exact and don't sleep. A task under test runs on the
+// test's thread; what the other tasks do is scheduled with mock::at().
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace mock {
+
+inline uint32_t& nowMs() {
+    static uint32_t now = 0;
+    return now;
+}
+
+inline void advance(uint32_t ms) { nowMs() += ms; }
+
+}  // namespace mock
+
+// 32-bit like the ESP32's unsigned long, so they wrap as on the device
+inline uint32_t millis() { return mock::nowMs(); }
+inline uint32_t micros() { return mock::nowMs() * 1000u; }
+inline void delay(uint32_t ms) { mock::advance(ms); }
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buf, size_t size) {
+        size_t n = 0;
+        while (n < size && write(buf[n])) n++;
+        return n;
+    }
+    size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+};
+
+class String {
+public:
+    String(const char* s = "") : _s(s) {}
+    void reserve(size_t n) { _s.reserve(n); }
+    size_t length() const { return _s.length(); }
+    const char* c_str() const { return _s.c_str(); }
+    String& operator+=(char c) { _s += c; return *this; }
+    String& operator+=(const char* s) { _s += s; return *this; }
+    friend String operator+(const String& a, const char* b) { return String((a._s + b).c_str()); }
+    bool operator==(const String& o) const { return _s == o._s; }
+
+private:
+    std::string _s;
+};
+
+class MockSerial : public Print {
+public:
+    size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+    using Print::write;
+    int availableForWrite() { return 0; }
+    void flush() { fflush(stdout); }
+};
+
+inline MockSerial Serial;
+
+inline void* ps_malloc(size_t size) { return malloc(size); }
+
+// ---- FreeRTOS ----
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY 0xFFFFFFFFu
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+typedef void* SemaphoreHandle_t;
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return (SemaphoreHandle_t)1; }
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t) { return pdTRUE; }
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t) { return pdTRUE; }
+
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+namespace mock {
+
+// Tasks are not started: the test calls the entry point itself, on its own
+// thread, once it has scheduled what the task should see
+struct Task {
+    TaskFunction_t entry = nullptr;
+    void* arg = nullptr;
+};
+
+inline Task& lastTask() {
+    static Task task;
+    return task;
+}
+
+// Something another task does at a given simulated time (post a command,
+// say). Runs while the task under test waits on a queue.
+struct Action {
+    uint32_t at;
+    std::function<void()> run;
+};
+
+inline std::deque<Action>& actions() {
+    static std::deque<Action> pending;
+    return pending;
+}
+
+inline void at(uint32_t ms, std::function<void()> run) {
+    auto& list = actions();
+    auto pos = list.end();
+    while (pos != list.begin() && (int32_t)((pos - 1)->at - ms) > 0) --pos;
+    list.insert(pos, Action{ms, run});
+}
+
+// A blocking receive with nothing left to deliver ever: the task under
+// test is done, unwind out of its loop
+struct Idle {};
+
+struct Queue {
+    size_t itemSize;
+    size_t capacity;
+    std::deque<std::vector<uint8_t>> items;
+};
+
+}  // namespace mock
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t entry, const char*, uint32_t, void* arg, int,
+                                          TaskHandle_t* handle, int) {
+    mock::lastTask().entry = entry;
+    mock::lastTask().arg = arg;
+    if (handle) *handle = (TaskHandle_t)&mock::lastTask();
+    return pdTRUE;
+}
+
+typedef void* QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(size_t length, size_t itemSize) {
+    mock::Queue* q = new mock::Queue();
+    q->itemSize = itemSize;
+    q->capacity = length;
+    return q;
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t) {
+    mock::Queue* q = static_cast<mock::Queue*>(queue);
+    if (q->items.size() >= q->capacity) return pdFALSE;
+    q->items.emplace_back((const uint8_t*)item, (const uint8_t*)item + q->itemSize);
+    return pdTRUE;
+}
+
+// Waits in simulated time: actions due within the timeout run in order
+// (moving the clock to each) until one leaves something in the queue;
+// otherwise the clock moves on by the whole timeout
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks) {
+    mock::Queue* q = static_cast<mock::Queue*>(queue);
+    uint32_t deadline = mock::nowMs() + ticks;
+    auto& actions = mock::actions();
+    while (q->items.empty() && !actions.empty() &&
+           (ticks == portMAX_DELAY || (int32_t)(actions.front().at - deadline) <= 0)) {
+        mock::Action next = actions.front();
+        actions.pop_front();
+        if ((int32_t)(next.at - mock::nowMs()) > 0) mock::nowMs() = next.at;
+        next.run();
+    }
+    if (!q->items.empty()) {
+        memcpy(item, q->items.front().data(), q->itemSize);
+        q->items.pop_front();
+        return pdTRUE;
+    }
+    if (ticks == portMAX_DELAY) throw mock::Idle();
+    mock::nowMs() = deadline;
+    return pdFALSE;
+}
+
+#endif // MOCK_ARDUINO_H
@@ -0,0 +1,143 @@
+#ifndef MOCK_LITTLEFS_H
+#define MOCK_LITTLEFS_H
+
+// An in-memory LittleFS with the real one's space accounting: the partition
+// is whole blocks, a few of them the filesystem's own, and every file takes
+// whole blocks. A write that doesn't fit writes nothing and returns 0.
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mock {
+
+struct Flash {
+    size_t blockSize = 4096;
+    size_t blocks = 32;             // min_spiffs.csv: 128 KB
+    size_t reservedBlocks = 4;      // superblock pair, /pl directory pair
+    std::map<std::string, std::vector<uint8_t>> files;
+    std::vector<std::string> dirs;
+
+    size_t fileBlocks(size_t len) const { return (len + blockSize - 1) / blockSize; }
+
+    size_t usedBlocks() const {
+        size_t n = reservedBlocks;
+        for (const auto& f : files) n += fileBlocks(f.second.size());
+        return n;
+    }
+};
+
+inline Flash& flash() {
+    static Flash fs;
+    return fs;
+}
+
+}  // namespace mock
+
+class File {
+public:
+    File() {}
+
+    explicit operator bool() const { return _state != nullptr; }
+
+    size_t read(uint8_t* buf, size_t len) {
+        const std::vector<uint8_t>& data = mock::flash().files[_state->path];
+        size_t n = data.size() - _state->pos < len ? data.size() - _state->pos : len;
+        memcpy(buf, data.data() + _state->pos, n);
+        _state->pos += n;
+        return n;
+    }
+
+    size_t write(const uint8_t* buf, size_t len) {
+        mock::Flash& fs = mock::flash();
+        std::vector<uint8_t>& data = fs.files[_state->path];
+        size_t grow = fs.fileBlocks(data.size() + len) - fs.fileBlocks(data.size());
+        if (fs.usedBlocks() + grow > fs.blocks) return 0;
+        data.insert(data.end(), buf, buf + len);
+        return len;
+    }
+
+    size_t size() const { return mock::flash().files[_state->path].size(); }
+
+    // Base name, as the ESP32 core's LittleFS gives it
+    const char* name() const { return _state->path.c_str() + _state->path.find_last_of('/') + 1; }
+
+    // Directory listing, in name order
+    File openNextFile() {
+        const auto& files = mock::flash().files;
+        std::string prefix = _state->path + "/";
+        auto it = files.upper_bound(_state->last.empty() ? prefix : _state->last);
+        if (it == files.end() || it->first.compare(0, prefix.size(), prefix) != 0) return File();
+        _state->last = it->first;
+        return File(it->first);
+    }
+
+    void close() {}
+
+private:
+    friend class MockLittleFS;
+
+    struct State {
+        std::string path;
+        size_t pos = 0;
+        std::string last;
+    };
+    std::shared_ptr<State> _state;
+
+    explicit File(const std::string& path) : _state(std::make_shared<State>()) { _state->path = path; }
+};
+
+class MockLittleFS {
+public:
+    bool begin(bool) { return true; }
+
+    bool exists(const String& path) {
+        mock::Flash& fs = mock::flash();
+        return fs.files.count(path.c_str()) || isDir(path.c_str());
+    }
+
+    bool mkdir(const String& path) {
+        mock::flash().dirs.push_back(path.c_str());
+        return true;
+    }
+
+    File open(const String& path, const char* mode = "r") {
+        mock::Flash& fs = mock::flash();
+        if (isDir(path.c_str())) return File(path.c_str());
+        if (mode[0] == 'w') {
+            fs.files[path.c_str()].clear();
+        } else if (!fs.files.count(path.c_str())) {
+            return File();
+        }
+        return File(path.c_str());
+    }
+
+    bool remove(const String& path) { return mock::flash().files.erase(path.c_str()) > 0; }
+
+    bool rename(const String& from, const String& to) {
+        auto& files = mock::flash().files;
+        auto it = files.find(from.c_str());
+        if (it == files.end()) return false;
+        std::vector<uint8_t> data = it->second;
+        files.erase(it);
+        files[to.c_str()] = data;
+        return true;
+    }
+
+    size_t totalBytes() { return mock::flash().blocks * mock::flash().blockSize; }
+    size_t usedBytes() { return mock::flash().usedBlocks() * mock::flash().blockSize; }
+
+private:
+    static bool isDir(const std::string& path) {
+        for (const auto& d : mock::flash().dirs) {
+            if (d == path) return true;
+        }
+        return false;
+    }
+};
+
+inline MockLittleFS LittleFS;
+
+#endif // MOCK_LITTLEFS_H
@@ -0,0 +1,54 @@
+#ifndef MOCK_DRIVER_LEDC_H
+#define MOCK_DRIVER_LEDC_H
+
+// LEDC stand-in: records what the buzzer/LED code asks of the hardware
+// (the frequency and duty in effect after each call) with the simulated time
+
+#include <Arduino.h>
+#include <vector>
+
+typedef enum { LEDC_LOW_SPEED_MODE } ledc_mode_t;
+typedef enum { LEDC_TIMER_0, LEDC_TIMER_1, LEDC_TIMER_2, LEDC_TIMER_3 } ledc_timer_t;
+typedef enum { LEDC_CHANNEL_0, LEDC_CHANNEL_1, LEDC_CHANNEL_2, LEDC_CHANNEL_3 } ledc_channel_t;
+typedef int esp_err_t;
+
+namespace mock {
+
+struct LedcEvent {
+    uint32_t ms;
+    uint32_t hz;
+    uint32_t duty;
+};
+
+struct Ledc {
+    uint32_t hz = 0;
+    uint32_t duty = 0;          // set, not yet applied
+    uint32_t appliedDuty = 0;
+    std::vector<LedcEvent> events;  // one per update
+};
+
+inline Ledc& ledc() {
+    static Ledc state;
+    return state;
+}
+
+}  // namespace mock
+
+inline esp_err_t ledc_set_freq(ledc_mode_t, ledc_timer_t, uint32_t hz) {
+    mock::ledc().hz = hz;
+    return 0;
+}
+
+inline esp_err_t ledc_set_duty(ledc_mode_t, ledc_channel_t, uint32_t duty) {
+    mock::ledc().duty = duty;
+    return 0;
+}
+
+inline esp_err_t ledc_update_duty(ledc_mode_t, ledc_channel_t) {
+    mock::Ledc& l = mock::ledc();
+    l.appliedDuty = l.duty;
+    l.events.push_back({(uint32_t)millis(), l.hz, l.duty});
+    return 0;
+}
+
+#endif // MOCK_DRIVER_LEDC_H
@@ -0,0 +1,25 @@
+#ifndef MOCK_MBEDTLS_MD_H
+#define MOCK_MBEDTLS_MD_H
+
+// Sha256.h builds on these; the native suites include it (through
+// FrameStore.h) but never hash, so they do nothing
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum { MBEDTLS_MD_SHA256 } mbedtls_md_type_t;
+typedef struct mbedtls_md_info_t mbedtls_md_info_t;
+typedef struct { int unused; } mbedtls_md_context_t;
+
+inline void mbedtls_md_init(mbedtls_md_context_t*) {}
+inline void mbedtls_md_free(mbedtls_md_context_t*) {}
+inline const mbedtls_md_info_t* mbedtls_md_info_from_type(mbedtls_md_type_t) { return nullptr; }
+inline int mbedtls_md_setup(mbedtls_md_context_t*, const mbedtls_md_info_t*, int) { return 0; }
+inline int mbedtls_md_starts(mbedtls_md_context_t*) { return 0; }
+inline int mbedtls_md_update(mbedtls_md_context_t*, const unsigned char*, size_t) { return 0; }
+inline int mbedtls_md_finish(mbedtls_md_context_t*, unsigned char* out) {
+    for (int i = 0; i < 32; i++) out[i] = 0;
+    return 0;
+}
+
+#endif // MOCK_MBEDTLS_MD_H
@@ -0,0 +1,123 @@
+// blitRotated() against the pixel-by-pixel path it replaces in
+// Display::drawBitmap() (each black source pixel through the panel's
+// drawPixel() under setRotation(1)): same buffer for every rotate180 /
+// invert combination and placement, nothing drawn for images it can't take.
+// Prints the time of both for a full-screen frame.
+//
+//   pio test -e native -f test_bitblit -v
+
+#include <unity.h>
+#include <chrono>
+
+#include "BitBlit.h"
+#include "FrameFormat.h"
+
+static const int16_t NATIVE_W = 168;
+static const int16_t NATIVE_H = 384;
+static const int16_t SCREEN_W = NATIVE_H;
+static const int16_t SCREEN_H = NATIVE_W;
+static const size_t BUFFER_SIZE = NATIVE_W / 8 * NATIVE_H;
+
+static uint8_t expected[BUFFER_SIZE];
+static uint8_t actual[BUFFER_SIZE];
+static uint8_t image[DISPLAY_FRAME_SIZE];
+
+static uint32_t lcg;
+static uint32_t next() {
+    lcg = lcg * 1664525 + 1013904223;
+    return lcg >> 8;
+}
+
+// DisplayPanel::drawPixel() under setRotation(1)
+static void drawPixel(uint8_t* buffer, int16_t x, int16_t y, bool black) {
+    if (x < 0 || x >= SCREEN_W || y < 0 || y >= SCREEN_H) return;
+    int16_t nx = NATIVE_W - y - 1, ny = x;
+    uint8_t bit = 0x80 >> (nx % 8);
+    if (black) buffer[nx / 8 + ny * (NATIVE_W / 8)] &= ~bit;
+    else buffer[nx / 8 + ny * (NATIVE_W / 8)] |= bit;
+}
+
+// Display::drawBitmap()'s per-pixel fallback
+static void drawPixels(uint8_t* buffer, int16_t x, int16_t y, const uint8_t* bitmap, int16_t w, int16_t h,
+                       bool rotate180, bool invert) {
+    for (int16_t dy = 0; dy < h; dy++) {
+        for (int16_t dx = 0; dx < w; dx++) {
+            int srcX = rotate180 ? w - 1 - dx : dx;
+            int srcY = rotate180 ? h - 1 - dy : dy;
+            bool white = (bitmap[(srcY * w + srcX) / 8] >> (7 - srcX % 8)) & 1;
+            if (!white) drawPixel(buffer, x + dx, y + dy, !invert);
+        }
+    }
+}
+
+// Random image (a third of the bytes all white, as blank areas are) over
+// a random buffer, drawn both ways
+static void assertSame(int16_t x, int16_t y, int16_t w, int16_t h, bool rotate180, bool invert) {
+    for (int i = 0; i < w * h / 8; i++) image[i] = next() % 3 ? next() : 0xFF;
+    for (size_t i = 0; i < BUFFER_SIZE; i++) expected[i] = actual[i] = next();
+    drawPixels(expected, x, y, image, w, h, rotate180, invert);
+    TEST_ASSERT_TRUE(blitRotated(actual, NATIVE_W, NATIVE_H, x, y, image, w, h, rotate180, invert));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, actual, BUFFER_SIZE);
+}
+
+void setUp() {
+    lcg = 12345;
+}
+
+void tearDown() {}
+
+static void test_full_frame() {
+    for (int mode = 0; mode < 4; mode++) assertSame(0, 0, SCREEN_W, SCREEN_H, mode & 1, mode & 2);
+}
+
+static void test_aligned_placements() {
+    for (int i = 0; i < 200; i++) {
+        int16_t w = 8 * (1 + next() % (SCREEN_W / 8));
+        int16_t h = 8 * (1 + next() % (SCREEN_H / 8));
+        int16_t x = next() % (SCREEN_W - w + 1);
+        int16_t y = 8 * (next() % ((SCREEN_H - h) / 8 + 1));
+        assertSame(x, y, w, h, i & 1, i & 2);
+    }
+}
+
+static void test_rejects_what_it_cant_blit() {
+    struct { int16_t x, y, w, h; } cases[] = {
+        {0, 3, 64, 64},                 // y off the byte grid
+        {0, 0, 60, 64},                 // width not whole bytes
+        {0, 0, 64, 20},                 // height not whole blocks
+        {-8, 0, 64, 64},                // off the left edge
+        {SCREEN_W - 32, 0, 64, 64},     // off the right edge
+        {0, SCREEN_H - 32, 64, 64},     // off the bottom
+    };
+    memset(image, 0x00, sizeof(image));
+    for (auto c : cases) {
+        memset(actual, 0xFF, BUFFER_SIZE);
+        TEST_ASSERT_FALSE(blitRotated(actual, NATIVE_W, NATIVE_H, c.x, c.y, image, c.w, c.h, false, false));
+        for (size_t i = 0; i < BUFFER_SIZE; i++) TEST_ASSERT_EQUAL_UINT8(0xFF, actual[i]);
+    }
+}
+
+static void test_blit_time() {
+    for (size_t i = 0; i < DISPLAY_FRAME_SIZE; i++) image[i] = next();
+    memset(expected, 0xFF, BUFFER_SIZE);
+    memset(actual, 0xFF, BUFFER_SIZE);
+    const int runs = 200;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < runs; r++) drawPixels(expected, 0, 0, image, SCREEN_W, SCREEN_H, false, false);
+    auto middle = std::chrono::steady_clock::now();
+    for (int r = 0; r < runs; r++) blitRotated(actual, NATIVE_W, NATIVE_H, 0, 0, image, SCREEN_W, SCREEN_H, false, false);
+    auto end = std::chrono::steady_clock::now();
+    double pixelUs = std::chrono::duration<double, std::micro>(middle - start).count() / runs;
+    double blitUs = std::chrono::duration<double, std::micro>(end - middle).count() / runs;
+    printf("full frame: per pixel %.1f us, blit %.1f us (%.0fx)\n", pixelUs, blitUs, pixelUs / blitUs);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, actual, BUFFER_SIZE);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_full_frame);
+    RUN_TEST(test_aligned_placements);
+    RUN_TEST(test_rejects_what_it_cant_blit);
+    RUN_TEST(test_blit_time);
+    return UNITY_END();
+}
@@ -0,0 +1,150 @@
+// BuzzerService against a recording LEDC: each step's tone starts on time
+// and lasts as long as asked, a higher priority cuts the sound in progress
+// off, equal priorities wait (only the latest), lower ones are dropped.
+// The service task runs on the test's thread in simulated time; commands
+// from other tasks are scheduled with mock::at().
+//
+//   pio test -e native -f test_buzzer_service -v
+
+#include <unity.h>
+
+#include "BuzzerService.h"
+
+static const uint32_t HALF_DUTY = 2048;     // 12-bit duty resolution
+
+static BuzzerService* buzzer;
+
+// Post `id` at simulated time `ms`, as another task would
+static void playAt(uint32_t ms, MelodyId id, uint8_t priority) {
+    mock::at(ms, [id, priority] { buzzer->play(id, priority); });
+}
+
+// Run the service task until nothing more will ever reach it
+static void runBuzzer() {
+    try {
+        mock::lastTask().entry(mock::lastTask().arg);
+    } catch (mock::Idle&) {
+    }
+}
+
+static uint32_t counter(const char* name) {
+    JsonDocument doc;
+    buzzer->toJson(doc.to<JsonObject>());
+    return doc[name].as<uint32_t>();
+}
+
+// The hardware is at `hz` (0: silent) from `ms` on
+static void assertEvent(size_t i, uint32_t ms, uint32_t hz) {
+    const std::vector<mock::LedcEvent>& events = mock::ledc().events;
+    TEST_ASSERT_LESS_THAN(events.size(), i);
+    TEST_ASSERT_EQUAL_UINT32(ms, events[i].ms);
+    if (hz == 0) {
+        TEST_ASSERT_EQUAL_UINT32(0, events[i].duty);
+    } else {
+        TEST_ASSERT_EQUAL_UINT32(hz, events[i].hz);
+        TEST_ASSERT_GREATER_THAN(0, events[i].duty);
+    }
+}
+
+void setUp() {
+    mock::nowMs() = 1000;
+    mock::actions().clear();
+    mock::ledc() = mock::Ledc();
+    buzzer = new BuzzerService();
+    buzzer->begin(LEDC_LOW_SPEED_MODE, LEDC_TIMER_0, LEDC_CHANNEL_0, 12);
+}
+
+void tearDown() {
+    delete buzzer;
+}
+
+static void test_steps_play_for_their_length() {
+    // chime: 1047 Hz 80 ms, 1319 Hz 80 ms, 1568 Hz 160 ms at duty 200
+    playAt(1000, MELODY_CHIME, BUZZER_PRIO_FRAME);
+    runBuzzer();
+    TEST_ASSERT_EQUAL(4, mock::ledc().events.size());
+    assertEvent(0, 1000, 1047);
+    assertEvent(1, 1080, 1319);
+    assertEvent(2, 1160, 1568);
+    assertEvent(3, 1320, 0);
+    TEST_ASSERT_EQUAL_UINT32(HALF_DUTY, mock::ledc().events[0].duty);
+    TEST_ASSERT_EQUAL_UINT32((HALF_DUTY * 200 + 127) / 255, mock::ledc().events[2].duty);
+    TEST_ASSERT_EQUAL_UINT32(0, counter("lagMs"));
+    TEST_ASSERT_EQUAL_UINT32(0, counter("overrunMs"));
+}
+
+static void test_rest_steps_are_silent() {
+    // alert: 2000 Hz 100 ms, rest 60 ms, x3
+    playAt(1000, MELODY_ALERT, BUZZER_PRIO_ALERT);
+    runBuzzer();
+    assertEvent(0, 1000, 2000);
+    assertEvent(1, 1100, 0);
+    assertEvent(2, 1160, 2000);
+    assertEvent(3, 1260, 0);
+    assertEvent(4, 1320, 2000);
+    assertEvent(5, 1420, 0);
+}
+
+static void test_higher_priority_preempts() {
+    playAt(1000, MELODY_CHIME, BUZZER_PRIO_FRAME);
+    playAt(1100, MELODY_NEGATIVE, BUZZER_PRIO_ALERT);
+    runBuzzer();
+    // Chime cut off 20 ms into its second step, negative right after
+    assertEvent(0, 1000, 1047);
+    assertEvent(1, 1080, 1319);
+    assertEvent(2, 1100, 0);
+    assertEvent(3, 1100, 1400);
+    assertEvent(4, 1125, 600);
+    assertEvent(5, 1175, 0);
+    TEST_ASSERT_EQUAL(6, mock::ledc().events.size());
+    TEST_ASSERT_EQUAL_UINT32(1, counter("preempted"));
+    TEST_ASSERT_EQUAL_UINT32(2, counter("commands"));
+    TEST_ASSERT_EQUAL_UINT32(0, counter("dropped"));
+}
+
+static void test_equal_priority_waits_latest_wins() {
+    playAt(1000, MELODY_CHIME, BUZZER_PRIO_FRAME);
+    playAt(1010, MELODY_POSITIVE, BUZZER_PRIO_FRAME);
+    playAt(1020, MELODY_NEGATIVE, BUZZER_PRIO_FRAME);
+    runBuzzer();
+    // Chime plays out; negative replaced positive as the one waiting
+    assertEvent(2, 1160, 1568);
+    assertEvent(3, 1320, 0);
+    assertEvent(4, 1320, 1400);
+    assertEvent(5, 1345, 600);
+    assertEvent(6, 1395, 0);
+    TEST_ASSERT_EQUAL(7, mock::ledc().events.size());
+    TEST_ASSERT_EQUAL_UINT32(0, counter("preempted"));
+    TEST_ASSERT_EQUAL_UINT32(1, counter("dropped"));
+    TEST_ASSERT_EQUAL_UINT32(300, counter("lagMs"));    // negative: sent at 1020, first tone at 1320
+}
+
+static void test_lower_priority_is_dropped() {
+    playAt(1000, MELODY_CHIME, BUZZER_PRIO_FEEDBACK);
+    playAt(1050, MELODY_POSITIVE, BUZZER_PRIO_FRAME);
+    runBuzzer();
+    TEST_ASSERT_EQUAL(4, mock::ledc().events.size());
+    assertEvent(3, 1320, 0);
+    TEST_ASSERT_EQUAL_UINT32(1, counter("dropped"));
+    TEST_ASSERT_EQUAL_UINT32(0, counter("preempted"));
+}
+
+static void test_idle_buzzer_plays_any_priority() {
+    playAt(1000, MELODY_POSITIVE, BUZZER_PRIO_ALERT);
+    playAt(2000, MELODY_POSITIVE, BUZZER_PRIO_FRAME);
+    runBuzzer();
+    assertEvent(0, 1000, 600);
+    assertEvent(3, 2000, 600);
+    TEST_ASSERT_EQUAL_UINT32(0, counter("dropped"));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_steps_play_for_their_length);
+    RUN_TEST(test_rest_steps_are_silent);
+    RUN_TEST(test_higher_priority_preempts);
+    RUN_TEST(test_equal_priority_waits_latest_wins);
+    RUN_TEST(test_lower_priority_is_dropped);
+    RUN_TEST(test_idle_buzzer_plays_any_priority);
+    return UNITY_END();
+}
@@ -0,0 +1,79 @@
+// drawBitmap()'s two paths on the device: a full-screen frame blitted in
+// 8x8 blocks by blitRotated() vs pixel by pixel through the panel's
+// drawPixel() (setRotation(1)), from a frame in PSRAM as the frame cache
+// holds them. Both must give the same buffer; prints µs and CPU cycles of
+// each.
+//
+//   pio test -e esp32api -f test_embedded_blit -v
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "utility/BitBlit.h"
+#include "utility/FrameFormat.h"
+
+static const int16_t NATIVE_W = 168;
+static const int16_t NATIVE_H = 384;
+static const size_t BUFFER_SIZE = NATIVE_W / 8 * NATIVE_H;
+
+static uint8_t* frame;
+static uint8_t pixelBuffer[BUFFER_SIZE];
+static uint8_t blitBuffer[BUFFER_SIZE];
+
+// DisplayPanel::drawPixel() under setRotation(1), black pixels only
+static void drawPixels(uint8_t* buffer, const uint8_t* bitmap) {
+    for (int16_t y = 0; y < NATIVE_W; y++) {
+        for (int16_t x = 0; x < NATIVE_H; x++) {
+            if ((bitmap[(y * NATIVE_H + x) / 8] >> (7 - x % 8)) & 1) continue;
+            int16_t nx = NATIVE_W - y - 1;
+            buffer[nx / 8 + x * (NATIVE_W / 8)] &= ~(0x80 >> (nx % 8));
+        }
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_blit_matches_pixels() {
+    memset(pixelBuffer, 0xFF, BUFFER_SIZE);
+    memset(blitBuffer, 0xFF, BUFFER_SIZE);
+    drawPixels(pixelBuffer, frame);
+    TEST_ASSERT_TRUE(blitRotated(blitBuffer, NATIVE_W, NATIVE_H, 0, 0, frame, NATIVE_H, NATIVE_W, false, false));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(pixelBuffer, blitBuffer, BUFFER_SIZE);
+}
+
+static void test_blit_time() {
+    const int runs = 20;
+    uint32_t cycles = ESP.getCycleCount();
+    unsigned long start = micros();
+    for (int r = 0; r < runs; r++) drawPixels(pixelBuffer, frame);
+    unsigned long pixelUs = micros() - start;
+    uint32_t pixelCycles = ESP.getCycleCount() - cycles;
+
+    cycles = ESP.getCycleCount();
+    start = micros();
+    for (int r = 0; r < runs; r++) blitRotated(blitBuffer, NATIVE_W, NATIVE_H, 0, 0, frame, NATIVE_H, NATIVE_W, false, false);
+    unsigned long blitUs = micros() - start;
+    uint32_t blitCycles = ESP.getCycleCount() - cycles;
+
+    char line[120];
+    snprintf(line, sizeof(line), "full frame at %u MHz: per pixel %lu us (%u cycles), blit %lu us (%u cycles)",
+             (unsigned)getCpuFrequencyMhz(), pixelUs / runs, (unsigned)(pixelCycles / runs), blitUs / runs,
+             (unsigned)(blitCycles / runs));
+    TEST_MESSAGE(line);
+}
+
+void setup() {
+    delay(2000);  // let the monitor attach
+    frame = (uint8_t*)ps_malloc(DISPLAY_FRAME_SIZE);
+    if (!frame) frame = (uint8_t*)malloc(DISPLAY_FRAME_SIZE);
+    // Mostly white with black runs, like a chart
+    for (size_t i = 0; i < DISPLAY_FRAME_SIZE; i++) frame[i] = (i * 2654435761u) >> 29 ? 0xFF : (i * 40503u) >> 8;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_blit_matches_pixels);
+    RUN_TEST(test_blit_time);
+    UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,174 @@
+// Frame hashing on the device: Sha256 (mbedtls on the ESP32's SHA engine)
+// against a plain software SHA-256. Both must agree; prints the throughput
+// of each over a frame-sized buffer, which is what the hash check adds to
+// every frame download.
+//
+//   pio test -e esp32api -f test_embedded_sha -v
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "utility/FrameFormat.h"
+#include "utility/Sha256.h"
+
+// FIPS 180-4, one 64-byte block at a time, no tables beyond K
+class SoftSha256 {
+public:
+    void begin() {
+        static const uint32_t H0[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                       0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        memcpy(_h, H0, sizeof(_h));
+        _len = 0;
+        _fill = 0;
+    }
+
+    void update(const uint8_t* data, size_t len) {
+        _len += len;
+        while (len > 0) {
+            size_t n = 64 - _fill < len ? 64 - _fill : len;
+            memcpy(_block + _fill, data, n);
+            _fill += n;
+            data += n;
+            len -= n;
+            if (_fill == 64) {
+                compress();
+                _fill = 0;
+            }
+        }
+    }
+
+    void finish(uint8_t digest[32]) {
+        uint64_t bits = _len * 8;
+        uint8_t pad = 0x80;
+        update(&pad, 1);
+        pad = 0;
+        while (_fill != 56) update(&pad, 1);
+        uint8_t length[8];
+        for (int i = 0; i < 8; i++) length[i] = bits >> (56 - 8 * i);
+        update(length, 8);
+        for (int i = 0; i < 8; i++) {
+            for (int b = 0; b < 4; b++) digest[i * 4 + b] = _h[i] >> (24 - 8 * b);
+        }
+    }
+
+private:
+    uint32_t _h[8];
+    uint8_t _block[64];
+    size_t _fill;
+    uint64_t _len;
+
+    static uint32_t ror(uint32_t x, int n) { return x >> n | x << (32 - n); }
+
+    void compress() {
+        static const uint32_t K[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+        uint32_t w[64];
+        for (int i = 0; i < 16; i++) {
+            w[i] = (uint32_t)_block[4 * i] << 24 | (uint32_t)_block[4 * i + 1] << 16 |
+                   (uint32_t)_block[4 * i + 2] << 8 | _block[4 * i + 3];
+        }
+        for (int i = 16; i < 64; i++) {
+            uint32_t s0 = ror(w[i - 15], 7) ^ ror(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = ror(w[i - 2], 17) ^ ror(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = _h[0], b = _h[1], c = _h[2], d = _h[3], e = _h[4], f = _h[5], g = _h[6], h = _h[7];
+        for (int i = 0; i < 64; i++) {
+            uint32_t t1 = h + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+            uint32_t t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        _h[0] += a; _h[1] += b; _h[2] += c; _h[3] += d;
+        _h[4] += e; _h[5] += f; _h[6] += g; _h[7] += h;
+    }
+};
+
+static uint8_t* frame;
+
+void setUp() {}
+void tearDown() {}
+
+static void test_known_answer() {
+    // sha256("abc")
+    static const char* const ABC = "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad";
+    Sha256 hw;
+    hw.begin();
+    hw.update((const uint8_t*)"abc", 3);
+    TEST_ASSERT_TRUE(hw.finishMatches(ABC));
+    SoftSha256 sw;
+    uint8_t digest[32];
+    sw.begin();
+    sw.update((const uint8_t*)"abc", 3);
+    sw.finish(digest);
+    TEST_ASSERT_TRUE(Sha256::hexEquals(digest, ABC));
+}
+
+// Fed in 1460-byte pieces, as a frame arrives off the socket
+static void test_engine_matches_software() {
+    uint8_t hwDigest[32], swDigest[32];
+    Sha256 hw;
+    SoftSha256 sw;
+    hw.begin();
+    sw.begin();
+    for (size_t at = 0; at < DISPLAY_FRAME_MAX_SIZE; at += 1460) {
+        size_t n = DISPLAY_FRAME_MAX_SIZE - at < 1460 ? DISPLAY_FRAME_MAX_SIZE - at : 1460;
+        hw.update(frame + at, n);
+        sw.update(frame + at, n);
+    }
+    hw.finish(hwDigest);
+    sw.finish(swDigest);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(swDigest, hwDigest, 32);
+}
+
+static void test_throughput() {
+    const int runs = 20;
+    uint8_t digest[32];
+
+    Sha256 hw;
+    unsigned long start = micros();
+    for (int r = 0; r < runs; r++) {
+        hw.begin();
+        hw.update(frame, DISPLAY_FRAME_MAX_SIZE);
+        hw.finish(digest);
+    }
+    unsigned long hwUs = micros() - start;
+
+    SoftSha256 sw;
+    start = micros();
+    for (int r = 0; r < runs; r++) {
+        sw.begin();
+        sw.update(frame, DISPLAY_FRAME_MAX_SIZE);
+        sw.finish(digest);
+    }
+    unsigned long swUs = micros() - start;
+
+    uint32_t bytes = runs * DISPLAY_FRAME_MAX_SIZE;
+    char line[120];
+    snprintf(line, sizeof(line), "sha256 over %u bytes at %u MHz: engine %lu us (%.2f MB/s), software %lu us (%.2f MB/s)",
+             (unsigned)DISPLAY_FRAME_MAX_SIZE, (unsigned)getCpuFrequencyMhz(), hwUs / runs, (float)bytes / hwUs,
+             swUs / runs, (float)bytes / swUs);
+    TEST_MESSAGE(line);
+}
+
+void setup() {
+    delay(2000);  // let the monitor attach
+    frame = (uint8_t*)ps_malloc(DISPLAY_FRAME_MAX_SIZE);
+    if (!frame) frame = (uint8_t*)malloc(DISPLAY_FRAME_MAX_SIZE);
+    for (size_t i = 0; i < DISPLAY_FRAME_MAX_SIZE; i++) frame[i] = (i * 2654435761u) >> 24;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_known_answer);
+    RUN_TEST(test_engine_matches_software);
+    RUN_TEST(test_throughput);
+    UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,126 @@
+// Frame codecs end to end: blobs encoded by the server (node-api
+// src/utils/codecs.ts) must decode bit-exact through the streaming
+// decoders, however the transport splits them; an XOR patch applied to its
+// base must give the updated frame. Prints compression ratio and decode
+// throughput.
+//
+// The vectors are real frames built from firmware/symbol_previews; after
+// changing an encoder, regenerate them from node-api:
+//
+//   npx tsx scripts/codec-bench.ts --vectors ../firmware/test/test_frame_codec/vectors
+//   pio test -e native -f test_frame_codec -v
+
+#include <unity.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "FrameCodec.h"
+#include "FrameFormat.h"
+
+static const char* const FRAMES[] = {"bitcoin", "dollar", "eth", "euro", "pound", "ruble", "yuan"};
+static const size_t FRAME_COUNT = sizeof(FRAMES) / sizeof(FRAMES[0]);
+
+static std::vector<uint8_t> readVector(const char* name, const char* ext) {
+    std::string path(__FILE__);
+    path = path.substr(0, path.find_last_of("/\\") + 1) + "vectors/" + name + "." + ext;
+    std::vector<uint8_t> data;
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return data;
+    int c;
+    while ((c = fgetc(f)) != EOF) data.push_back((uint8_t)c);
+    fclose(f);
+    return data;
+}
+
+// Feed `blob` in `chunk`-byte writes, as the HTTP stream would. An XOR
+// patch applies to the frame already in `out`, so its capacity is the
+// frame's size, as ApiClient passes the base's length.
+static bool decode(FrameCodecId codec, const std::vector<uint8_t>& blob, size_t chunk, uint8_t* out) {
+    FrameDecoderSet decoders;
+    FrameDecoder* d = decoders.select(codec, out, codec == CODEC_XOR ? DISPLAY_FRAME_SIZE : DISPLAY_FRAME_MAX_SIZE);
+    for (size_t at = 0; at < blob.size(); at += chunk) {
+        size_t n = blob.size() - at < chunk ? blob.size() - at : chunk;
+        if (d->write(blob.data() + at, n) != n) return false;
+    }
+    return d->finish() && !d->overflow() && !d->invalid() && d->length() == DISPLAY_FRAME_SIZE;
+}
+
+static void roundTrip(FrameCodecId codec) {
+    static const size_t CHUNKS[] = {1, 7, 64, 1460, 65536};
+    static uint8_t out[DISPLAY_FRAME_MAX_SIZE];
+    for (size_t i = 0; i < FRAME_COUNT; i++) {
+        std::vector<uint8_t> raw = readVector(FRAMES[i], "raw");
+        std::vector<uint8_t> blob = readVector(FRAMES[i], FRAME_CODEC_NAMES[codec]);
+        TEST_ASSERT_EQUAL_MESSAGE(DISPLAY_FRAME_SIZE, raw.size(), FRAMES[i]);
+        TEST_ASSERT_TRUE_MESSAGE(!blob.empty(), FRAMES[i]);
+        for (size_t chunk : CHUNKS) {
+            memset(out, 0x55, sizeof(out));
+            TEST_ASSERT_TRUE_MESSAGE(decode(codec, blob, chunk, out), FRAMES[i]);
+            TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(raw.data(), out, DISPLAY_FRAME_SIZE, FRAMES[i]);
+        }
+    }
+}
+
+static void benchmark(FrameCodecId codec) {
+    static uint8_t out[DISPLAY_FRAME_MAX_SIZE];
+    std::vector<std::vector<uint8_t>> blobs;
+    size_t encoded = 0;
+    for (size_t i = 0; i < FRAME_COUNT; i++) {
+        blobs.push_back(readVector(FRAMES[i], FRAME_CODEC_NAMES[codec]));
+        encoded += blobs.back().size();
+    }
+    const int runs = 200;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < runs; r++) {
+        for (const auto& blob : blobs) decode(codec, blob, 1460, out);
+    }
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%-4s ratio %.1f:1, decode %.0f MB/s\n", FRAME_CODEC_NAMES[codec],
+           (double)FRAME_COUNT * DISPLAY_FRAME_SIZE / encoded, runs * FRAME_COUNT * DISPLAY_FRAME_SIZE / s / 1e6);
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_rle_round_trip() { roundTrip(CODEC_RLE); }
+static void test_lzss_round_trip() { roundTrip(CODEC_LZSS); }
+
+static void test_xor_patch_round_trip() {
+    static const size_t CHUNKS[] = {1, 3, 1460};
+    static uint8_t out[DISPLAY_FRAME_MAX_SIZE];
+    for (size_t i = 0; i < FRAME_COUNT; i++) {
+        std::vector<uint8_t> base = readVector(FRAMES[i], "raw");
+        std::vector<uint8_t> next = readVector(FRAMES[i], "next.raw");
+        std::vector<uint8_t> patch = readVector(FRAMES[i], "xor");
+        TEST_ASSERT_EQUAL_MESSAGE(DISPLAY_FRAME_SIZE, next.size(), FRAMES[i]);
+        TEST_ASSERT_LESS_THAN(DISPLAY_FRAME_SIZE / 8, patch.size());
+        for (size_t chunk : CHUNKS) {
+            memcpy(out, base.data(), DISPLAY_FRAME_SIZE);
+            TEST_ASSERT_TRUE_MESSAGE(decode(CODEC_XOR, patch, chunk, out), FRAMES[i]);
+            TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(next.data(), out, DISPLAY_FRAME_SIZE, FRAMES[i]);
+        }
+    }
+}
+
+static void test_truncated_blob_is_not_clean() {
+    static uint8_t out[DISPLAY_FRAME_MAX_SIZE];
+    std::vector<uint8_t> blob = readVector(FRAMES[0], "lzss");
+    blob.resize(blob.size() / 2);
+    TEST_ASSERT_FALSE(decode(CODEC_LZSS, blob, 1460, out));
+}
+
+static void test_decode_throughput() {
+    benchmark(CODEC_RLE);
+    benchmark(CODEC_LZSS);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_rle_round_trip);
+    RUN_TEST(test_lzss_round_trip);
+    RUN_TEST(test_xor_patch_round_trip);
+    RUN_TEST(test_truncated_blob_is_not_clean);
+    RUN_TEST(test_decode_throughput);
+    return UNITY_END();
+}
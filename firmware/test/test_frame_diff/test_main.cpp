@@ -0,0 +1,152 @@
+// frameDiff() on full-screen frames: nothing changed leaves the box alone,
+// a single pixel is found at every byte edge of a 32-bit word and at the
+// edges of the screen, the box spans changes far apart and is widened to
+// whole bytes, and random changes match a pixel-by-pixel count and box.
+//
+//   pio test -e native -f test_frame_diff -v
+
+#include <unity.h>
+
+#include "FrameDiff.h"
+#include "FrameFormat.h"
+
+static const int W = 384;
+static const int H = 168;
+
+static uint8_t before[DISPLAY_FRAME_SIZE];
+static uint8_t after[DISPLAY_FRAME_SIZE];
+
+static uint32_t lcg;
+static uint32_t next() {
+    lcg = lcg * 1664525 + 1013904223;
+    return lcg >> 8;
+}
+
+static void flip(int x, int y) {
+    after[y * (W / 8) + x / 8] ^= 0x80 >> (x % 8);
+}
+
+static void assertBox(int x, int y, int w, int h, const FrameRect& box) {
+    TEST_ASSERT_EQUAL(x, box.x);
+    TEST_ASSERT_EQUAL(y, box.y);
+    TEST_ASSERT_EQUAL(w, box.w);
+    TEST_ASSERT_EQUAL(h, box.h);
+}
+
+void setUp() {
+    lcg = 12345;
+    for (size_t i = 0; i < DISPLAY_FRAME_SIZE; i++) before[i] = after[i] = next();
+}
+
+void tearDown() {}
+
+static void test_identical_frames() {
+    FrameRect box = {-1, -2, -3, -4};
+    TEST_ASSERT_EQUAL_UINT32(0, frameDiff(before, after, W, H, box));
+    assertBox(-1, -2, -3, -4, box);
+}
+
+static void test_single_pixel_at_each_byte_edge() {
+    // First, a middle and the last word of a row; both ends of each byte
+    const int words[] = {0, 5, W / 32 - 1};
+    for (int word : words) {
+        for (int k = 0; k < 4; k++) {
+            for (int bit = 0; bit < 8; bit += 7) {
+                int x = word * 32 + k * 8 + bit;
+                memcpy(after, before, DISPLAY_FRAME_SIZE);
+                flip(x, 77);
+                FrameRect box = {};
+                TEST_ASSERT_EQUAL_UINT32(1, frameDiff(before, after, W, H, box));
+                assertBox(x - bit, 77, 8, 1, box);
+            }
+        }
+    }
+}
+
+static void test_box_spans_far_apart_changes() {
+    flip(5, 3);
+    flip(370, 150);
+    FrameRect box = {};
+    TEST_ASSERT_EQUAL_UINT32(2, frameDiff(before, after, W, H, box));
+    assertBox(0, 3, 376, 148, box);
+}
+
+static void test_screen_edges() {
+    struct { int x, y, boxX; } cases[] = {
+        {0, 0, 0},                  // top left
+        {W - 1, 0, W - 8},          // top right
+        {0, H - 1, 0},              // bottom left
+        {W - 1, H - 1, W - 8},      // bottom right
+    };
+    for (auto c : cases) {
+        memcpy(after, before, DISPLAY_FRAME_SIZE);
+        flip(c.x, c.y);
+        FrameRect box = {};
+        TEST_ASSERT_EQUAL_UINT32(1, frameDiff(before, after, W, H, box));
+        assertBox(c.boxX, c.y, 8, 1, box);
+    }
+
+    // Opposite corners: the whole screen
+    memcpy(after, before, DISPLAY_FRAME_SIZE);
+    flip(0, 0);
+    flip(W - 1, H - 1);
+    FrameRect box = {};
+    TEST_ASSERT_EQUAL_UINT32(2, frameDiff(before, after, W, H, box));
+    assertBox(0, 0, W, H, box);
+}
+
+static void test_box_widens_to_whole_bytes() {
+    // Three pixels inside one byte
+    for (int x = 10; x <= 12; x++) flip(x, 40);
+    FrameRect box = {};
+    TEST_ASSERT_EQUAL_UINT32(3, frameDiff(before, after, W, H, box));
+    assertBox(8, 40, 8, 1, box);
+
+    // Two neighbours across a byte boundary: both bytes
+    memcpy(after, before, DISPLAY_FRAME_SIZE);
+    flip(15, 40);
+    flip(16, 41);
+    TEST_ASSERT_EQUAL_UINT32(2, frameDiff(before, after, W, H, box));
+    assertBox(8, 40, 16, 2, box);
+}
+
+// Pixel by pixel, as the panel would see it
+static void test_random_changes_match_per_pixel() {
+    for (int run = 0; run < 50; run++) {
+        memcpy(after, before, DISPLAY_FRAME_SIZE);
+        int flips = 1 + next() % 40;
+        for (int i = 0; i < flips; i++) flip(next() % W, next() % H);
+
+        uint32_t count = 0;
+        int left = W, right = -1, top = H, bottom = -1;
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                uint8_t bit = 0x80 >> (x % 8);
+                size_t i = y * (W / 8) + x / 8;
+                if ((before[i] & bit) == (after[i] & bit)) continue;
+                count++;
+                if (x < left) left = x;
+                if (x > right) right = x;
+                if (y < top) top = y;
+                if (y > bottom) bottom = y;
+            }
+        }
+
+        FrameRect box = {-1, -1, -1, -1};
+        TEST_ASSERT_EQUAL_UINT32(count, frameDiff(before, after, W, H, box));
+        // The same pixel flipped twice is no change at all
+        if (count == 0) continue;
+        assertBox(left / 8 * 8, top, (right / 8 - left / 8 + 1) * 8, bottom - top + 1, box);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_identical_frames);
+    RUN_TEST(test_single_pixel_at_each_byte_edge);
+    RUN_TEST(test_box_spans_far_apart_changes);
+    RUN_TEST(test_screen_edges);
+    RUN_TEST(test_box_widens_to_whole_bytes);
+    RUN_TEST(test_random_changes_match_per_pixel);
+    return UNITY_END();
+}
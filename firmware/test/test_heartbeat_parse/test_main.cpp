@@ -0,0 +1,207 @@
+// Heartbeat response parsing: the streaming path (JsonStreamParser feeding
+// Base64StreamDecoder straight into the frame buffers) against the old one
+// (whole body in a String, deserializeJson, then base64 decode). Both must
+// yield the same frames; the streaming path must need less working memory.
+// Prints peak working memory and parse time of each.
+//
+//   pio test -e native -f test_heartbeat_parse -v
+
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "FrameFormat.h"
+#include "JsonStream.h"
+
+static const int FRAMES = 8;
+static const size_t CHUNK = 1460;   // one TCP segment per write, as from HTTPClient
+
+static std::string body;
+static std::vector<std::vector<uint8_t>> expected;
+
+static const char B64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static std::string base64(const std::vector<uint8_t>& in) {
+    std::string out;
+    for (size_t i = 0; i < in.size(); i += 3) {
+        uint32_t q = in[i] << 16 | (i + 1 < in.size() ? in[i + 1] << 8 : 0) | (i + 2 < in.size() ? in[i + 2] : 0);
+        out += B64[q >> 18 & 63];
+        out += B64[q >> 12 & 63];
+        out += i + 1 < in.size() ? B64[q >> 6 & 63] : '=';
+        out += i + 2 < in.size() ? B64[q & 63] : '=';
+    }
+    return out;
+}
+
+// Response shaped like the server's: scalars, then frames with inline bitmaps
+static void buildBody() {
+    uint32_t seed = 0x2545F491;
+    body = "{\"autoUpdate\":false,\"demoMode\":false,\"latestFirmwareVersion\":42,"
+           "\"refreshInterval\":300,\"displayHash\":\"9f2c1ab0\",\"frames\":[";
+    for (int i = 0; i < FRAMES; i++) {
+        std::vector<uint8_t> bitmap(DISPLAY_FRAME_SIZE, 0xFF);
+        for (size_t b = 0; b < bitmap.size(); b++) {
+            seed = seed * 1664525 + 1013904223;
+            if ((b / 48) % 7 == (size_t)i % 7) bitmap[b] = seed >> 24;   // a few busy rows per frame
+        }
+        expected.push_back(bitmap);
+        if (i) body += ",";
+        body += "{\"bitmap\":\"" + base64(bitmap) + "\",\"durationSec\":" + std::to_string(10 + i) +
+                ",\"ledColor\":\"green\",\"ledBrightness\":\"mid\",\"beep\":false,\"flashCount\":0}";
+    }
+    body += "]}";
+}
+
+// ---- Old path ----
+
+// Tracks the document's heap: live bytes and their peak
+class CountingAllocator : public ArduinoJson::Allocator {
+public:
+    size_t live = 0;
+    size_t peak = 0;
+
+    void* allocate(size_t size) override {
+        size_t* p = (size_t*)malloc(sizeof(size_t) + size);
+        if (!p) return nullptr;
+        *p = size;
+        grow(size);
+        return p + 1;
+    }
+
+    void deallocate(void* ptr) override {
+        if (!ptr) return;
+        size_t* p = (size_t*)ptr - 1;
+        live -= *p;
+        free(p);
+    }
+
+    void* reallocate(void* ptr, size_t size) override {
+        if (!ptr) return allocate(size);
+        size_t* p = (size_t*)ptr - 1;
+        size_t old = *p;
+        p = (size_t*)realloc(p, sizeof(size_t) + size);
+        if (!p) return nullptr;
+        *p = size;
+        live -= old;
+        grow(size);
+        return p + 1;
+    }
+
+private:
+    void grow(size_t size) {
+        live += size;
+        if (live > peak) peak = live;
+    }
+};
+
+static size_t oldPeak;
+
+static void parseOld(std::vector<std::vector<uint8_t>>& frames) {
+    // http.getString(): the whole body in one allocation
+    std::string response(body);
+    CountingAllocator alloc;
+    {
+        JsonDocument doc(&alloc);
+        TEST_ASSERT_TRUE(deserializeJson(doc, response.data(), response.size()) == DeserializationError::Ok);
+        JsonArray array = doc["frames"].as<JsonArray>();
+        for (JsonObject frame : array) {
+            std::vector<uint8_t> bitmap(DISPLAY_FRAME_SIZE);
+            Base64StreamDecoder decoder;
+            decoder.begin(bitmap.data(), bitmap.size());
+            const char* b64 = frame["bitmap"].as<const char*>();
+            decoder.write((const uint8_t*)b64, strlen(b64));
+            TEST_ASSERT_EQUAL(DISPLAY_FRAME_SIZE, decoder.finish());
+            frames.push_back(bitmap);
+        }
+    }
+    oldPeak = response.capacity() + alloc.peak;
+}
+
+// ---- Streaming path ----
+
+class FrameHandler : public JsonStreamHandler {
+public:
+    std::vector<std::vector<uint8_t>>& frames;
+    Base64StreamDecoder decoder;
+
+    FrameHandler(std::vector<std::vector<uint8_t>>& frames) : frames(frames) {}
+
+    void onScalar(const JsonStreamPath& path, const char* value, bool isString) override {}
+
+    Print* onStringBegin(const JsonStreamPath& path) override {
+        if (path.depth != 3 || !path.isKey(0, "frames") || !path.isKey(2, "bitmap")) return nullptr;
+        frames.emplace_back(DISPLAY_FRAME_SIZE);
+        decoder.begin(frames.back().data(), DISPLAY_FRAME_SIZE);
+        return &decoder;
+    }
+
+    void onStringEnd(const JsonStreamPath& path) override {
+        if (path.depth == 3 && path.isKey(2, "bitmap")) TEST_ASSERT_EQUAL(DISPLAY_FRAME_SIZE, decoder.finish());
+    }
+};
+
+static size_t newPeak;
+
+static void parseStreaming(std::vector<std::vector<uint8_t>>& frames) {
+    // writeToStream() reads into a fixed buffer and writes it to the parser
+    FrameHandler handler(frames);
+    JsonStreamParser parser(handler);
+    for (size_t at = 0; at < body.size(); at += CHUNK) {
+        size_t n = body.size() - at < CHUNK ? body.size() - at : CHUNK;
+        TEST_ASSERT_EQUAL(n, parser.write((const uint8_t*)body.data() + at, n));
+    }
+    newPeak = CHUNK + sizeof(parser) + sizeof(handler);
+}
+
+template <typename F>
+static double timeUs(F parse, int runs) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; i++) {
+        std::vector<std::vector<uint8_t>> frames;
+        parse(frames);
+    }
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / runs;
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_streaming_matches_document() {
+    std::vector<std::vector<uint8_t>> before, after;
+    parseOld(before);
+    parseStreaming(after);
+    TEST_ASSERT_EQUAL(FRAMES, before.size());
+    TEST_ASSERT_EQUAL(FRAMES, after.size());
+    for (int i = 0; i < FRAMES; i++) {
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(expected[i].data(), before[i].data(), DISPLAY_FRAME_SIZE);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(expected[i].data(), after[i].data(), DISPLAY_FRAME_SIZE);
+    }
+}
+
+static void test_streaming_needs_less_memory() {
+    std::vector<std::vector<uint8_t>> frames;
+    parseOld(frames);
+    frames.clear();
+    parseStreaming(frames);
+    printf("body %zu bytes, %d frames\n", body.size(), FRAMES);
+    printf("peak working memory: document %zu bytes, streaming %zu bytes\n", oldPeak, newPeak);
+    TEST_ASSERT_LESS_THAN(oldPeak / 10, newPeak);
+}
+
+static void test_parse_time() {
+    const int runs = 20;
+    double before = timeUs(parseOld, runs);
+    double after = timeUs(parseStreaming, runs);
+    printf("parse time: document %.0f us, streaming %.0f us\n", before, after);
+}
+
+int main(int argc, char** argv) {
+    buildBody();
+    UNITY_BEGIN();
+    RUN_TEST(test_streaming_matches_document);
+    RUN_TEST(test_streaming_needs_less_memory);
+    RUN_TEST(test_parse_time);
+    return UNITY_END();
+}
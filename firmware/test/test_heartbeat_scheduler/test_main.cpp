@@ -0,0 +1,251 @@
+// HeartbeatScheduler on a fake clock: jitter bounds, exponential backoff
+// and its cap, the circuit breaker and its half-open probe, and the server's
+// nextPollSec / Retry-After hints. The clock starts just short of the
+// 32-bit wrap, as millis() does after 49.7 days.
+//
+//   pio test -e native -f test_heartbeat_scheduler -v
+
+#include <unity.h>
+
+#include "HeartbeatScheduler.h"
+
+static uint32_t now;
+static uint32_t fakeClock() { return now; }
+
+// Random source: lowest value, highest value, or a fixed pseudo-random walk
+enum RandomMode { RANDOM_MIN, RANDOM_MAX, RANDOM_LCG };
+static RandomMode randomMode;
+static uint32_t lcg;
+static uint32_t fakeRandom(uint32_t bound) {
+    if (randomMode == RANDOM_MIN) return 0;
+    if (randomMode == RANDOM_MAX) return bound - 1;
+    lcg = lcg * 1664525 + 1013904223;
+    return (uint32_t)(((uint64_t)lcg * bound) >> 32);
+}
+
+static HeartbeatSchedulerConfig config;
+
+// Go to the next heartbeat; returns how long that was
+static uint32_t waitForDue(HeartbeatScheduler& s) {
+    uint32_t wait = s.msUntilDue();
+    if (wait > 0) {
+        now += wait - 1;
+        TEST_ASSERT_FALSE(s.due());
+        now += 1;
+    }
+    TEST_ASSERT_TRUE(s.due());
+    return wait;
+}
+
+void setUp() {
+    now = 0xFFFFFFFFu - 30000;
+    randomMode = RANDOM_LCG;
+    lcg = 12345;
+    config = HeartbeatSchedulerConfig();
+}
+
+void tearDown() {}
+
+static void test_first_heartbeat_is_due_at_once() {
+    HeartbeatScheduler s(fakeClock, fakeRandom, config);
+    TEST_ASSERT_TRUE(s.due());
+    TEST_ASSERT_EQUAL(0, s.msUntilDue());
+}
+
+static void test_interval_jitter_bounds() {
+    HeartbeatScheduler s(fakeClock, fakeRandom, config);
+    s.setInterval(300000);
+    randomMode = RANDOM_MIN;
+    s.onSuccess();
+    TEST_ASSERT_EQUAL(270000, s.msUntilDue());
+    randomMode = RANDOM_MAX;
+    s.onSuccess();
+    TEST_ASSERT_EQUAL(330000, s.msUntilDue());
+
+    // Spread over the whole +/-10% range, never outside it
+    randomMode = RANDOM_LCG;
+    uint32_t lo = UINT32_MAX, hi = 0;
+    for (int i = 0; i < 1000; i++) {
+        uint32_t wait = waitForDue(s);
+        if (i > 0) {
+            if (wait < lo) lo = wait;
+            if (wait > hi) hi = wait;
+        }
+        s.onSuccess();
+    }
+    TEST_ASSERT_GREATER_OR_EQUAL(270000, lo);
+    TEST_ASSERT_LESS_OR_EQUAL(330000, hi);
+    TEST_ASSERT_LESS_THAN(275000, lo);
+    TEST_ASSERT_GREATER_THAN(325000, hi);
+}
+
+static void test_interval_has_a_floor() {
+    HeartbeatScheduler s(fakeClock, fakeRandom, config);
+    s.setInterval(1000);
+    TEST_ASSERT_EQUAL(5000, s.intervalMs());
+}
+
+static void test_backoff_doubles_with_equal_jitter() {
+    config.breakerThreshold = 100;  // keep the breaker out of the way
+    HeartbeatScheduler s(fakeClock, fakeRandom, config);
+    s.due();
+    uint32_t backoff = config.backoffBaseMs;
+    for (int i = 0; i < 6; i++) {
+        randomMode = (i & 1) ? RANDOM_MAX : RANDOM_MIN;
+        s.onFailure();
+        TEST_ASSERT_EQUAL(HeartbeatScheduler::SCHED_BACKOFF, s.state());
+        // Half fixed, half random: [backoff/2, backoff]
+        TEST_ASSERT_EQUAL((i & 1) ? backoff : backoff / 2, s.msUntilDue());
+        waitForDue(s);
+        backoff *= 2;
+    }
+}
+
+static void test_backoff_is_capped() {
+    config.breakerThreshold = 100;
+    HeartbeatScheduler s(fakeClock, fakeRandom, config);
+    randomMode = RANDOM_MAX;
+    for (int i = 0; i < 40; i++) {
+        s.due();
+        s.onFailure();
+        TEST_ASSERT_LESS_OR_EQUAL(config.backoffMaxMs, s.msUntilDue());
+        waitForDue(s);
+    }
+    s.onFailure();
+    TEST_ASSERT_EQUAL(config.backoffMaxMs, s.msUntilDue());
+}
+
+static void test_breaker_opens_after_threshold() {
+    HeartbeatScheduler s(fakeClock, fakeRandom, config);
+    for (int i = 1; i < 6; i++) {
+        waitForDue(s);
+        s.onFailure();
+        TEST_ASSERT_EQUAL(HeartbeatScheduler::SCHED_BACKOFF, s.state());
+    }
+    waitForDue(s);
+    s.onFailure();
+    TEST_ASSERT_EQUAL(HeartbeatScheduler::SCHED_OPEN, s.state());
+    TEST_ASSERT_EQUAL(6, s.failures());
+    TEST_ASSERT_EQUAL(1, s.breakerOpens());
+    TEST_ASSERT_UINT32_WITHIN(90000, 900000, s.msUntilDue());
+
+    // Pushes and expected changes don't get through an open breaker
+    uint32_t wait = s.msUntilDue();
+    s.triggerNow();
+    s.expectChangeIn(10000);
+    TEST_ASSERT_EQUAL(wait, s.msUntilDue());
+    TEST_ASSERT_FALSE(s.due());
+}
+
+static void openBreaker(HeartbeatScheduler& s) {
+    while (s.state() != HeartbeatScheduler::SCHED_OPEN) {
+        waitForDue(s);
+        s.onFailure();
+    }
+}
+
+static void test_half_open_probe_failure_reopens() {
+    HeartbeatScheduler s(fakeClock, fakeRandom, config);
+    openBreaker(s);
+    waitForDue(s);
+    TEST_ASSERT_EQUAL(HeartbeatScheduler::SCHED_HALF_OPEN, s.state());
+    s.onFailure();
+    TEST_ASSERT_EQUAL(HeartbeatScheduler::SCHED_OPEN, s.state());
+    TEST_ASSERT_EQUAL(2, s.breakerOpens());
+    TEST_ASSERT_UINT32_WITHIN(90000, 900000, s.msUntilDue());
+}
+
+static void test_half_open_probe_success_closes() {
+    HeartbeatScheduler s(fakeClock, fakeRandom, config);
+    openBreaker(s);
+    waitForDue(s);
+    s.onSuccess();
+    TEST_ASSERT_EQUAL(HeartbeatScheduler::SCHED_NORMAL, s.state());
+    TEST_ASSERT_EQUAL(0, s.failures());
+    TEST_ASSERT_UINT32_WITHIN(6000, 60000, s.msUntilDue());
+
+    // A later failure starts backing off from the base again
+    waitForDue(s);
+    randomMode = RANDOM_MAX;
+    s.onFailure();
+    TEST_ASSERT_EQUAL(HeartbeatScheduler::SCHED_BACKOFF, s.state());
+    TEST_ASSERT_EQUAL(config.backoffBaseMs, s.msUntilDue());
+}
+
+static void test_next_poll_hint() {
+    HeartbeatScheduler s(fakeClock, fakeRandom, config);
+    s.setInterval(300000);
+    randomMode = RANDOM_MIN;
+    s.onSuccess(30000);
+    TEST_ASSERT_EQUAL(27000, s.msUntilDue());
+    s.onSuccess(100);
+    TEST_ASSERT_EQUAL(4500, s.msUntilDue());    // floored to minIntervalMs, then jittered
+    s.onSuccess();
+    TEST_ASSERT_EQUAL(270000, s.msUntilDue());  // no hint: back to the interval
+}
+
+static void test_retry_after_is_a_lower_bound() {
+    HeartbeatScheduler s(fakeClock, fakeRandom, config);
+    s.due();
+    randomMode = RANDOM_MIN;
+    s.onFailure(120000);
+    TEST_ASSERT_EQUAL(120000, s.msUntilDue());
+    randomMode = RANDOM_MAX;
+    s.onFailure(120000);
+    TEST_ASSERT_EQUAL(132000, s.msUntilDue());  // spread by up to jitterPct past it
+
+    // Shorter than the backoff: the backoff wins
+    randomMode = RANDOM_MIN;
+    s.onFailure(1000);
+    TEST_ASSERT_EQUAL(10000, s.msUntilDue());
+}
+
+static void test_retry_after_extends_open_breaker() {
+    HeartbeatScheduler s(fakeClock, fakeRandom, config);
+    openBreaker(s);
+    waitForDue(s);
+    randomMode = RANDOM_MIN;
+    s.onFailure(3600000);
+    TEST_ASSERT_EQUAL(HeartbeatScheduler::SCHED_OPEN, s.state());
+    TEST_ASSERT_EQUAL(3600000, s.msUntilDue());
+}
+
+static void test_expect_change_moves_earlier_only() {
+    HeartbeatScheduler s(fakeClock, fakeRandom, config);
+    randomMode = RANDOM_MIN;
+    s.onSuccess();
+    TEST_ASSERT_EQUAL(54000, s.msUntilDue());
+    s.expectChangeIn(20000);
+    TEST_ASSERT_EQUAL(20000, s.msUntilDue());
+    s.expectChangeIn(40000);
+    TEST_ASSERT_EQUAL(20000, s.msUntilDue());
+    s.expectChangeIn(1000);
+    TEST_ASSERT_EQUAL(5000, s.msUntilDue());
+}
+
+static void test_reset_clears_backoff() {
+    HeartbeatScheduler s(fakeClock, fakeRandom, config);
+    openBreaker(s);
+    s.reset();
+    TEST_ASSERT_EQUAL(HeartbeatScheduler::SCHED_NORMAL, s.state());
+    TEST_ASSERT_EQUAL(0, s.failures());
+    TEST_ASSERT_TRUE(s.due());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_heartbeat_is_due_at_once);
+    RUN_TEST(test_interval_jitter_bounds);
+    RUN_TEST(test_interval_has_a_floor);
+    RUN_TEST(test_backoff_doubles_with_equal_jitter);
+    RUN_TEST(test_backoff_is_capped);
+    RUN_TEST(test_breaker_opens_after_threshold);
+    RUN_TEST(test_half_open_probe_failure_reopens);
+    RUN_TEST(test_half_open_probe_success_closes);
+    RUN_TEST(test_next_poll_hint);
+    RUN_TEST(test_retry_after_is_a_lower_bound);
+    RUN_TEST(test_retry_after_extends_open_breaker);
+    RUN_TEST(test_expect_change_moves_earlier_only);
+    RUN_TEST(test_reset_clears_backoff);
+    return UNITY_END();
+}
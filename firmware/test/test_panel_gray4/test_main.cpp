@@ -0,0 +1,121 @@
+// Mono vs 4-level gray on the panel: how long each kind of update takes and
+// what a gray4 frame costs in memory (heap, the stack it's converted on,
+// twice the bytes per frame in the frame cache and in flash). Needs the
+// panel connected; the numbers are printed, the test only checks that each
+// update is the kind asked for and that nothing is left allocated.
+//
+//   pio test -e esp32panel -f test_panel_gray4 -v
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "Display.h"
+#include "utility/FrameStore.h"
+
+static uint8_t* mono;
+static uint8_t* gray;
+
+// Free heap, lowest free stack so far on this task
+struct Footprint {
+    uint32_t heap;
+    uint32_t stack;
+};
+
+static Footprint footprint() {
+    return {ESP.getFreeHeap(), (uint32_t)uxTaskGetStackHighWaterMark(NULL)};
+}
+
+static void report(const char* what, uint32_t ms, const Footprint& before) {
+    Footprint after = footprint();
+    char line[120];
+    snprintf(line, sizeof(line), "%-8s %5u ms, heap %+d bytes, stack high water %u -> %u bytes",
+             what, (unsigned)ms, (int)(after.heap - before.heap), (unsigned)before.stack, (unsigned)after.stack);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_UINT32_WITHIN(64, before.heap, after.heap);
+}
+
+static RefreshType showMono(RefreshHint hint, const char* what) {
+    Footprint before = footprint();
+    unsigned long start = millis();
+    // As displayFrameFullScreen() does: a bitmap only draws its black pixels
+    display.clear();
+    display.drawBitmap(0, 0, mono, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    RefreshType type = display.refreshFrame(mono, 0, hint);
+    report(what, millis() - start, before);
+    return type;
+}
+
+static RefreshType showGray(const char* what) {
+    Footprint before = footprint();
+    unsigned long start = millis();
+    RefreshType type = display.refreshGray4(gray);
+    report(what, millis() - start, before);
+    return type;
+}
+
+// Left half black, right half white; `notch` blackens a 16x16 square
+// on the right to give a partial update something to do
+static void drawMono(bool notch) {
+    for (int16_t y = 0; y < DISPLAY_HEIGHT; y++) {
+        uint8_t* row = mono + y * (DISPLAY_WIDTH / 8);
+        memset(row, 0x00, DISPLAY_WIDTH / 16);
+        memset(row + DISPLAY_WIDTH / 16, 0xFF, DISPLAY_WIDTH / 16);
+        if (notch && y >= 80 && y < 96) memset(row + 40, 0x00, 2);
+    }
+}
+
+// Four bands, black to white, down the screen
+static void drawGray() {
+    for (int16_t y = 0; y < DISPLAY_HEIGHT; y++) {
+        uint8_t level = y * 4 / DISPLAY_HEIGHT;
+        memset(gray + y * (DISPLAY_WIDTH / 4), level * 0x55, DISPLAY_WIDTH / 4);
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_mono_updates() {
+    drawMono(false);
+    TEST_ASSERT_EQUAL(REFRESH_FULL, showMono(REFRESH_HINT_FULL, "full"));
+    drawMono(true);
+    TEST_ASSERT_EQUAL(REFRESH_PARTIAL, showMono(REFRESH_HINT_PARTIAL, "partial"));
+    drawMono(false);
+    TEST_ASSERT_EQUAL(REFRESH_FAST, showMono(REFRESH_HINT_FAST, "fast"));
+    TEST_ASSERT_EQUAL(REFRESH_SKIPPED, showMono(REFRESH_HINT_AUTO, "same"));
+}
+
+static void test_gray4_updates() {
+    drawGray();
+    TEST_ASSERT_EQUAL(REFRESH_GRAY4, showGray("gray4"));
+    TEST_ASSERT_EQUAL(REFRESH_SKIPPED, showGray("same"));
+
+    // Back to mono: the panel's previous image is gone, so a full refresh
+    drawMono(false);
+    TEST_ASSERT_EQUAL(REFRESH_FULL, showMono(REFRESH_HINT_AUTO, "mono"));
+}
+
+static void test_frame_memory() {
+    char line[120];
+    snprintf(line, sizeof(line), "frame: mono %u bytes, gray4 %u bytes; frame cache %u slots of %u bytes = %u bytes",
+             (unsigned)DISPLAY_FRAME_SIZE, (unsigned)DISPLAY_FRAME_GRAY4_SIZE, (unsigned)FRAME_STORE_SLOTS,
+             (unsigned)DISPLAY_FRAME_MAX_SIZE, (unsigned)(FRAME_STORE_SLOTS * DISPLAY_FRAME_MAX_SIZE));
+    TEST_MESSAGE(line);
+}
+
+void setup() {
+    delay(2000);  // let the monitor attach
+    mono = (uint8_t*)malloc(DISPLAY_FRAME_SIZE);
+    gray = (uint8_t*)malloc(DISPLAY_FRAME_GRAY4_SIZE);
+    display.begin();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_mono_updates);
+    RUN_TEST(test_gray4_updates);
+    RUN_TEST(test_frame_memory);
+    UNITY_END();
+
+    display.sleep();
+}
+
+void loop() {}
@@ -0,0 +1,134 @@
+// PlaylistStore on a mock LittleFS the size of the min_spiffs.csv partition:
+// playlists round-trip, a new one that doesn't fit next to the old one
+// replaces it, and one that can't fit at all (a full gray4 playlist) fails
+// without losing the playlist already stored.
+//
+//   pio test -e native -f test_playlist_store -v
+
+#include <unity.h>
+#include <vector>
+
+#include "PlaylistStore.h"
+
+static PlaylistStore* store;
+static std::vector<std::vector<uint8_t>> bitmaps;
+
+struct Playlist {
+    PlaylistStore::Header header;
+    PlaylistStore::Frame frames[PLAYLIST_STORE_MAX_FRAMES];
+    const uint8_t* bitmaps[PLAYLIST_STORE_MAX_FRAMES];
+};
+
+// `count` frames of `format` with bitmaps first, first + 1, ...; equal ids
+// are the same bitmap
+static Playlist playlist(uint8_t count, FrameFormat format, int first) {
+    Playlist p = {};
+    p.header.magic = PLAYLIST_STORE_MAGIC;
+    p.header.count = count;
+    p.header.refreshInterval = first;
+    for (uint8_t i = 0; i < count; i++) {
+        int id = first + i;
+        snprintf(p.frames[i].hash, sizeof(p.frames[i].hash), "%064d", id);
+        p.frames[i].format = format;
+        bitmaps.emplace_back(frameFormatSize(format), (uint8_t)id);
+        p.bitmaps[i] = bitmaps.back().data();
+    }
+    return p;
+}
+
+static bool save(const Playlist& p) { return store->save(p.header, p.frames, p.bitmaps); }
+
+// The stored playlist is `p`, bitmaps included
+static void assertStored(const Playlist& p) {
+    PlaylistStore::Header header;
+    PlaylistStore::Frame frames[PLAYLIST_STORE_MAX_FRAMES];
+    TEST_ASSERT_TRUE(store->load(header, frames));
+    TEST_ASSERT_EQUAL(p.header.count, header.count);
+    TEST_ASSERT_EQUAL_UINT32(p.header.refreshInterval, header.refreshInterval);
+    std::vector<uint8_t> bitmap(DISPLAY_FRAME_MAX_SIZE);
+    for (uint8_t i = 0; i < header.count; i++) {
+        size_t size = frameFormatSize(frames[i].format);
+        TEST_ASSERT_EQUAL_STRING(p.frames[i].hash, frames[i].hash);
+        TEST_ASSERT_TRUE(store->loadBitmap(frames[i].hash, bitmap.data(), size));
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(p.bitmaps[i], bitmap.data(), size);
+    }
+}
+
+void setUp() {
+    mock::flash() = mock::Flash();
+    bitmaps.clear();
+    bitmaps.reserve(64);
+    store = new PlaylistStore();
+    store->begin();
+}
+
+void tearDown() {
+    delete store;
+}
+
+static void test_mono_playlist_round_trips() {
+    Playlist p = playlist(PLAYLIST_STORE_MAX_FRAMES, FRAME_MONO, 1);
+    TEST_ASSERT_TRUE(save(p));
+    assertStored(p);
+    TEST_ASSERT_EQUAL_UINT32(1, store->saves());
+}
+
+static void test_new_playlist_replaces_one_it_cant_sit_beside() {
+    Playlist old = playlist(PLAYLIST_STORE_MAX_FRAMES, FRAME_MONO, 1);
+    Playlist next = playlist(PLAYLIST_STORE_MAX_FRAMES, FRAME_MONO, 101);
+    TEST_ASSERT_TRUE(save(old));
+    TEST_ASSERT_TRUE(save(next));
+    assertStored(next);
+    TEST_ASSERT_EQUAL_UINT32(0, store->fails());
+}
+
+static void test_shared_bitmaps_are_kept() {
+    Playlist old = playlist(4, FRAME_MONO, 1);
+    Playlist next = playlist(4, FRAME_MONO, 3);    // 3 and 4 carry over
+    TEST_ASSERT_TRUE(save(old));
+    TEST_ASSERT_TRUE(save(next));
+    assertStored(next);
+    TEST_ASSERT_FALSE(LittleFS.exists(String(PLAYLIST_STORE_DIR "/") + old.frames[0].hash));
+}
+
+static void test_full_gray4_playlist_keeps_the_stored_one() {
+    Playlist old = playlist(PLAYLIST_STORE_MAX_FRAMES, FRAME_MONO, 1);
+    TEST_ASSERT_TRUE(save(old));
+    size_t used = LittleFS.usedBytes();
+
+    // 8 x 16128 bytes is 32 blocks: more than the whole partition
+    Playlist gray = playlist(PLAYLIST_STORE_MAX_FRAMES, FRAME_GRAY4, 101);
+    TEST_ASSERT_FALSE(save(gray));
+    TEST_ASSERT_EQUAL_UINT32(1, store->fails());
+    TEST_ASSERT_EQUAL(used, LittleFS.usedBytes());
+    assertStored(old);
+}
+
+static void test_six_gray4_frames_fit_seven_dont() {
+    TEST_ASSERT_TRUE(save(playlist(PLAYLIST_STORE_MAX_FRAMES, FRAME_MONO, 1)));
+    Playlist seven = playlist(7, FRAME_GRAY4, 101);
+    TEST_ASSERT_FALSE(save(seven));
+    Playlist six = playlist(6, FRAME_GRAY4, 201);
+    TEST_ASSERT_TRUE(save(six));
+    assertStored(six);
+}
+
+static void test_repeated_frame_is_counted_once() {
+    // Seven frames, six distinct bitmaps: fits
+    Playlist p = playlist(7, FRAME_GRAY4, 1);
+    p.frames[6] = p.frames[0];
+    p.bitmaps[6] = p.bitmaps[0];
+    TEST_ASSERT_TRUE(save(p));
+    assertStored(p);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_mono_playlist_round_trips);
+    RUN_TEST(test_new_playlist_replaces_one_it_cant_sit_beside);
+    RUN_TEST(test_shared_bitmaps_are_kept);
+    RUN_TEST(test_full_gray4_playlist_keeps_the_stored_one);
+    RUN_TEST(test_six_gray4_frames_fit_seven_dont);
+    RUN_TEST(test_repeated_frame_is_counted_once);
+    return UNITY_END();
+}
@@ -0,0 +1,151 @@
+// RefreshPolicy on the 384x168 screen: partial up to
+// DISPLAY_PARTIAL_MAX_PERCENT of the pixels and fast above, the server's
+// hints (full always, fast and partial only while the budget lasts), each
+// of the three budget limits on its own, what resets the budget and what
+// counts as a cleanse, and a rotation where only a label changes, as
+// Display::refreshFrame() drives it.
+//
+//   pio test -e native -f test_refresh_policy -v
+
+#include <unity.h>
+
+#include "RefreshPolicy.h"
+
+static const uint32_t SCREEN_PX = 384 * 168;
+static const uint32_t PARTIAL_MAX_PX = SCREEN_PX * DISPLAY_PARTIAL_MAX_PERCENT / 100;
+static const uint32_t INK_PX = SCREEN_PX * DISPLAY_GHOST_INK_PERCENT / 100;
+
+static RefreshPolicy* policy;
+
+// Display::refreshFrame(): choose, then record, a full refresh the hint
+// didn't ask for being a cleanse
+static RefreshType update(uint32_t changed, RefreshHint hint = REFRESH_HINT_AUTO) {
+    RefreshType type = policy->choose(changed, hint);
+    policy->record(type, changed, type == REFRESH_FULL && hint != REFRESH_HINT_FULL);
+    return type;
+}
+
+void setUp() {
+    policy = new RefreshPolicy(SCREEN_PX);
+}
+
+void tearDown() {
+    delete policy;
+}
+
+static void test_partial_up_to_the_threshold() {
+    TEST_ASSERT_EQUAL(SCREEN_PX / 4, PARTIAL_MAX_PX);
+    TEST_ASSERT_EQUAL(REFRESH_SKIPPED, policy->choose(0, REFRESH_HINT_AUTO));
+    TEST_ASSERT_EQUAL(REFRESH_PARTIAL, policy->choose(1, REFRESH_HINT_AUTO));
+    TEST_ASSERT_EQUAL(REFRESH_PARTIAL, policy->choose(PARTIAL_MAX_PX, REFRESH_HINT_AUTO));
+    TEST_ASSERT_EQUAL(REFRESH_FAST, policy->choose(PARTIAL_MAX_PX + 1, REFRESH_HINT_AUTO));
+    TEST_ASSERT_EQUAL(REFRESH_FAST, policy->choose(SCREEN_PX, REFRESH_HINT_AUTO));
+}
+
+static void test_full_hint_is_always_honoured() {
+    TEST_ASSERT_EQUAL(REFRESH_FULL, policy->choose(0, REFRESH_HINT_FULL));
+    TEST_ASSERT_EQUAL(REFRESH_FULL, policy->choose(1, REFRESH_HINT_FULL));
+    TEST_ASSERT_EQUAL(REFRESH_FULL, update(100, REFRESH_HINT_FULL));
+    TEST_ASSERT_EQUAL_UINT32(0, policy->cleanses());
+}
+
+static void test_fast_and_partial_hints_while_the_budget_lasts() {
+    TEST_ASSERT_EQUAL(REFRESH_FAST, policy->choose(10, REFRESH_HINT_FAST));
+    TEST_ASSERT_EQUAL(REFRESH_PARTIAL, policy->choose(SCREEN_PX / 2, REFRESH_HINT_PARTIAL));
+
+    for (int i = 0; i < DISPLAY_GHOST_MAX_FASTS; i++) TEST_ASSERT_EQUAL(REFRESH_FAST, update(10, REFRESH_HINT_FAST));
+    TEST_ASSERT_EQUAL(REFRESH_FULL, policy->choose(10, REFRESH_HINT_FAST));
+    // Partials still have budget
+    TEST_ASSERT_EQUAL(REFRESH_PARTIAL, policy->choose(10, REFRESH_HINT_PARTIAL));
+
+    for (int i = 0; i < DISPLAY_GHOST_MAX_PARTIALS; i++) TEST_ASSERT_EQUAL(REFRESH_PARTIAL, update(10, REFRESH_HINT_PARTIAL));
+    TEST_ASSERT_EQUAL(REFRESH_FULL, policy->choose(10, REFRESH_HINT_PARTIAL));
+}
+
+static void test_partial_limit() {
+    for (int i = 0; i < DISPLAY_GHOST_MAX_PARTIALS; i++) TEST_ASSERT_EQUAL(REFRESH_PARTIAL, update(1));
+    TEST_ASSERT_EQUAL_UINT32(DISPLAY_GHOST_MAX_PARTIALS, policy->partials());
+    TEST_ASSERT_FALSE(policy->fits(REFRESH_PARTIAL, 1));
+    TEST_ASSERT_TRUE(policy->fits(REFRESH_FAST, 1));
+    TEST_ASSERT_EQUAL(REFRESH_FULL, policy->choose(1, REFRESH_HINT_AUTO));
+    TEST_ASSERT_EQUAL(REFRESH_FAST, policy->choose(PARTIAL_MAX_PX + 1, REFRESH_HINT_AUTO));
+}
+
+static void test_fast_limit() {
+    for (int i = 0; i < DISPLAY_GHOST_MAX_FASTS; i++) TEST_ASSERT_EQUAL(REFRESH_FAST, update(PARTIAL_MAX_PX + 1));
+    TEST_ASSERT_EQUAL_UINT32(DISPLAY_GHOST_MAX_FASTS, policy->fasts());
+    TEST_ASSERT_FALSE(policy->fits(REFRESH_FAST, 1));
+    TEST_ASSERT_TRUE(policy->fits(REFRESH_PARTIAL, 1));
+    TEST_ASSERT_EQUAL(REFRESH_FULL, policy->choose(PARTIAL_MAX_PX + 1, REFRESH_HINT_AUTO));
+    TEST_ASSERT_EQUAL(REFRESH_PARTIAL, policy->choose(1, REFRESH_HINT_AUTO));
+}
+
+static void test_ink_limit() {
+    // One partial that spends all the ink: counts are far from their limits
+    policy->record(REFRESH_PARTIAL, INK_PX);
+    TEST_ASSERT_EQUAL_UINT32(100, policy->inkUsedPercent());
+    TEST_ASSERT_EQUAL_UINT32(1, policy->partials());
+    TEST_ASSERT_TRUE(policy->fits(REFRESH_PARTIAL, 0));
+    TEST_ASSERT_FALSE(policy->fits(REFRESH_PARTIAL, 1));
+    // Fast updates count a quarter of their pixels
+    TEST_ASSERT_TRUE(policy->fits(REFRESH_FAST, 3));
+    TEST_ASSERT_FALSE(policy->fits(REFRESH_FAST, 4));
+    TEST_ASSERT_EQUAL(REFRESH_FULL, policy->choose(1, REFRESH_HINT_AUTO));
+
+    // Fast updates alone fill it four times slower
+    delete policy;
+    policy = new RefreshPolicy(SCREEN_PX);
+    policy->record(REFRESH_FAST, INK_PX * 2);
+    TEST_ASSERT_EQUAL_UINT32(50, policy->inkUsedPercent());
+}
+
+static void test_forced_full_counts_as_cleanse() {
+    policy->record(REFRESH_PARTIAL, 100);
+    policy->record(REFRESH_FULL, 0, true);
+    TEST_ASSERT_EQUAL_UINT32(1, policy->cleanses());
+    TEST_ASSERT_EQUAL_UINT32(0, policy->partials());
+    policy->record(REFRESH_FULL, 0);
+    TEST_ASSERT_EQUAL_UINT32(1, policy->cleanses());
+
+    // Spending the budget through update() forces one
+    for (int i = 0; i < DISPLAY_GHOST_MAX_PARTIALS; i++) update(1);
+    TEST_ASSERT_EQUAL(REFRESH_FULL, update(1));
+    TEST_ASSERT_EQUAL_UINT32(2, policy->cleanses());
+}
+
+static void test_gray4_resets_the_budget() {
+    for (int i = 0; i < 5; i++) policy->record(REFRESH_PARTIAL, 1000);
+    for (int i = 0; i < 2; i++) policy->record(REFRESH_FAST, PARTIAL_MAX_PX + 1);
+    TEST_ASSERT_GREATER_THAN(0, policy->inkUsedPercent());
+    policy->record(REFRESH_GRAY4, 0);
+    TEST_ASSERT_EQUAL_UINT32(0, policy->partials());
+    TEST_ASSERT_EQUAL_UINT32(0, policy->fasts());
+    TEST_ASSERT_EQUAL_UINT32(0, policy->inkUsedPercent());
+    TEST_ASSERT_EQUAL_UINT32(0, policy->cleanses());
+}
+
+// A price label redrawn on each rotation, the rest of the frame the same:
+// every 31st update is a cleansing full refresh, the rest partial
+static void test_label_only_rotation() {
+    const uint32_t labelPx = 120 * 32 / 3;     // a third of a 120x32 label's pixels flip
+    int counts[REFRESH_TYPES] = {};
+    for (int i = 0; i < 100; i++) counts[update(labelPx)]++;
+    TEST_ASSERT_EQUAL(97, counts[REFRESH_PARTIAL]);
+    TEST_ASSERT_EQUAL(3, counts[REFRESH_FULL]);
+    TEST_ASSERT_EQUAL(0, counts[REFRESH_FAST]);
+    TEST_ASSERT_EQUAL_UINT32(3, policy->cleanses());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_partial_up_to_the_threshold);
+    RUN_TEST(test_full_hint_is_always_honoured);
+    RUN_TEST(test_fast_and_partial_hints_while_the_budget_lasts);
+    RUN_TEST(test_partial_limit);
+    RUN_TEST(test_fast_limit);
+    RUN_TEST(test_ink_limit);
+    RUN_TEST(test_forced_full_counts_as_cleanse);
+    RUN_TEST(test_gray4_resets_the_budget);
+    RUN_TEST(test_label_only_rotation);
+    return UNITY_END();
+}
@@ -0,0 +1,3 @@
+-- AlterTable
+ALTER TABLE "Device" ADD COLUMN "commandSeq" INTEGER NOT NULL DEFAULT 0;
+ALTER TABLE "Device" ADD COLUMN "commandJson" TEXT;
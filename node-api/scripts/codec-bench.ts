@@ -0,0 +1,146 @@
+// Compression ratio and encode throughput of the frame codecs over frames
+// built from the currency symbols in firmware/symbol_previews, and the size
+// of an XOR patch against the best full encoding when only part of a frame
+// changes (the small symbol swapped for the next one, as a price update
+// would redraw one area).
+//
+//   npx tsx scripts/codec-bench.ts [--vectors <dir>]
+//
+// --vectors writes each frame raw and encoded (<name>.raw/.rle/.lzss), the
+// updated frame (<name>.next.raw) and the patch to it (<name>.xor) for the
+// firmware round-trip test (firmware/test/test_frame_codec).
+import { readdirSync, readFileSync, writeFileSync, mkdirSync } from 'fs';
+import { join, basename } from 'path';
+import { fileURLToPath } from 'url';
+import { inflateSync } from 'zlib';
+import { encodeLzss, encodeRle, encodeXorPatch, pickCodec } from '../src/utils/codecs.js';
+
+const WIDTH = 384;
+const HEIGHT = 168;
+const STRIDE = WIDTH / 8;
+const SYMBOLS_DIR = fileURLToPath(new URL('../../firmware/symbol_previews', import.meta.url));
+
+// 1-bit grayscale, non-interlaced PNG -> rows of MSB-first bytes (1 = white)
+const readPng1 = (file: string) => {
+  const png = readFileSync(file);
+  let width = 0;
+  let height = 0;
+  const idat: Buffer[] = [];
+  for (let at = 8; at < png.length; ) {
+    const len = png.readUInt32BE(at);
+    const type = png.toString('ascii', at + 4, at + 8);
+    const data = png.subarray(at + 8, at + 8 + len);
+    if (type === 'IHDR') {
+      width = data.readUInt32BE(0);
+      height = data.readUInt32BE(4);
+      if (data[8] !== 1 || data[9] !== 0 || data[12] !== 0) throw new Error(`${file}: not 1-bit grayscale`);
+    } else if (type === 'IDAT') {
+      idat.push(data);
+    }
+    at += 12 + len;
+  }
+  const stride = Math.ceil(width / 8);
+  const raw = inflateSync(Buffer.concat(idat));
+  const rows = Buffer.alloc(stride * height);
+  for (let y = 0; y < height; y++) {
+    const filter = raw[y * (stride + 1)];
+    for (let x = 0; x < stride; x++) {
+      const a = x > 0 ? rows[y * stride + x - 1] : 0;
+      const b = y > 0 ? rows[(y - 1) * stride + x] : 0;
+      const c = x > 0 && y > 0 ? rows[(y - 1) * stride + x - 1] : 0;
+      let v = raw[y * (stride + 1) + 1 + x];
+      if (filter === 1) v += a;
+      else if (filter === 2) v += b;
+      else if (filter === 3) v += (a + b) >> 1;
+      else if (filter === 4) {
+        const p = a + b - c;
+        const pa = Math.abs(p - a);
+        const pb = Math.abs(p - b);
+        const pc = Math.abs(p - c);
+        v += pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+      }
+      rows[y * stride + x] = v & 0xff;
+    }
+  }
+  return { width, height, stride, rows };
+};
+
+const pixel = (img: ReturnType<typeof readPng1>, x: number, y: number) =>
+  (img.rows[y * img.stride + (x >> 3)] >> (7 - (x & 7))) & 1;
+
+const clear = (frame: Buffer, x: number, y: number) => {
+  frame[y * STRIDE + (x >> 3)] &= ~(0x80 >> (x & 7));
+};
+
+// A ticker-like screen: the symbol (or `inset` in its place), a double-size
+// copy and a rule
+const composeFrame = (img: ReturnType<typeof readPng1>, inset = img) => {
+  const frame = Buffer.alloc(STRIDE * HEIGHT, 0xff);
+  for (let y = 0; y < img.height; y++) {
+    for (let x = 0; x < img.width; x++) {
+      if (!pixel(inset, x, y)) clear(frame, 16 + x, 52 + y);
+      if (pixel(img, x, y)) continue;
+      for (let d = 0; d < 4; d++) if (20 + 2 * y + (d >> 1) < HEIGHT) clear(frame, 240 + 2 * x + (d & 1), 20 + 2 * y + (d >> 1));
+    }
+  }
+  for (let y = 150; y < 152; y++) for (let x = 16; x < WIDTH - 16; x++) clear(frame, x, y);
+  return frame;
+};
+
+const vectorsArg = process.argv.indexOf('--vectors');
+const vectorsDir = vectorsArg > 0 ? process.argv[vectorsArg + 1] : undefined;
+if (vectorsDir) mkdirSync(vectorsDir, { recursive: true });
+
+const symbols = readdirSync(SYMBOLS_DIR)
+  .filter((f) => f.endsWith('.png'))
+  .sort()
+  .map((f) => ({ name: basename(f, '.png'), img: readPng1(join(SYMBOLS_DIR, f)) }));
+const frames = symbols.map(({ name, img }, i) => ({
+  name,
+  frame: composeFrame(img),
+  next: composeFrame(img, symbols[(i + 1) % symbols.length].img),
+}));
+
+const codecs = { rle: encodeRle, lzss: encodeLzss };
+const totals: Record<string, { bytes: number; ms: number }> = {};
+console.log(`${frames.length} frames of ${STRIDE * HEIGHT} bytes`);
+for (const { name, frame } of frames) {
+  const sizes: string[] = [];
+  if (vectorsDir) writeFileSync(join(vectorsDir, `${name}.raw`), frame);
+  for (const [codec, encode] of Object.entries(codecs)) {
+    const runs = 20;
+    const start = process.hrtime.bigint();
+    let data = encode(frame);
+    for (let r = 1; r < runs; r++) data = encode(frame);
+    const ms = Number(process.hrtime.bigint() - start) / 1e6 / runs;
+    totals[codec] ??= { bytes: 0, ms: 0 };
+    totals[codec].bytes += data.length;
+    totals[codec].ms += ms;
+    sizes.push(`${codec} ${data.length} (${((100 * data.length) / frame.length).toFixed(1)}%)`);
+    if (vectorsDir) writeFileSync(join(vectorsDir, `${name}.${codec}`), data);
+  }
+  console.log(`  ${name.padEnd(8)} ${sizes.join('  ')}`);
+}
+const rawBytes = frames.length * STRIDE * HEIGHT;
+for (const [codec, t] of Object.entries(totals)) {
+  const ratio = rawBytes / t.bytes;
+  const mbps = rawBytes / 1e6 / (t.ms / 1e3);
+  console.log(`${codec.padEnd(5)} ratio ${ratio.toFixed(1)}:1  encode ${mbps.toFixed(1)} MB/s`);
+}
+
+// Partial update: patch from frame to next against the best full encoding
+let patchBytes = 0;
+let fullBytes = 0;
+console.log('partial update (xor patch vs best full encoding):');
+for (const { name, frame, next } of frames) {
+  const patch = encodeXorPatch(frame, next);
+  const full = pickCodec(next, Object.keys(codecs));
+  patchBytes += patch.length;
+  fullBytes += full.data.length;
+  console.log(`  ${name.padEnd(8)} xor ${patch.length}  ${full.enc} ${full.data.length}`);
+  if (vectorsDir) {
+    writeFileSync(join(vectorsDir, `${name}.next.raw`), next);
+    writeFileSync(join(vectorsDir, `${name}.xor`), patch);
+  }
+}
+console.log(`xor   ${((100 * patchBytes) / fullBytes).toFixed(1)}% of the full encoding, ${((100 * patchBytes) / rawBytes).toFixed(1)}% of raw`);
@@ -0,0 +1,123 @@
+// PUT-to-pixels latency of a real device and the network time it costs:
+// PUTs a new display `--runs` times and reads back what the device reports
+// in its heartbeat telemetry — push.lastMs (display set here -> first frame
+// of it on the panel, push or polling) and the network task's busy time
+// (tasks.net.busyMs, waits excluded; battery.radioMs on battery).
+//
+// Run it once with push on and a long refresh interval, once polling every
+// 10 s with the API started with LONG_POLL_MAX_SECONDS=0 (the device then
+// polls), and compare:
+//
+//   npx tsx scripts/push-latency.ts --device <id> --token <ops token> --interval 300 --out push.json
+//   npx tsx scripts/push-latency.ts --device <id> --token <ops token> --interval 10 --baseline push.json
+//
+// --api defaults to http://localhost:3001/api/v5; --runs 10, --gap 20 (s
+// between PUTs). The ops token must be of the device's tenant (it also
+// covers the manage scope the PUT needs).
+import { writeFileSync, readFileSync } from 'fs';
+
+const arg = (name: string, fallback?: string) => {
+  const i = process.argv.indexOf(`--${name}`);
+  return i > 0 ? process.argv[i + 1] : fallback;
+};
+
+const api = arg('api', 'http://localhost:3001/api/v5')!;
+const deviceId = arg('device');
+const token = arg('token');
+const runs = parseInt(arg('runs', '10')!, 10);
+const gapSec = parseInt(arg('gap', '20')!, 10);
+const interval = parseInt(arg('interval', '300')!, 10);
+const outFile = arg('out');
+const baselineFile = arg('baseline');
+if (!deviceId || !token) {
+  console.error('usage: push-latency.ts --device <id> --token <ops token> [--api <url>] [--runs n] [--gap s] [--interval s] [--out f] [--baseline f]');
+  process.exit(1);
+}
+
+const TARGET_MS = 3000;
+const WIDTH = 384;
+const HEIGHT = 168;
+const STRIDE = WIDTH / 8;
+
+const request = async (method: string, path: string, body?: unknown) => {
+  const res = await fetch(`${api}${path}`, {
+    method,
+    headers: { authorization: `Bearer ${token}`, ...(body ? { 'content-type': 'application/json' } : {}) },
+    body: body ? JSON.stringify(body) : undefined,
+  });
+  if (!res.ok) throw new Error(`${method} ${path}: ${res.status} ${await res.text()}`);
+  return res.json() as Promise<any>;
+};
+
+// White with a black bar that moves on each run, so every PUT is new content
+const frame = (run: number) => {
+  const bitmap = Buffer.alloc(STRIDE * HEIGHT, 0xff);
+  const x = (run * 5) % (STRIDE - 4);
+  for (let y = 60; y < 108; y++) bitmap.fill(0x00, y * STRIDE + x, y * STRIDE + x + 4);
+  return {
+    frames: [{ bitmap: bitmap.toString('base64'), ledColor: 'off', ledBrightness: 'off', durationSec: 3600 }],
+    refreshInterval: interval,
+  };
+};
+
+const { tenantId } = await request('GET', '/admin/me');
+const telemetry = async () => {
+  const devices = await request('GET', `/admin/devices?tenantId=${encodeURIComponent(tenantId)}`);
+  const device = devices.find((d: any) => d.id === deviceId);
+  if (!device) throw new Error(`device ${deviceId} not in tenant ${tenantId}`);
+  return device.telemetry ?? {};
+};
+
+const sleep = (ms: number) => new Promise((resolve) => setTimeout(resolve, ms));
+
+// One sample per new push.shown count seen: the device stamps the latency
+// once the frame is drawn, so it arrives with the heartbeat after that
+const samples: number[] = [];
+let shown: number | undefined;
+const read = async () => {
+  const t = await telemetry();
+  const count = t.push?.shown ?? 0;
+  if (shown !== undefined && count > shown) samples.push(t.push.lastMs);
+  shown = count;
+  return t;
+};
+
+const first = await read();
+const startMs = Date.now();
+// The last PUT only makes the device report the run before it
+for (let run = 0; run <= runs; run++) {
+  await request('PUT', `/devices/${deviceId}/display`, frame(run));
+  const until = Date.now() + gapSec * 1000;
+  while (Date.now() < until) {
+    await sleep(1000);
+    await read();
+  }
+  console.log(`run ${run}: ${samples.length} samples${samples.length ? `, last ${samples[samples.length - 1]} ms` : ''}`);
+}
+const last = await read();
+const minutes = (Date.now() - startMs) / 60000;
+
+const perMin = (a?: number, b?: number) => (a !== undefined && b !== undefined ? Math.round((b - a) / minutes) : undefined);
+const sorted = [...samples].sort((a, b) => a - b);
+const result = {
+  mode: (last.push?.waits ?? 0) > (first.push?.waits ?? 0) ? 'push' : 'poll',
+  interval,
+  samples: samples.length,
+  medianMs: sorted.length ? sorted[Math.floor(sorted.length / 2)] : undefined,
+  maxMs: sorted.length ? sorted[sorted.length - 1] : undefined,
+  netBusyMsPerMin: perMin(first.tasks?.net?.busyMs, last.tasks?.net?.busyMs),
+  radioMsPerMin: perMin(first.battery?.radioMs, last.battery?.radioMs),
+};
+
+console.log(JSON.stringify(result));
+if (result.medianMs !== undefined) {
+  console.log(`median PUT-to-pixels ${result.medianMs} ms: ${result.medianMs < TARGET_MS ? 'under' : 'NOT under'} ${TARGET_MS} ms`);
+}
+if (outFile) writeFileSync(outFile, JSON.stringify(result));
+if (baselineFile) {
+  const other = JSON.parse(readFileSync(baselineFile, 'utf8'));
+  for (const key of ['medianMs', 'netBusyMsPerMin', 'radioMsPerMin'] as const) {
+    if (other[key] === undefined || result[key] === undefined) continue;
+    console.log(`${key}: ${other.mode} ${other[key]} vs ${result.mode} ${result[key]}`);
+  }
+}
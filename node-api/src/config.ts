@@ -12,6 +12,15 @@ export const config = {
   latestFirmwareVersion: parseInt(process.env.LATEST_FIRMWARE_VERSION ?? '3', 10),
   firmwareDownloadUrl: process.env.FIRMWARE_DOWNLOAD_URL ?? 'https://rd1-io.github.io/tigermeter-api/firmware/prod',
 
+  // Longest a device long-poll (GET /devices/:id/wait) is held open; keep
+  // below any proxy idle timeout in front of the API. 0 turns push off
+  // (devices poll), e.g. for a latency baseline
+  longPollMaxSeconds: parseInt(process.env.LONG_POLL_MAX_SECONDS ?? '50', 10),
+
+  // Fleet-wide heartbeat pacing hint (nextPollSec), e.g. to spread load during
+  // an incident; unset = devices use the display refreshInterval
+  heartbeatNextPollSeconds: parseInt(process.env.HEARTBEAT_NEXT_POLL_SECONDS ?? '0', 10),
+
   // Service-to-service auth tokens (JSON array in env)
   serviceTokensJson: process.env.SERVICE_TOKENS ?? '',
 };
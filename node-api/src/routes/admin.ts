@@ -1,5 +1,6 @@
 import { FastifyInstance } from 'fastify';
 import { z } from 'zod';
+import { notifyDeviceChanged } from '../utils/device-events.js';
 
 const DeviceSettingsSchema = z.object({
   autoUpdate: z.boolean().optional(),
@@ -36,6 +37,7 @@ export default async function adminRoutes(app: FastifyInstance) {
       battery: d.battery,
       rssi: d.rssi,
       firmwareVersion: d.firmwareVersion,
+      telemetry: d.telemetryJson ? JSON.parse(d.telemetryJson) : null,
       autoUpdate: d.autoUpdate,
       demoMode: d.demoMode,
       displayHash: d.displayHash,
@@ -73,6 +75,7 @@ export default async function adminRoutes(app: FastifyInstance) {
         previousSecretExpiresAt: null,
       },
     });
+    notifyDeviceChanged(id);
     return { status: 'revoked' };
   });
 
@@ -111,6 +114,7 @@ export default async function adminRoutes(app: FastifyInstance) {
         previousSecretExpiresAt: null,
       },
     });
+    notifyDeviceChanged(id);
     return { queued: true };
   });
 
@@ -131,6 +135,7 @@ export default async function adminRoutes(app: FastifyInstance) {
     }
 
     const updated = await app.prisma.device.update({ where: { id }, data: updateData });
+    notifyDeviceChanged(id);
     return { id: updated.id, autoUpdate: updated.autoUpdate, demoMode: updated.demoMode };
   });
 
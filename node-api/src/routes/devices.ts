@@ -3,7 +3,10 @@ import { z } from 'zod';
 import { addSeconds } from 'date-fns';
 import bcrypt from 'bcryptjs';
 import { config } from '../config.js';
-import { generateDeviceSecret, hashPassword } from '../utils/crypto.js';
+import { frameBitmapHash, generateDeviceSecret, hashPassword } from '../utils/crypto.js';
+import { encodeFramesBinary, FRAMES_BIN_CONTENT_TYPE, splitFrameBlobs } from '../utils/frame-transport.js';
+import { encodeXorPatch, pickCodec } from '../utils/codecs.js';
+import { displayChangeAge, waitForDeviceChange } from '../utils/device-events.js';
 
 const HeartbeatSchema = z.object({
   battery: z.number().int().optional(),
@@ -12,6 +15,30 @@ const HeartbeatSchema = z.object({
   firmwareVersion: z.string().optional(),
   uptimeSeconds: z.number().int().optional(),
   displayHash: z.string().optional(),
+  // Last one-shot command the device executed
+  commandSeq: z.number().int().optional(),
+  // Free-form firmware counters (e.g. conn.reused / conn.new), stored as-is
+  telemetry: z.record(z.unknown()).optional(),
+  // Optional response capabilities: "bin" = binary frame transport,
+  // "cas" = frames by content hash (bitmaps fetched via POST /frames),
+  // "delta" = XOR patches against a held base frame in POST /frames
+  features: z.array(z.string()).optional(),
+  // Frame codecs the device can decode (binary transport only), e.g. ["rle", "lzss"]
+  codecs: z.array(z.string()).optional(),
+});
+
+const FramesFetchSchema = z.object({
+  hashes: z.array(z.string()).min(1).max(8),
+  // bases[i]: hash the device holds to patch hashes[i] from ("" = none)
+  bases: z.array(z.string()).max(8).optional(),
+  codecs: z.array(z.string()).optional(),
+});
+
+const WaitQuerySchema = z.object({
+  // Display hash and last executed command the device holds
+  hash: z.string().optional(),
+  commandSeq: z.coerce.number().int().optional(),
+  timeout: z.coerce.number().int().min(1).optional(),
 });
 
 export default async function deviceRoutes(app: FastifyInstance) {
@@ -54,6 +81,12 @@ export default async function deviceRoutes(app: FastifyInstance) {
       return { factoryReset: true };
     }
 
+    // One-shot command: resend until the device reports it executed
+    const commandAcked = body.commandSeq !== undefined && body.commandSeq >= device.commandSeq;
+    const command = device.commandJson && !commandAcked
+      ? { seq: device.commandSeq, ...JSON.parse(device.commandJson) }
+      : undefined;
+
     // Update telemetry
     await app.prisma.device.update({
       where: { id: device.id },
@@ -63,6 +96,8 @@ export default async function deviceRoutes(app: FastifyInstance) {
         rssi: body.rssi ?? device.rssi,
         ip: body.ip ?? device.ip,
         firmwareVersion: body.firmwareVersion ?? device.firmwareVersion,
+        telemetryJson: body.telemetry ? JSON.stringify(body.telemetry) : device.telemetryJson,
+        commandJson: commandAcked ? null : device.commandJson,
       },
     });
 
@@ -73,6 +108,8 @@ export default async function deviceRoutes(app: FastifyInstance) {
       demoMode: device.demoMode,
       latestFirmwareVersion: config.latestFirmwareVersion,
       firmwareDownloadUrl: config.firmwareDownloadUrl,
+      ...(config.heartbeatNextPollSeconds > 0 ? { nextPollSec: config.heartbeatNextPollSeconds } : {}),
+      ...(command ? { command } : {}),
     };
 
     // Hash match — no new content (empty frames means no content yet, NOT a match)
@@ -83,11 +120,52 @@ export default async function deviceRoutes(app: FastifyInstance) {
     // Hash mismatch or missing — serve frames
     if (device.displayFramesJson && device.displayHash) {
       const payload = JSON.parse(device.displayFramesJson);
+      // How long ago this display was set, so the device can report PUT-to-pixels latency
+      const changedMsAgo = displayChangeAge(device.id, device.displayHash);
+      const changeAge = changedMsAgo !== undefined ? { changedMsAgo } : {};
+
+      // Content-addressed: manifest of per-frame hashes, the device fetches
+      // only the bitmaps it doesn't hold via POST /frames
+      if (body.features?.includes('cas') && payload.frames.length > 0) {
+        // Previous frame at the same position is the candidate delta base
+        // (if it has the same format: a patch keeps the bitmap size)
+        const previous = body.features?.includes('delta') && device.previousFramesJson
+          ? JSON.parse(device.previousFramesJson).frames
+          : [];
+        return {
+          ...baseResponse,
+          frames: payload.frames.map(({ bitmap, ...meta }: any, i: number) => {
+            const hash = frameBitmapHash(bitmap);
+            const base = previous[i] && (previous[i].format ?? 'mono') === (meta.format ?? 'mono')
+              ? frameBitmapHash(previous[i].bitmap)
+              : undefined;
+            return base && base !== hash ? { ...meta, hash, base } : { ...meta, hash };
+          }),
+          refreshInterval: payload.refreshInterval,
+          displayHash: device.displayHash,
+          ...changeAge,
+        };
+      }
+
+      // Binary transport: metadata as a JSON header, bitmaps as raw blobs
+      if (body.features?.includes('bin') && payload.frames.length > 0) {
+        const { frames, blobs } = splitFrameBlobs(payload.frames, body.codecs);
+        const header = {
+          ...baseResponse,
+          frames,
+          refreshInterval: payload.refreshInterval,
+          displayHash: device.displayHash,
+          ...changeAge,
+        };
+        return reply.type(FRAMES_BIN_CONTENT_TYPE).send(encodeFramesBinary(header, blobs));
+      }
+
       return {
         ...baseResponse,
         frames: payload.frames,
         refreshInterval: payload.refreshInterval,
         displayHash: device.displayHash,
+        ...changeAge,
       };
     }
 
@@ -100,6 +178,81 @@ export default async function deviceRoutes(app: FastifyInstance) {
     };
   });
 
+  // --- LONG-POLL for changes (push mode) ---
+  // Held open until the device's display, command or status changes, or the
+  // timeout passes; { changed: true } tells the device to heartbeat now
+  app.get('/devices/:id/wait', async (request, reply) => {
+    // Push disabled (LONG_POLL_MAX_SECONDS=0): answer as an older server
+    // would, and devices fall back to heartbeat polling
+    if (config.longPollMaxSeconds <= 0) return reply.code(404).send({ message: 'Not found' });
+    const { id } = request.params as any;
+    const device = await app.requireDevice(id, request.headers['authorization']);
+    const query = WaitQuerySchema.parse(request.query ?? {});
+    const timeoutSec = Math.min(query.timeout ?? config.longPollMaxSeconds, config.longPollMaxSeconds);
+
+    // Subscribe before re-reading, so a change landing in between isn't missed
+    const wait = waitForDeviceChange(device.id, timeoutSec * 1000);
+    reply.raw.on('close', wait.cancel);
+    const current = await app.prisma.device.findUnique({ where: { id: device.id } });
+    const pending = !current
+      || current.status !== 'active'
+      || current.pendingFactoryReset
+      || (current.displayHash ?? '') !== (query.hash ?? '')
+      || (!!current.commandJson && query.commandSeq !== undefined && current.commandSeq > query.commandSeq);
+    if (pending) {
+      wait.cancel();
+      return { changed: true };
+    }
+    return { changed: await wait.changed };
+  });
+
+  // --- FETCH frame bitmaps by content hash (binary transport) ---
+  app.post('/devices/:id/frames', async (request, reply) => {
+    const { id } = request.params as any;
+    const device = await app.requireDevice(id, request.headers['authorization']);
+    const body = FramesFetchSchema.parse(request.body ?? {});
+    if (!device.displayFramesJson) return reply.code(404).send({ message: 'Not found' });
+
+    const payload = JSON.parse(device.displayFramesJson);
+    const byHash = new Map<string, string>();
+    for (const f of payload.frames) byHash.set(frameBitmapHash(f.bitmap), f.bitmap);
+
+    // Delta bases may come from the current or the replaced playlist
+    const baseByHash = new Map(byHash);
+    if (device.previousFramesJson) {
+      for (const f of JSON.parse(device.previousFramesJson).frames) baseByHash.set(frameBitmapHash(f.bitmap), f.bitmap);
+    }
+
+    // Unknown hashes (playlist changed since the heartbeat) are left out.
+    // A frame goes as an XOR patch when the device named a base and the
+    // patch beats the best full encoding.
+    const frames: Record<string, unknown>[] = [];
+    const blobs: Buffer[] = [];
+    const seen = new Set<string>();
+    body.hashes.forEach((hash, i) => {
+      const bitmap = byHash.get(hash);
+      if (!bitmap || seen.has(hash)) return;
+      seen.add(hash);
+      const target = Buffer.from(bitmap, 'base64');
+      const full = pickCodec(target, body.codecs);
+      const base = body.bases?.[i];
+      const baseBytes = base && baseByHash.has(base) ? Buffer.from(baseByHash.get(base)!, 'base64') : undefined;
+      if (baseBytes && baseBytes.length === target.length) {
+        const patch = encodeXorPatch(baseBytes, target);
+        if (patch.length < full.data.length) {
+          frames.push({ hash, base, enc: 'xor' });
+          blobs.push(patch);
+          return;
+        }
+      }
+      frames.push(full.enc === 'raw' ? { hash } : { hash, enc: full.enc });
+      blobs.push(full.data);
+    });
+    if (frames.length === 0) return reply.code(404).send({ message: 'Frames not found' });
+
+    return reply.type(FRAMES_BIN_CONTENT_TYPE).send(encodeFramesBinary({ frames }, blobs));
+  });
+
   // --- GET display hash ---
   app.get('/devices/:id/display/hash', async (request, reply) => {
     const { id } = request.params as any;
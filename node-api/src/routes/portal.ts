@@ -1,27 +1,60 @@
 import { FastifyInstance } from 'fastify';
 import { z } from 'zod';
 import { displayPayloadHash } from '../utils/crypto.js';
+import { notifyDeviceChanged, notifyDisplayChanged } from '../utils/device-events.js';
 
 // Per-frame LED/beep enums
 const LedColor = z.enum(['green', 'red', 'blue', 'yellow', 'cyan', 'magenta', 'white', 'rainbow', 'off']);
 const LedBrightness = z.enum(['low', 'mid', 'high', 'off']);
 
+// One step of a per-frame LED sequence (loops while the frame is shown)
+const LedKeyframe = z.strictObject({
+  color: z.union([LedColor.exclude(['rainbow']), z.string().regex(/^#[0-9a-fA-F]{6}$/)]),
+  fadeMs: z.number().int().min(0).max(60000).optional(),
+  holdMs: z.number().int().min(0).max(60000).optional(),
+});
+
+// One step of a per-frame beep (hz 0 = rest; duty 255 = loudest)
+const Tone = z.strictObject({
+  hz: z.number().int().min(0).max(8000),
+  ms: z.number().int().min(10).max(2000),
+  duty: z.number().int().min(0).max(255).optional(),
+});
+const Melody = z.enum(['positive', 'negative', 'chime', 'alert', 'none']);
+
+// How the panel refreshes when the frame comes up (auto: by the size of the change)
+const RefreshHint = z.enum(['auto', 'full', 'fast', 'partial']);
+
+// Pixel format of the bitmap: mono = 1 bit per pixel, gray4 = 2 bits (4 gray levels)
+const FrameFormat = z.enum(['mono', 'gray4']);
+const FRAME_BYTES = { mono: 8064, gray4: 16128 } as const;
+
 // Single display frame
-const DisplayFrame = z.strictObject({
-  bitmap: z.string().refine(
-    (val) => {
-      try {
-        const decoded = Buffer.from(val, 'base64');
-        return decoded.length === 8064;
-      } catch { return false; }
-    },
-    { message: 'bitmap must be valid base64 of exactly 8064 bytes (384x168 1-bit packed)' }
-  ),
+const DisplayFrameFields = z.strictObject({
+  bitmap: z.string(),
+  format: FrameFormat.optional(),
   ledColor: LedColor,
   ledBrightness: LedBrightness,
   durationSec: z.number().int().min(1).max(86400),
   beep: z.boolean().optional(),
   flashCount: z.number().int().min(0).max(10).optional(),
+  ledKeyframes: z.array(LedKeyframe).min(1).max(8).optional(),
+  melody: Melody.optional(),
+  tones: z.array(Tone).min(1).max(8).optional(),
+  refresh: RefreshHint.optional(),
+});
+
+const DisplayFrame = DisplayFrameFields.superRefine((frame, ctx) => {
+  const format = frame.format ?? 'mono';
+  if (Buffer.from(frame.bitmap, 'base64').length !== FRAME_BYTES[format]) {
+    ctx.addIssue({
+      code: z.ZodIssueCode.custom,
+      path: ['bitmap'],
+      message: format === 'gray4'
+        ? 'bitmap must be valid base64 of exactly 16128 bytes (384x168 2-bit packed)'
+        : 'bitmap must be valid base64 of exactly 8064 bytes (384x168 1-bit packed)',
+    });
+  }
 });
 
 // Full display payload
@@ -30,6 +63,21 @@ const DisplayFramesPayload = z.strictObject({
   refreshInterval: z.number().int().min(10).max(3600),
 });
 
+// Metadata-only update: frames[i] is merged into current frame i, bitmaps (and their format) untouched
+const DisplayMetaPatch = z.strictObject({
+  frames: z.array(DisplayFrameFields.omit({ bitmap: true, format: true }).partial()).max(8).optional(),
+  refreshInterval: z.number().int().min(10).max(3600).optional(),
+});
+
+// One-shot command, fired once by the device on its next heartbeat
+const DeviceCommand = z.strictObject({
+  beep: z.boolean().optional(),
+  flashCount: z.number().int().min(1).max(10).optional(),
+}).refine((c) => c.beep || c.flashCount, { message: 'beep or flashCount required' });
+
+const sameBitmaps = (a: any, b: any): boolean =>
+  a.frames.length === b.frames.length && a.frames.every((f: any, i: number) => f.bitmap === b.frames[i].bitmap);
+
 // PATCH device body
 const DevicePatchSchema = z.object({
   name: z.string().max(128).optional(),
@@ -104,6 +152,7 @@ export default async function portalRoutes(app: FastifyInstance) {
     }
 
     const updated = await app.prisma.device.update({ where: { id }, data: updateData });
+    notifyDeviceChanged(id);
     return {
       id: updated.id,
       name: updated.name,
@@ -121,6 +170,42 @@ export default async function portalRoutes(app: FastifyInstance) {
 
     const payload = DisplayFramesPayload.parse(request.body);
     const displayHash = displayPayloadHash(payload);
+    const current = d.displayFramesJson ? JSON.parse(d.displayFramesJson) : null;
+
+    await app.prisma.device.update({
+      where: { id },
+      data: {
+        displayFramesJson: JSON.stringify(payload),
+        // Keep the replaced bitmaps as the base for XOR-delta frame updates
+        previousFramesJson: current && !sameBitmaps(current, payload) ? d.displayFramesJson : d.previousFramesJson,
+        displayHash,
+        displayVersion: (d.displayVersion ?? 0) + 1,
+      },
+    });
+    notifyDisplayChanged(id, displayHash);
+
+    return { displayHash, displayVersion: (d.displayVersion ?? 0) + 1 };
+  });
+
+  // --- PATCH display metadata (tenant-scoped): LED/beep/flash/duration without bitmaps ---
+  app.patch('/devices/:id/display', async (request, reply) => {
+    const auth = await app.requireScope(request, 'manage');
+    const { id } = request.params as any;
+    const d = await app.prisma.device.findUnique({ where: { id } });
+    if (!d || d.tenantId !== auth.tenantId) return reply.code(404).send({ message: 'Not found' });
+    if (!d.displayFramesJson) return reply.code(404).send({ message: 'No frames' });
+
+    const patch = DisplayMetaPatch.parse(request.body ?? {});
+    const current = JSON.parse(d.displayFramesJson);
+    if (patch.frames && patch.frames.length > current.frames.length) {
+      return reply.code(400).send({ message: `frames: device has ${current.frames.length} frames` });
+    }
+
+    const payload = {
+      frames: current.frames.map((f: any, i: number) => ({ ...f, ...(patch.frames?.[i] ?? {}) })),
+      refreshInterval: patch.refreshInterval ?? current.refreshInterval,
+    };
+    const displayHash = displayPayloadHash(payload);
 
     await app.prisma.device.update({
       where: { id },
@@ -130,10 +215,31 @@ export default async function portalRoutes(app: FastifyInstance) {
         displayVersion: (d.displayVersion ?? 0) + 1,
       },
     });
+    notifyDisplayChanged(id, displayHash);
 
     return { displayHash, displayVersion: (d.displayVersion ?? 0) + 1 };
   });
 
+  // --- POST one-shot command (tenant-scoped): beep/flash without a playlist change ---
+  app.post('/devices/:id/commands', async (request, reply) => {
+    const auth = await app.requireScope(request, 'manage');
+    const { id } = request.params as any;
+    const d = await app.prisma.device.findUnique({ where: { id } });
+    if (!d || d.tenantId !== auth.tenantId) return reply.code(404).send({ message: 'Not found' });
+
+    const command = DeviceCommand.parse(request.body ?? {});
+    const commandSeq = (d.commandSeq ?? 0) + 1;
+
+    // Latest command wins; the device acks it with commandSeq in the heartbeat
+    await app.prisma.device.update({
+      where: { id },
+      data: { commandSeq, commandJson: JSON.stringify(command) },
+    });
+    notifyDeviceChanged(id);
+
+    return { commandSeq };
+  });
+
   // --- REVOKE device (tenant-scoped) ---
   app.post('/devices/:id/revoke', async (request, reply) => {
     const auth = await app.requireScope(request, 'manage');
@@ -153,6 +259,7 @@ export default async function portalRoutes(app: FastifyInstance) {
         previousSecretExpiresAt: null,
       },
     });
+    notifyDeviceChanged(id);
 
     return { status: 'revoked' };
   });
@@ -0,0 +1,168 @@
+// Frame codecs for the binary transport. Decoders live in firmware
+// src/utility/FrameCodec.h — keep both sides in sync.
+import { createHash } from 'crypto';
+
+export type FrameCodec = 'raw' | 'rle' | 'lzss';
+
+// PackBits: n = 0..127 -> n+1 literals; n = -127..-1 -> next byte repeated 1-n times
+export const encodeRle = (src: Buffer): Buffer => {
+  const out: number[] = [];
+  let i = 0;
+  while (i < src.length) {
+    let run = 1;
+    while (i + run < src.length && run < 128 && src[i + run] === src[i]) run++;
+    if (run >= 2) {
+      out.push(257 - run, src[i]);
+      i += run;
+      continue;
+    }
+    // Literal block up to the next run of 2+ identical bytes
+    const start = i;
+    while (i < src.length && i - start < 128) {
+      if (i + 1 < src.length && src[i + 1] === src[i]) break;
+      i++;
+    }
+    out.push(i - start - 1, ...src.subarray(start, i));
+  }
+  return Buffer.from(out);
+};
+
+// LZSS: flag byte per 8 items (LSB first, 1 = literal); reference = 2 bytes,
+// offset-1 in 12 bits (window 4096), length-3 in 4 bits (3..18).
+// Matches are found through hash chains over the next 3 bytes, nearest
+// first, trying at most LZ_CHAIN candidates per position: encoding cost
+// stays linear in the frame size instead of window x frame.
+const LZ_WINDOW = 4096;
+const LZ_MIN = 3;
+const LZ_MAX = 18;
+const LZ_CHAIN = 256;
+const LZ_HASH_BITS = 15;
+
+const lzHash = (src: Buffer, i: number) =>
+  ((src[i] << 10) ^ (src[i + 1] << 5) ^ src[i + 2]) & ((1 << LZ_HASH_BITS) - 1);
+
+export const encodeLzss = (src: Buffer): Buffer => {
+  const out: number[] = [];
+  const head = new Int32Array(1 << LZ_HASH_BITS).fill(-1);
+  const prev = new Int32Array(src.length);
+  let hashed = 0;
+  const hashUpTo = (end: number) => {
+    for (; hashed < end && hashed + LZ_MIN <= src.length; hashed++) {
+      const h = lzHash(src, hashed);
+      prev[hashed] = head[h];
+      head[h] = hashed;
+    }
+  };
+  let flagPos = -1;
+  let items = 8;
+  let i = 0;
+  while (i < src.length) {
+    if (items === 8) {
+      flagPos = out.length;
+      out.push(0);
+      items = 0;
+    }
+    let bestLen = 0;
+    let bestOff = 0;
+    const maxLen = Math.min(LZ_MAX, src.length - i);
+    if (maxLen >= LZ_MIN) {
+      let cand = head[lzHash(src, i)];
+      for (let tries = 0; cand >= 0 && i - cand <= LZ_WINDOW && tries < LZ_CHAIN; tries++, cand = prev[cand]) {
+        let len = 0;
+        while (len < maxLen && src[cand + len] === src[i + len]) len++;
+        if (len > bestLen) {
+          bestLen = len;
+          bestOff = i - cand;
+          if (len === maxLen) break;
+        }
+      }
+    }
+    if (bestLen >= LZ_MIN) {
+      const o = bestOff - 1;
+      out.push(o & 0xff, ((o >> 8) << 4) | (bestLen - LZ_MIN));
+      i += bestLen;
+    } else {
+      out[flagPos] |= 1 << items;
+      out.push(src[i]);
+      i++;
+    }
+    hashUpTo(i);
+    items++;
+  }
+  return Buffer.from(out);
+};
+
+const ENCODERS: Record<Exclude<FrameCodec, 'raw'>, (src: Buffer) => Buffer> = {
+  rle: encodeRle,
+  lzss: encodeLzss,
+};
+
+// Smallest encoding among the codecs the device accepts (raw if nothing wins).
+// Every heartbeat and frame fetch re-encodes the same few playlist frames,
+// so results are kept per bitmap digest and codec set.
+const PICK_CACHE_SIZE = 64;
+const pickCache = new Map<string, { enc: FrameCodec; data: Buffer }>();
+
+export const pickCodec = (bitmap: Buffer, accepted: string[] = []): { enc: FrameCodec; data: Buffer } => {
+  const codecs = Object.keys(ENCODERS).filter((name) => accepted.includes(name));
+  if (codecs.length === 0) return { enc: 'raw', data: bitmap };
+  const key = `${createHash('sha1').update(bitmap).digest('hex')}:${codecs.join(',')}`;
+  const cached = pickCache.get(key);
+  if (cached) {
+    // Most recently used goes last; the first key is the one to evict
+    pickCache.delete(key);
+    pickCache.set(key, cached);
+    return cached;
+  }
+  let best: { enc: FrameCodec; data: Buffer } = { enc: 'raw', data: bitmap };
+  for (const name of codecs) {
+    const data = ENCODERS[name as keyof typeof ENCODERS](bitmap);
+    if (data.length < best.data.length) best = { enc: name as FrameCodec, data };
+  }
+  pickCache.set(key, best);
+  if (pickCache.size > PICK_CACHE_SIZE) pickCache.delete(pickCache.keys().next().value!);
+  return best;
+};
+
+// XOR delta against a base bitmap the device already holds:
+// repeated { varint skip, varint len, len bytes (target ^ base) }, trailing
+// unchanged bytes omitted. Short unchanged gaps are folded into a run since
+// a new run header costs at least two bytes.
+const pushVarint = (out: number[], v: number) => {
+  while (v >= 0x80) {
+    out.push((v & 0x7f) | 0x80);
+    v >>>= 7;
+  }
+  out.push(v);
+};
+
+export const encodeXorPatch = (base: Buffer, target: Buffer): Buffer => {
+  const out: number[] = [];
+  let skip = 0;
+  let i = 0;
+  while (i < target.length) {
+    if (target[i] === base[i]) {
+      skip++;
+      i++;
+      continue;
+    }
+    const start = i;
+    let end = i;
+    while (end < target.length) {
+      if (target[end] !== base[end]) {
+        end++;
+        continue;
+      }
+      let gap = end;
+      while (gap < target.length && gap - end < 3 && target[gap] === base[gap]) gap++;
+      if (gap - end >= 3 || gap === target.length) break;
+      end = gap;
+    }
+    pushVarint(out, skip);
+    pushVarint(out, end - start);
+    for (let k = start; k < end; k++) out.push(target[k] ^ base[k]);
+    skip = 0;
+    i = end;
+  }
+  return Buffer.from(out);
+};
@@ -26,6 +26,10 @@ export const displayPayloadHash = (obj: unknown): string => {
   return `sha256:${hash}`;
 };
 
+// Per-frame content hash: sha256 of the raw bitmap (device frame cache key)
+export const frameBitmapHash = (bitmapBase64: string): string =>
+  createHash('sha256').update(Buffer.from(bitmapBase64, 'base64')).digest('hex');
+
 export const hashPassword = async (plaintext: string): Promise<string> => bcrypt.hash(plaintext, 10);
 export const verifyPassword = async (plaintext: string, hashed: string): Promise<boolean> => bcrypt.compare(plaintext, hashed);
 
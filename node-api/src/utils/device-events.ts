@@ -0,0 +1,49 @@
+import { EventEmitter } from 'node:events';
+
+// In-process "device changed" notifications for long-polling devices
+// (GET /devices/:id/wait). Scoped to one API instance: a waiter on another
+// replica doesn't see the change and returns on its timeout instead, and the
+// device then picks the change up on its next wait or heartbeat.
+const emitter = new EventEmitter();
+emitter.setMaxListeners(0);
+
+// When each device's current display was set, for `changedMsAgo` in the
+// heartbeat (PUT-to-pixels latency on the device). Same single-instance scope.
+const displayChanges = new Map<string, { hash: string; at: number }>();
+
+export function notifyDeviceChanged(deviceId: string) {
+  emitter.emit(deviceId);
+}
+
+export function notifyDisplayChanged(deviceId: string, displayHash: string) {
+  displayChanges.set(deviceId, { hash: displayHash, at: Date.now() });
+  notifyDeviceChanged(deviceId);
+}
+
+// Milliseconds since `displayHash` was set on the device, if this instance set it
+export function displayChangeAge(deviceId: string, displayHash: string): number | undefined {
+  const change = displayChanges.get(deviceId);
+  return change?.hash === displayHash ? Date.now() - change.at : undefined;
+}
+
+// Open waits for the device (tests, diagnostics)
+export function waitingCount(deviceId: string) {
+  return emitter.listenerCount(deviceId);
+}
+
+// `changed` resolves true on the next notification for the device, false on
+// timeout or cancel()
+export function waitForDeviceChange(deviceId: string, timeoutMs: number) {
+  let finish!: (changed: boolean) => void;
+  const changed = new Promise<boolean>((resolve) => {
+    const onChange = () => finish(true);
+    const timer = setTimeout(() => finish(false), timeoutMs);
+    finish = (value: boolean) => {
+      clearTimeout(timer);
+      emitter.off(deviceId, onChange);
+      resolve(value);
+    };
+    emitter.on(deviceId, onChange);
+  });
+  return { changed, cancel: () => finish(false) };
+}
@@ -0,0 +1,154 @@
+// GET /devices/:id/wait against an in-memory device row: a device that is
+// already behind is answered at once, a change while waiting wakes it, a
+// change landing between subscribing and the re-read isn't lost, and a
+// timeout or a client that goes away leaves no waiter behind. Also the
+// display change age the heartbeat reports (changedMsAgo).
+//
+//   npm test
+import { test, before, after, beforeEach } from 'node:test';
+import assert from 'node:assert/strict';
+import Fastify from 'fastify';
+import sensible from '@fastify/sensible';
+import bcrypt from 'bcryptjs';
+import deviceRoutes from '../src/routes/devices.js';
+import { config, V5_PREFIX } from '../src/config.js';
+import {
+  displayChangeAge,
+  notifyDeviceChanged,
+  notifyDisplayChanged,
+  waitingCount,
+} from '../src/utils/device-events.js';
+
+const DEVICE_ID = 'dev-wait';
+const SECRET = 'ds_wait-test';
+const secretHash = bcrypt.hashSync(SECRET, 4);
+
+let row: Record<string, unknown>;
+let reads = 0;
+// Runs on the route's re-read of the device (the second read of a request)
+let onReread: (() => void) | undefined;
+
+const prisma = {
+  device: {
+    findUnique: async () => {
+      reads++;
+      if (reads === 2) onReread?.();
+      return { ...row };
+    },
+  },
+};
+
+const app = Fastify();
+let base = '';
+
+before(async () => {
+  app.decorate('prisma', prisma as any);
+  await app.register(sensible);
+  await app.register(deviceRoutes, { prefix: V5_PREFIX });
+  base = `${await app.listen({ port: 0, host: '127.0.0.1' })}${V5_PREFIX}/devices/${DEVICE_ID}`;
+});
+
+after(() => app.close());
+
+beforeEach(() => {
+  row = {
+    id: DEVICE_ID,
+    status: 'active',
+    currentSecretHash: secretHash,
+    currentSecretExpiresAt: new Date(Date.now() + 3600_000),
+    previousSecretHash: null,
+    previousSecretExpiresAt: null,
+    pendingFactoryReset: false,
+    displayHash: 'h1',
+    commandJson: null,
+    commandSeq: 0,
+  };
+  reads = 0;
+  onReread = undefined;
+});
+
+const wait = (query: string, signal?: AbortSignal) =>
+  fetch(`${base}/wait?${query}`, { headers: { authorization: `Bearer ${SECRET}` }, signal });
+
+const until = async (condition: () => boolean, what: string) => {
+  const deadline = Date.now() + 2000;
+  while (!condition()) {
+    if (Date.now() > deadline) assert.fail(`timed out waiting for ${what}`);
+    await new Promise((resolve) => setTimeout(resolve, 5));
+  }
+};
+
+test('answers at once when the device holds an old display hash', async () => {
+  const start = Date.now();
+  const res = await wait('hash=h0&commandSeq=0&timeout=5');
+  assert.equal(res.status, 200);
+  assert.deepEqual(await res.json(), { changed: true });
+  assert.ok(Date.now() - start < 1000);
+  assert.equal(waitingCount(DEVICE_ID), 0);
+});
+
+test('answers at once when a command is ahead of the device', async () => {
+  row.commandJson = JSON.stringify({ seq: 3, beep: true });
+  row.commandSeq = 3;
+  const res = await wait('hash=h1&commandSeq=2&timeout=5');
+  assert.deepEqual(await res.json(), { changed: true });
+  assert.equal(waitingCount(DEVICE_ID), 0);
+});
+
+test('a change while waiting wakes the device', async () => {
+  const start = Date.now();
+  const pending = wait('hash=h1&commandSeq=0&timeout=5');
+  await until(() => waitingCount(DEVICE_ID) === 1 && reads === 2, 'the waiter');
+  notifyDeviceChanged(DEVICE_ID);
+  assert.deepEqual(await (await pending).json(), { changed: true });
+  assert.ok(Date.now() - start < 1000);
+  assert.equal(waitingCount(DEVICE_ID), 0);
+});
+
+test('a change between subscribing and the re-read is not missed', async () => {
+  // The notification fires before the re-read returns, and the re-read
+  // still sees the old row: only the subscription can catch it
+  onReread = () => notifyDeviceChanged(DEVICE_ID);
+  const start = Date.now();
+  const res = await wait('hash=h1&commandSeq=0&timeout=5');
+  assert.deepEqual(await res.json(), { changed: true });
+  assert.ok(Date.now() - start < 1000);
+  assert.equal(waitingCount(DEVICE_ID), 0);
+});
+
+test('times out with changed false and unsubscribes', async () => {
+  const start = Date.now();
+  const res = await wait('hash=h1&commandSeq=0&timeout=1');
+  assert.deepEqual(await res.json(), { changed: false });
+  assert.ok(Date.now() - start >= 950);
+  assert.equal(waitingCount(DEVICE_ID), 0);
+});
+
+test('a client that goes away leaves no waiter', async () => {
+  const abort = new AbortController();
+  const pending = wait('hash=h1&commandSeq=0&timeout=30', abort.signal).catch(() => null);
+  await until(() => waitingCount(DEVICE_ID) === 1, 'the waiter');
+  abort.abort();
+  assert.equal(await pending, null);
+  await until(() => waitingCount(DEVICE_ID) === 0, 'the waiter to go');
+});
+
+test('404 with push turned off', async () => {
+  const saved = config.longPollMaxSeconds;
+  config.longPollMaxSeconds = 0;
+  try {
+    const res = await wait('hash=h1&commandSeq=0&timeout=5');
+    assert.equal(res.status, 404);
+  } finally {
+    config.longPollMaxSeconds = saved;
+  }
+});
+
+test('display change age is for the hash that was set', async () => {
+  notifyDisplayChanged(DEVICE_ID, 'h2');
+  await new Promise((resolve) => setTimeout(resolve, 20));
+  const age = displayChangeAge(DEVICE_ID, 'h2');
+  assert.ok(age !== undefined && age >= 15 && age < 1000);
+  assert.equal(displayChangeAge(DEVICE_ID, 'h1'), undefined);
+  assert.equal(displayChangeAge('other-device', 'h2'), undefined);
+});
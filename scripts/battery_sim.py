@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""Battery life of a TigerMeter in battery mode vs. always on.
+
+Energy model: each state the device can be in draws a (typical, datasheet-
+level) current; a playlist and heartbeat interval turn into time spent in
+each state per hour. Currents are estimates for an ESP32-WROVER board with
+the 2.9" e-paper, not measurements -- override them with --current.
+
+    battery_sim.py --frames 300,300,600 --heartbeat 900 --mah 2000
+    battery_sim.py --telemetry battery.json --mah 2000
+
+--telemetry takes the "battery" object a device sends with its heartbeats
+(see swagger.ru.yaml) and projects the average current it actually drew.
+"""
+
+import argparse
+import json
+
+# mA, per state
+CURRENT_MA = {
+    "sleep": 0.15,      # deep sleep: RTC + board leakage (regulator, divider)
+    "awake": 45.0,      # CPU at 240 MHz, radio off
+    "radio": 120.0,     # WiFi station joined / TLS heartbeat
+    "softap": 110.0,    # always-on: station + softAP + portal
+}
+
+# Per event
+REFRESH_MC = 25.0       # e-paper full refresh: ~2 s at ~12 mA, millicoulombs (mA*s)
+WAKE_S = 0.35           # boot from deep sleep to first SPI write (ROM, PSRAM, LittleFS)
+FRAME_LOAD_S = 0.15     # manifest + bitmap from flash, sha256 check
+HEARTBEAT_S = 2.5       # fast join (cached BSSID) + TLS + request
+
+
+def battery_mode_ma(frames, heartbeat_s):
+    """Average mA in battery mode for a playlist of frame durations (s)."""
+    hour = 3600.0
+    cycle = sum(frames)
+    switches = hour / cycle * len(frames) if len(frames) > 1 else 0.0
+    heartbeats = hour / heartbeat_s
+    # A heartbeat due within a few seconds of a switch shares its wake; the
+    # model counts them separately (slightly pessimistic)
+    wakes = switches + heartbeats
+
+    awake_s = wakes * WAKE_S + switches * FRAME_LOAD_S
+    radio_s = heartbeats * HEARTBEAT_S
+    refresh_mc = switches * REFRESH_MC
+    sleep_s = hour - awake_s - radio_s
+
+    mc = (awake_s * CURRENT_MA["awake"] + radio_s * CURRENT_MA["radio"] +
+          sleep_s * CURRENT_MA["sleep"] + refresh_mc)
+    return mc / hour
+
+
+def always_on_ma(frames):
+    hour = 3600.0
+    switches = hour / sum(frames) * len(frames) if len(frames) > 1 else 0.0
+    return CURRENT_MA["softap"] + switches * REFRESH_MC / hour
+
+
+def telemetry_ma(t):
+    """Average mA from a device's own counters (ms totals)."""
+    awake = t["awakeMs"] / 1000.0
+    radio = min(t["radioMs"] / 1000.0, awake)
+    slept = t["sleptMs"] / 1000.0
+    total = awake + slept
+    if total <= 0:
+        raise SystemExit("telemetry covers no time yet")
+    mc = ((awake - radio) * CURRENT_MA["awake"] + radio * CURRENT_MA["radio"] +
+          slept * CURRENT_MA["sleep"] + t["refreshes"] * REFRESH_MC)
+    return mc / total
+
+
+def life(mah, ma):
+    hours = mah / ma
+    return "%.0f h (%.1f days)" % (hours, hours / 24)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--frames", default="300", help="frame durations in s, comma separated (default: one frame)")
+    ap.add_argument("--heartbeat", type=int, default=900, help="heartbeat interval, s (firmware minimum 900)")
+    ap.add_argument("--mah", type=float, default=2000, help="battery capacity, mAh")
+    ap.add_argument("--telemetry", help="JSON file with a heartbeat's telemetry.battery object")
+    ap.add_argument("--current", action="append", default=[], metavar="STATE=MA",
+                    help="override a state current, e.g. sleep=0.01")
+    args = ap.parse_args()
+
+    for kv in args.current:
+        state, ma = kv.split("=")
+        if state not in CURRENT_MA:
+            raise SystemExit("unknown state %s (one of %s)" % (state, ", ".join(CURRENT_MA)))
+        CURRENT_MA[state] = float(ma)
+
+    if args.telemetry:
+        with open(args.telemetry) as f:
+            t = json.load(f)
+        t = t.get("telemetry", t).get("battery", t)
+        ma = telemetry_ma(t)
+        print("measured counters: %d wakes, %.1f%% of the time asleep" %
+              (t["wakes"], 100.0 * t["sleptMs"] / (t["sleptMs"] + t["awakeMs"])))
+        print("battery mode: %.2f mA -> %s" % (ma, life(args.mah, ma)))
+        return
+
+    frames = [int(x) for x in args.frames.split(",") if x]
+    heartbeat = max(args.heartbeat, 900)
+    bm = battery_mode_ma(frames, heartbeat)
+    on = always_on_ma(frames)
+    print("playlist %s s, heartbeat every %d s, %.0f mAh" % (frames, heartbeat, args.mah))
+    print("  always on:    %7.2f mA -> %s" % (on, life(args.mah, on)))
+    print("  battery mode: %7.2f mA -> %s" % (bm, life(args.mah, bm)))
+
+
+if __name__ == "__main__":
+    main()
@@ -3,13 +3,36 @@
 export type LedColor = 'green' | 'red' | 'blue' | 'yellow' | 'cyan' | 'magenta' | 'white' | 'rainbow' | 'off';
 export type LedBrightness = 'low' | 'mid' | 'high' | 'off';
 
+// One step of a per-frame LED sequence, looped while the frame is shown
+export interface LedKeyframe {
+  color: Exclude<LedColor, 'rainbow'> | `#${string}`;
+  fadeMs?: number;
+  holdMs?: number;
+}
+
+export type Melody = 'positive' | 'negative' | 'chime' | 'alert' | 'none';
+export type RefreshHint = 'auto' | 'full' | 'fast' | 'partial';
+export type FrameFormat = 'mono' | 'gray4';
+
+// One step of a per-frame beep; hz 0 is a rest, duty 255 the loudest
+export interface Tone {
+  hz: number;
+  ms: number;
+  duty?: number;
+}
+
 export interface DisplayFrame {
-  bitmap: string;          // base64, 8064 bytes decoded (384x168 1-bit packed)
+  bitmap: string;          // base64, 8064 bytes decoded (384x168 1-bit packed), 16128 for gray4
+  format?: FrameFormat;          // gray4: 2 bits per pixel, 3 = white
   ledColor: LedColor;
   ledBrightness: LedBrightness;
   durationSec: number;
   beep?: boolean;
   flashCount?: number;
+  ledKeyframes?: LedKeyframe[];  // replaces ledColor when present
+  melody?: Melody;               // what beep plays
+  tones?: Tone[];                // custom beep; replaces melody when present
+  refresh?: RefreshHint;         // panel refresh when the frame comes up
 }
 
 export interface DisplayFramesPayload {